@@ -24,7 +24,22 @@ SOURCES += \
     sources/motionFilter.cpp \
     sources/main.cpp \
     sources/mainwindow.cpp \
-    sources/write_message.cpp
+    sources/event_channel.cpp \
+    sources/cameraSettings.cpp \
+    sources/frameRing.cpp \
+    sources/mjpegAviWriter.cpp \
+    sources/eventRecorder.cpp \
+    sources/jpegEncoderPool.cpp \
+    sources/detectionScheduler.cpp \
+    sources/frameContext.cpp \
+    sources/motionKernel.cpp \
+    sources/zoneMask.cpp \
+    sources/sharedFrameRing.cpp \
+    sources/mjpegServer.cpp \
+    sources/control_channel.cpp \
+    sources/detectionConfig.cpp \
+    sources/eventJournal.cpp \
+    sources/retentionManager.cpp
 
 HEADERS += \
     sources/camera.hpp \
@@ -34,7 +49,23 @@ HEADERS += \
     sources/humanFilter.hpp \
     sources/motionFilter.hpp \
     sources/mainwindow.h \
-    sources/write_message.h
+    sources/event_channel.h \
+    sources/cameraSettings.hpp \
+    sources/frameQueue.hpp \
+    sources/frameRing.hpp \
+    sources/mjpegAviWriter.hpp \
+    sources/eventRecorder.hpp \
+    sources/jpegEncoderPool.hpp \
+    sources/detectionScheduler.hpp \
+    sources/frameContext.hpp \
+    sources/motionKernel.hpp \
+    sources/zoneMask.hpp \
+    sources/sharedFrameRing.hpp \
+    sources/mjpegServer.hpp \
+    sources/control_channel.h \
+    sources/detectionConfig.hpp \
+    sources/eventJournal.hpp \
+    sources/retentionManager.hpp
 
 FORMS += \
     sources/mainwindow.ui
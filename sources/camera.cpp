@@ -12,14 +12,14 @@
  */
 
 #include "low_level_cctv_daemon_apis.h"
-#include "write_message.h"
+#include "event_channel.h"
 #include "camera.hpp"
-#include <opencv2/imgcodecs.hpp>
 #include <sys/stat.h>   /* for mkdir() */
 #include <sys/types.h>  /* for permissions constatnts */
 #include <syslog.h>     /* for syslog() */
 #include <string>       /* for std::string, std::to_string() */
 #include <cstring>      /* for strerror() */
+#include <ctime>        /* for localtime_r(), strftime() */
 #include <errno.h>      /* for errno */
 
 using std::string;
@@ -62,18 +62,31 @@ int mkpath(const string& path, size_t start, mode_t mode)
 
 
 Camera::Camera(int cameraID)
+ : framesAnalyzed(0), eventCount(0), stopRequested(false), finished(false), recorder(cameraID),
+   streamWriter(sharedFrameName("camera" + std::to_string(cameraID)), sharedFrameDoorbell(liveStreamDirectory() + "camera" + std::to_string(cameraID))),
+   settings(loadCameraSettings(cameraID, false)),
+   zones(cameraID), zonesChanged(false),
+   frameQueue(settings.frameQueueCapacity, settings.frameQueuePolicy),
+   spareFrames(settings.frameQueueCapacity, OverflowPolicy::DropNewest), reportedDrops(0), currentClip(JournalNoClip),
+   compressionQueue(settings.frameQueueCapacity, OverflowPolicy::Block), framesBeingCompressed(0),
+   motionFilter(settings.motionAlgorithm, settings.motionLearningRate, &zones),
+   humanScheduler([this](FrameContext& context, double scale, const cv::Rect& region, std::vector<cv::Rect>& humans)
+                  { humanFilter.detect(context.scaled(scale)(region), humans); },
+                  settings.detectionInterval, settings.trackerType, cv::Size(64, 128), settings.analysisScale, cv::Scalar(0, 255, 0), &zones),
+   faceScheduler([this](FrameContext& context, double scale, const cv::Rect& region, std::vector<cv::Rect>& faces)
+                 { faceFilter.detectEqualized(context.scaledEqualized(scale)(region), faces); },
+                 settings.detectionInterval, settings.trackerType, cv::Size(30, 30), settings.analysisScale, cv::Scalar(255, 0, 0), &zones),
+   configVersion(0)
 {
     this->cameraID = cameraID; 
 
     recording = false;
-    streamDir = "/tmp/SmartCCTV_livestream/camera" + std::to_string(cameraID) + "/";
+    streamDir = liveStreamDirectory() + "camera" + std::to_string(cameraID) + "/";
     videoSaveDir = daemon_data.home_directory;
     videoSaveDir += "/SmartCCTV_recordings/camera" + std::to_string(cameraID) + "/";
 
     if (mkpath(videoSaveDir, 17, S_IRWXU) == -1) {
-        string message = "SmartCCTV could not create ";
-        message += videoSaveDir;
-        write_message(message);
+        send_gui_event(EVENT_PERMISSION_ERROR, cameraID, videoSaveDir);
 
         daemon_data.daemon_exit_status = EXIT_FAILURE;
         terminate_daemon(0);
@@ -82,8 +95,7 @@ Camera::Camera(int cameraID)
     }
 
     if (mkpath(streamDir, 5, S_IRWXU) == -1) {
-        string message = "SmartCCTV could not create the live stream.";
-        write_message(message);
+        send_gui_event(EVENT_PERMISSION_ERROR, cameraID, streamDir);
 
         daemon_data.daemon_exit_status = EXIT_FAILURE;
         terminate_daemon(0);
@@ -96,7 +108,7 @@ Camera::Camera(int cameraID)
    	{
         string message = "SmartCCTV failed to open camera";
         message += to_string(cameraID);
-        write_message(message);
+        send_gui_event(EVENT_CAMERA_ERROR, cameraID, message);
 
         syslog(log_facility | LOG_ERR, "Failed to open camera%d", cameraID);
 
@@ -105,24 +117,42 @@ Camera::Camera(int cameraID)
     } else {
         syslog(log_facility | LOG_NOTICE, "Creating camera%d", cameraID);
     }
+
+    sizeFrameBackCapture();
 }
 
 
-Camera::Camera(std::string readFilePath)
+Camera::Camera(std::string readFilePath, int cameraNumber)
+ : framesAnalyzed(0), eventCount(0), stopRequested(false), finished(false), recorder(cameraNumber),
+   streamWriter(sharedFrameName("camera" + std::to_string(cameraNumber)), sharedFrameDoorbell(liveStreamDirectory() + "camera" + std::to_string(cameraNumber))),
+   settings(loadCameraSettings(cameraNumber, true)),
+   zones(cameraNumber), zonesChanged(false),
+   frameQueue(settings.frameQueueCapacity, settings.frameQueuePolicy),
+   spareFrames(settings.frameQueueCapacity, OverflowPolicy::DropNewest), reportedDrops(0), currentClip(JournalNoClip),
+   compressionQueue(settings.frameQueueCapacity, OverflowPolicy::Block), framesBeingCompressed(0),
+   motionFilter(settings.motionAlgorithm, settings.motionLearningRate, &zones),
+   humanScheduler([this](FrameContext& context, double scale, const cv::Rect& region, std::vector<cv::Rect>& humans)
+                  { humanFilter.detect(context.scaled(scale)(region), humans); },
+                  settings.detectionInterval, settings.trackerType, cv::Size(64, 128), settings.analysisScale, cv::Scalar(0, 255, 0), &zones),
+   faceScheduler([this](FrameContext& context, double scale, const cv::Rect& region, std::vector<cv::Rect>& faces)
+                 { faceFilter.detectEqualized(context.scaledEqualized(scale)(region), faces); },
+                 settings.detectionInterval, settings.trackerType, cv::Size(30, 30), settings.analysisScale, cv::Scalar(255, 0, 0), &zones),
+   configVersion(0)
 {
     this->readFilePath = readFilePath; 
 
-    cameraID = -1;
     recording = false;
 
-    streamDir = "/tmp/SmartCCTV_livestream/camera" + std::to_string(0) + "/";
+    // A media file has no device number of its own, so the daemon hands it a free camera number
+    // to keep its livestream and recordings directories apart from the other cameras.
+    // The logs and the events of the GUI use the same number.
+    cameraID = cameraNumber;
+    streamDir = liveStreamDirectory() + "camera" + std::to_string(cameraNumber) + "/";
     videoSaveDir = daemon_data.home_directory;
-    videoSaveDir += "/SmartCCTV_recordings/camera" + std::to_string(0) + "/";
+    videoSaveDir += "/SmartCCTV_recordings/camera" + std::to_string(cameraNumber) + "/";
 
     if (mkpath(videoSaveDir, 17, S_IRWXU) == -1) {
-        string message = "SmartCCTV could not create ";
-        message += videoSaveDir;
-        write_message(message);
+        send_gui_event(EVENT_PERMISSION_ERROR, cameraID, videoSaveDir);
 
         daemon_data.daemon_exit_status = EXIT_FAILURE;
         terminate_daemon(0);
@@ -131,8 +161,7 @@ Camera::Camera(std::string readFilePath)
     }
 
     if (mkpath(streamDir, 5, S_IRWXU) == -1) {
-        string message = "SmartCCTV could not create the live stream.";
-        write_message(message);
+        send_gui_event(EVENT_PERMISSION_ERROR, cameraID, streamDir);
 
         daemon_data.daemon_exit_status = EXIT_FAILURE;
         terminate_daemon(0);
@@ -145,7 +174,7 @@ Camera::Camera(std::string readFilePath)
     {
         string message = "SmartCCTV failed to open ";
         message += readFilePath;
-        write_message(message);
+        send_gui_event(EVENT_CAMERA_ERROR, cameraID, message);
 
         syslog(log_facility | LOG_ERR, "Failed to open media file %s", readFilePath.c_str());
 
@@ -154,83 +183,231 @@ Camera::Camera(std::string readFilePath)
     } else {
         syslog(log_facility | LOG_NOTICE, "Opening media file %s", readFilePath.c_str());
     }
+
+    sizeFrameBackCapture();
+}
+
+
+void Camera::sizeFrameBackCapture()
+{
+	// Some drivers don't know their frame rate and report 0, assume a common webcam then.
+	double fps = cap.get(cv::CAP_PROP_FPS);
+	if(fps <= 0 || fps > 240)
+	{
+		fps = 30;
+	}
+	captureFps = fps;
+
+	// The buffer holds the pre-roll before the detection event, the recording itself is written as it happens.
+	// One extra second covers a frame rate that is a little higher than the driver says.
+	int seconds = settings.preRollSeconds + 1;
+	frameBackCapture.setCapacity(static_cast<std::size_t>(fps * seconds));
+	frameBackCapture.setCompression(settings.bufferCompression, settings.jpegQuality, settings.bufferMemoryBudget);
+	syslog(log_facility | LOG_NOTICE, "Camera %d buffers %zu frames (%.1f fps, %d seconds)",
+	       cameraID, frameBackCapture.capacity(), fps, seconds);
 }
 
 
 void Camera::clearExpiredFrames()
 {
 	auto now = std::chrono::high_resolution_clock::now();
-	for(size_t i = 0; i < frameBackCapture.size(); i++)
+	frameBackCapture.dropOlderThan(now - std::chrono::seconds(settings.preRollSeconds));
+}
+
+
+void Camera::saveToStream(const cv::Mat& frame)
+{
+	// The viewer shows BGR pixels as they are, anything else is not a frame from the camera.
+	if(frame.type() != CV_8UC3)
 	{
-		auto duration = std::chrono::duration_cast<std::chrono::seconds>(now - frameBackCapture[i].start);
-		if(duration.count() > 10)
-		{
-			frameBackCapture.erase(frameBackCapture.begin() + i);
-			i--;
-		}
-		else
-		{
-			return;
-		}
+		return;
+	}
+	streamWriter.publish(frame.data, frame.cols, frame.rows, frame.step);
+}
+
+
+void Camera::saveFrameToBuffer(frameContainer& container)
+{
+	if(recording)
+	{
+		// The frame is not needed here anymore, it is handed over without a copy.
+		recorder.addFrame(std::move(container), FrameCompression::None);
+		return;
+	}
+
+	if(frameBackCapture.compression() == FrameCompression::None)
+	{
+		frameBackCapture.push(container.frame, container.start);
+		return;
+	}
+
+	// Compressing takes longer than copying, so it is done on the compression thread.
+	// The frame is not needed here anymore, it is handed over without a copy.
+	{
+		std::lock_guard<std::mutex> guard(compressionMutex);
+		framesBeingCompressed++;
+	}
+	if(!compressionQueue.push(std::move(container)))
+	{
+		finishCompression();
 	}
 }
 
 
-void Camera::saveToStream(cv::Mat frame, int x)
+void Camera::finishCompression()
 {
-	std::string imageFileName = streamDir + std::to_string(x) + ".bmp";
-	imwrite(imageFileName, frame);
+	std::lock_guard<std::mutex> guard(compressionMutex);
+	framesBeingCompressed--;
+	if(framesBeingCompressed == 0)
+	{
+		compressionDone.notify_one();
+	}
 }
 
 
-void Camera::saveFrameToBuffer(cv::Mat frame)
+void Camera::compressFrames()
 {
 	frameContainer container;
-	container.frame = frame.clone();
-	container.start = std::chrono::high_resolution_clock::now();
-	frameBackCapture.push_back(container);
+	while(compressionQueue.pop(container))
+	{
+		frameBackCapture.push(container.frame, container.start);
+		finishCompression();
+	}
 }
 
 
-void Camera::saveVideo()
+void Camera::beginEvent(const cv::Mat& frame)
 {
-	if(frameBackCapture.size() < 1)
+	// The newest frames of the pre-roll may still be on their way into the buffer.
 	{
-		//Trying to write an empty video, this is an error state
-        string message = "SmartCCTV: something has gone wrong with saving the video.";
-        write_message(message);
+		std::unique_lock<std::mutex> lock(compressionMutex);
+		compressionDone.wait(lock, [this]{ return framesBeingCompressed == 0; });
+	}
 
-		syslog(log_facility | LOG_ERR, "Error: Attempting to save empty video");
-        return;
+	// The real frame rate often differs from what the driver says, and drops lower it further.
+	// The pre-roll has the timestamps of the latest frames, so it says how fast the frames come in right now.
+	double fps = captureFps;
+	std::size_t bufferedFrames = frameBackCapture.size();
+	if(bufferedFrames > 1)
+	{
+		double seconds = std::chrono::duration<double>(frameBackCapture[bufferedFrames - 1].start - frameBackCapture[0].start).count();
+		if(seconds > 0)
+		{
+			fps = (bufferedFrames - 1) / seconds;
+		}
 	}
-	
-	auto point = std::chrono::high_resolution_clock::now();
-	auto s = std::chrono::duration_cast<std::chrono::seconds>(point.time_since_epoch());
-	std::time_t t = s.count();
-	std::string videoFileName = std::ctime(&t);
-	videoFileName.pop_back();
-	videoFileName.append(".avi");
+
+	// Every camera begins it's events on it's own thread, so the static buffer of ctime() can't be used.
+	// The name looks the same as before, like "Sun Oct 18 06:04:26 2026".
+	std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+	struct tm localTime;
+	localtime_r(&t, &localTime);
+	char videoFileName[32];
+	std::strftime(videoFileName, sizeof(videoFileName), "%a %b %e %H:%M:%S %Y", &localTime);
+	// The recorder adds the extension of the codec.
 	std::string fullVideoString = videoSaveDir + videoFileName;
-	cv::VideoWriter video(fullVideoString, CV_FOURCC('M','J','P','G'), 10, cv::Size(frameBackCapture[0].frame.cols, frameBackCapture[0].frame.rows));
-	
-	for(size_t i = 0; i < frameBackCapture.size(); i++)
+	recorder.beginEvent(fullVideoString, fps, frame.size());
+	// The journal says where in the video each of it's records is, the video starts with the oldest frame of the pre-roll.
+	currentClip = journal.addClip(fullVideoString);
+	clipStart = bufferedFrames > 0 ? frameBackCapture[0].start : recordingStartTime;
+
+	if(frameBackCapture.overwrittenCount() > 0)
 	{
-		video.write(frameBackCapture[i].frame);
+		syslog(log_facility | LOG_WARNING, "The beginning of %s was lost, %zu frames did not fit into the buffer",
+		       fullVideoString.c_str(), frameBackCapture.overwrittenCount());
+	}
+
+	// The recorder owns the frames it is given, so the pre-roll is copied out and the ring keeps it's storage.
+	frameContainer container;
+	while(frameBackCapture.popOldest(container))
+	{
+		recorder.addFrame(std::move(container), frameBackCapture.compression());
 	}
-	
-	syslog(log_facility | LOG_NOTICE, "Saved a video %s", fullVideoString.c_str());
 	frameBackCapture.clear();
 }
 
 
+void Camera::endEvent()
+{
+	recording = false;
+	recorder.endEvent();
+	currentClip = JournalNoClip;
+	send_gui_event(EVENT_DETECTION_ENDED, cameraID);
+}
+
+
+void Camera::sendStatsEvent(std::chrono::time_point<std::chrono::high_resolution_clock> now)
+{
+	CameraStats current = stats();
+	Gui_event event = {};
+	event.camera = cameraID;
+	event.captured = current.captured;
+	event.dropped = current.dropped;
+	event.analyzed = current.analyzed;
+	event.events = current.events;
+	double seconds = std::chrono::duration<double>(now - lastStatsEvent).count();
+	event.fps = seconds > 0 ? (current.analyzed - analyzedAtLastStats) / seconds : 0;
+	send_gui_stats(event);
+
+	lastStatsEvent = now;
+	analyzedAtLastStats = current.analyzed;
+}
+
+
+void Camera::writeJournal(std::chrono::time_point<std::chrono::high_resolution_clock> time, const DetectionConfig& config,
+                          bool humanFound, bool faceFound)
+{
+	JournalRecord record = {};
+	// The frames are timed with high_resolution_clock, which may be steady_clock and count from the boot,
+	// so the record gets the time of day on system_clock, less how long ago the frame was captured.
+	auto age = std::chrono::high_resolution_clock::now() - time;
+	record.time = std::chrono::duration_cast<std::chrono::milliseconds>((std::chrono::system_clock::now() - age).time_since_epoch()).count();
+	record.camera = cameraID;
+	record.clip = currentClip;
+	record.clipOffset = static_cast<std::int32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(time - clipStart).count());
+
+	auto addBoxes = [&record](const std::vector<cv::Rect>& boxes, std::uint8_t detector)
+	{
+		for(const cv::Rect& box : boxes)
+		{
+			if(record.boxCount == JournalMaxBoxes)
+			{
+				return;
+			}
+			record.boxDetectors[record.boxCount] = detector;
+			record.boxes[record.boxCount] = { static_cast<std::int16_t>(box.x), static_cast<std::int16_t>(box.y),
+			                                  static_cast<std::int16_t>(box.width), static_cast<std::int16_t>(box.height) };
+			record.boxCount++;
+		}
+	};
+	// The boxes of the detectors come first, the motion regions only fill up the rest.
+	if(config.humanDetection && humanFound)
+	{
+		record.detectors |= JournalHuman;
+		addBoxes(humanScheduler.objects(), JournalHuman);
+	}
+	if(config.humanDetection && faceFound)
+	{
+		record.detectors |= JournalFace;
+		addBoxes(faceScheduler.objects(), JournalFace);
+	}
+	if(config.motionDetection)
+	{
+		record.detectors |= JournalMotion;
+		record.motionScore = motionFilter.motionScore();
+		addBoxes(motionFilter.motionRegions(), JournalMotion);
+	}
+	journal.append(record);
+}
+
+
 void Camera::checkRecordingLength()
 {
 	auto now = std::chrono::high_resolution_clock::now();
 	auto duration = std::chrono::duration_cast<std::chrono::seconds>(now - recordingStartTime);
-	if(duration.count() > 15)
+	if(duration.count() > settings.recordingSeconds)
 	{
-		recording = false;
-		saveVideo();
+		endEvent();
 	}
 }
 
@@ -239,57 +416,202 @@ void Camera::finalize()
 {
 	if(recording)
 	{
-		saveVideo();	
+		endEvent();
 	}
+	// Waits until the last video is completely written.
+	recorder.stop();
+	journal.close();
     	cap.release();
 	cv::destroyAllWindows();
 }
 
 
+void Camera::stop()
+{
+	stopRequested = true;
+	// Wakes up the analysis loop if it is waiting for a frame.
+	frameQueue.close();
+}
+
+
+void Camera::grabFrames()
+{
+	// This thread does nothing but read the camera, so the driver's buffer is emptied in real time
+	// no matter how long the analysis of a frame takes.
+	while(!stopRequested)
+	{
+		frameContainer container;
+		// Without a spare buffer, the capture allocates a new one.
+		spareFrames.tryPop(container.frame);
+		cap >> container.frame;
+		container.start = std::chrono::high_resolution_clock::now();
+
+		if(container.frame.empty())
+		{
+            send_gui_event(EVENT_CAMERA_ERROR, cameraID, "SmartCCTV encountered an error.");
+
+			syslog(log_facility | LOG_ERR, "Error: Corrupt frame on camera %d", cameraID);
+
+			// Only this camera stops, the other cameras of the daemon keep running.
+			daemon_data.daemon_exit_status = EXIT_FAILURE;
+			break;
+		}
+
+		frameQueue.push(std::move(container));
+	}
+
+	// The analysis loop finishes the frames that are still queued and then stops.
+	frameQueue.close();
+}
+
+
+void Camera::reportDroppedFrames()
+{
+	// A frame evicted under DropOldest was accepted first, it is only counted once.
+	std::uint64_t dropped = frameQueue.droppedCount();
+	if(dropped > reportedDrops)
+	{
+		syslog(log_facility | LOG_WARNING, "Camera %d dropped %llu of %llu frames, the analysis can't keep up",
+		       cameraID, (unsigned long long) dropped, (unsigned long long) frameQueue.offeredCount());
+		reportedDrops = dropped;
+	}
+}
+
+
+bool Camera::hasFinished() const
+{
+	return finished;
+}
+
+
+void Camera::reloadZones()
+{
+	// The masks are in use by the filters, so the analysis loop reloads them itself between two frames.
+	zonesChanged = true;
+}
+
+
+CameraStats Camera::stats() const
+{
+	CameraStats stats;
+	stats.dropped = frameQueue.droppedCount();
+	stats.captured = frameQueue.offeredCount();
+	stats.analyzed = framesAnalyzed.load(std::memory_order_relaxed);
+	stats.events = eventCount.load(std::memory_order_relaxed);
+	stats.recording = recording;
+	stats.finished = finished;
+	return stats;
+}
+
+
 void Camera::record()
 {
 	syslog(log_facility | LOG_NOTICE, "Camera recording.");
 
-	int x = 0;
-	cv::Mat frame;
-	while(true)
+	std::thread grabberThread(&Camera::grabFrames, this);
+	// The recorder queue holds the whole pre-roll, and as much again of live frames while the pre-roll is written.
+	recorder.start(frameBackCapture.capacity() * 2, settings);
+	// The camera records without a journal if it can't be written, open() logs why.
+	journal.open(videoSaveDir, cameraID);
+	if(settings.httpPort > 0)
 	{
-		if(!recording)
+		httpServer.reset(new MjpegServer(cameraID, settings.httpAddress, settings.httpPort, settings.jpegQuality,
+		                                 settings.httpClientQueue));
+		if(!httpServer->start())
 		{
-			clearExpiredFrames();
+			httpServer.reset();
 		}
-		
-		cap >> frame;
-		
-		if(frame.empty())
-		{
-            string message = "SmartCCTV encountered an error.";
-            write_message(message);
+	}
+	std::thread compressionThread;
+	if(frameBackCapture.compression() != FrameCompression::None)
+	{
+		compressionThread = std::thread(&Camera::compressFrames, this);
+	}
 
-			syslog(log_facility | LOG_ERR, "Error: Corrupt frame on camera %d", cameraID);
+	frameContainer container;
+	std::vector<cv::Rect> wholeFrame(1);
+	auto lastDropReport = std::chrono::high_resolution_clock::now();
+	lastStatsEvent = lastDropReport;
+	analyzedAtLastStats = framesAnalyzed;
+	while(!stopRequested && frameQueue.pop(container))
+	{
+		cv::Mat& frame = container.frame;
 
-			daemon_data.daemon_exit_status = EXIT_FAILURE;
-    	    terminate_daemon(0);
+		if(!recording)
+		{
+			clearExpiredFrames();
 		}
 		
 		//syslog(log_facility | LOG_NOTICE, "Running Recognition and Detection.");
 		bool motionDetected = true;
 		bool humanFound = true;
 		bool faceFound = true;
-		if(daemon_data.enable_human_detection)
+		if(zonesChanged.exchange(false))
+		{
+			zones.reload();
+		}
+		// The settings are taken once, so the whole frame is analyzed with the same settings even if they change meanwhile.
+		std::shared_ptr<const DetectionConfig> config = currentDetectionConfig();
+		if(config->version != configVersion)
+		{
+			syslog(log_facility | LOG_NOTICE, "Camera %d uses detection settings version %llu from now on",
+			       cameraID, (unsigned long long) config->version);
+			configVersion = config->version;
+		}
+		frameContext.reset(frame);
+		if(config->motionDetection)
+		{
+			motionDetected = motionFilter.runDetection(frameContext, *config);
+		}
+		if(config->humanDetection)
 		{
-			humanFound = humanFilter.runRecognition(frame);
-			faceFound = faceFilter.runRecognition(frame);
+			if(motionDetected)
+			{
+				// A recording needs motion anyway, so the detectors only look where something moved.
+				wholeFrame[0] = cv::Rect(0, 0, frame.cols, frame.rows);
+				const std::vector<cv::Rect>& regions = config->motionDetection ? motionFilter.motionRegions() : wholeFrame;
+				humanFound = humanScheduler.runRecognition(frameContext, regions, *config);
+				faceFound = faceScheduler.runRecognition(frameContext, regions, *config);
+			}
+			else
+			{
+				// Nothing moved, nothing can be recorded, so the detectors don't run at all.
+				// The first frame that moves again is a detection, not an update of trackers that missed the frames in between.
+				humanScheduler.skipFrame();
+				faceScheduler.skipFrame();
+				humanFound = false;
+				faceFound = false;
+			}
 		}
-		if(daemon_data.enable_motion_detection)
+		// The outlines are drawn once every stage is done with the frame, so no detector or tracker sees them.
+		// The live stream and the recording get the frame with it's outlines.
+		if(config->outlines)
 		{
-			motionDetected = motionFilter.runDetection(frame);
+			if(config->motionDetection)
+			{
+				motionFilter.drawOverlay(frame);
+			}
+			if(config->humanDetection && motionDetected)
+			{
+				humanScheduler.drawOutlines(frame);
+				faceScheduler.drawOutlines(frame);
+			}
 		}
 		
 		if(daemon_data.is_live_stream_running)
 		{
 			//syslog(log_facility | LOG_NOTICE, "Saving frame to livestream dir");
-			saveToStream(frame, x);
+			saveToStream(frame);
+		}
+		else
+		{
+			// Nobody is watching, the shared memory is made again when the live stream starts.
+			streamWriter.close();
+		}
+		if(httpServer)
+		{
+			// Unlike the viewer, the HTTP clients don't depend on the live stream being turned on.
+			httpServer->publish(frame);
 		}
 		 
 		if((humanFound || faceFound) && motionDetected)
@@ -298,8 +620,19 @@ void Camera::record()
 			{
 				//DETECTION EVENT!!!
 				recordingStartTime = std::chrono::high_resolution_clock::now();
+				beginEvent(frame);
 				recording = true;
+				eventCount.fetch_add(1, std::memory_order_relaxed);
+				send_gui_event(EVENT_DETECTION_STARTED, cameraID);
 				//syslog(log_facility | LOG_NOTICE, "Human found!!!");
+				// The first frame of every event is in the journal.
+				lastJournalRecord = container.start - std::chrono::seconds(1);
+			}
+			// While something is detected the journal gets a frame a second, the video has all of them.
+			if(container.start - lastJournalRecord >= std::chrono::seconds(1))
+			{
+				writeJournal(container.start, *config, humanFound, faceFound);
+				lastJournalRecord = container.start;
 			}
 		}
 		
@@ -308,11 +641,51 @@ void Camera::record()
 			checkRecordingLength();
 		}
 		
-		saveFrameToBuffer(frame);
-		x++;
+		saveFrameToBuffer(container);
+		framesAnalyzed.fetch_add(1, std::memory_order_relaxed);
+		// The buffer is only still here if the frame was copied, nothing reads it before frameContext.reset() with the next frame.
+		if(!container.frame.empty())
+		{
+			spareFrames.push(std::move(container.frame));
+		}
+
+		if(container.start - lastDropReport > std::chrono::seconds(10))
+		{
+			reportDroppedFrames();
+			lastDropReport = container.start;
+		}
+		// The GUI shows how fast every camera is analyzed, the event channel coalesces them if the GUI falls behind.
+		if(container.start - lastStatsEvent >= std::chrono::seconds(1))
+		{
+			sendStatsEvent(container.start);
+		}
 		//syslog(log_facility | LOG_NOTICE, "Through the loop...");
 	}
 	
-	cap.release();
-}
+	stopRequested = true;
+	frameQueue.close();
+	grabberThread.join();
+	reportDroppedFrames();
+	httpServer.reset();
+	SharedFrameCounters streamCounters = streamWriter.counters();
+	if(streamCounters.published > 0)
+	{
+		syslog(log_facility | LOG_NOTICE, "Camera %d published %llu live stream frames, the viewer displayed %llu and skipped %llu",
+		       cameraID, (unsigned long long) streamCounters.published, (unsigned long long) streamCounters.displayed,
+		       (unsigned long long) streamCounters.skipped);
+	}
+	if(humanScheduler.frameCount() > 0)
+	{
+		syslog(log_facility | LOG_NOTICE, "Camera %d ran the detectors on %llu of %llu frames",
+		       cameraID, (unsigned long long) humanScheduler.detectionCount(), (unsigned long long) humanScheduler.frameCount());
+	}
+	// The compression thread finishes the frames that are still queued, so the last clip is complete.
+	compressionQueue.close();
+	if(compressionThread.joinable())
+	{
+		compressionThread.join();
+	}
 
+	finalize();
+	finished = true;
+}
@@ -16,46 +16,127 @@
 
 #include <vector>
 #include <chrono>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 #include <syslog.h>  /* for syslog() */
 #include "humanFilter.hpp"
 #include "faceFilter.hpp"
 #include "motionFilter.hpp"
+#include "detectionScheduler.hpp"
+#include "detectionConfig.hpp"
+#include "frameContext.hpp"
+#include "cameraSettings.hpp"
+#include "frameQueue.hpp"
+#include "frameRing.hpp"
+#include "eventRecorder.hpp"
+#include "zoneMask.hpp"
+#include "sharedFrameRing.hpp"
+#include "mjpegServer.hpp"
+#include "eventJournal.hpp"
 #define log_facility LOG_LOCAL0
 
 //using namespace std;
 //using namespace cv;
 
-struct frameContainer
+// What a camera did since it started recording, for the stats request of the control channel.
+struct CameraStats
 {
-	cv::Mat frame;
-	std::chrono::time_point<std::chrono::high_resolution_clock> start;
+	std::uint64_t captured;  // frames from the camera, including the dropped ones
+	std::uint64_t dropped;   // frames the analysis couldn't keep up with
+	std::uint64_t analyzed;
+	std::uint64_t events;    // detection events, each one is a video
+	bool recording;
+	bool finished;
 };
 
 class Camera
 {
 	public:
 	Camera(int cameraID);
-	Camera(std::string filePath);
+	Camera(std::string filePath, int cameraNumber = 0);
 	void record();
+	void stop();
+	bool hasFinished() const;
+	// Asks the camera to read it's zones again, before the next frame. Can be called from any thread.
+	void reloadZones();
+	// Can be called from any thread, while the camera is recording.
+	CameraStats stats() const;
+	const CameraSettings& currentSettings() const { return settings; }
     void finalize();
 	
 	private:
 	int cameraID;
-	bool recording;
-	std::vector<frameContainer> frameBackCapture;
+	std::atomic<bool> recording;
+	// Counted by the analysis loop in record(), read by stats().
+	std::atomic<std::uint64_t> framesAnalyzed;
+	std::atomic<std::uint64_t> eventCount;
+	std::atomic<bool> stopRequested;
+	std::atomic<bool> finished;
+	// Only the pre-roll is buffered, during a detection event the frames go straight to the recorder.
+	FrameRing frameBackCapture;
+	EventRecorder recorder;
 	std::string readFilePath;
 	std::string streamDir;
+	// Hands the live stream frames to the LiveStream Viewer through shared memory.
+	SharedFrameWriter streamWriter;
 	std::string videoSaveDir;
 	std::chrono::time_point<std::chrono::high_resolution_clock> recordingStartTime;
 	cv::VideoCapture cap;
-	void saveFrameToBuffer(cv::Mat frame);
+	// The frame rate the driver reports, only used until there are frames to measure it from.
+	double captureFps;
+	CameraSettings settings;
+	// The MJPEG over HTTP live stream, only while recording and only if the settings give it a port.
+	std::unique_ptr<MjpegServer> httpServer;
+	// The watched and the ignored parts of the frame, only used by the analysis loop in record().
+	ZoneMask zones;
+	std::atomic<bool> zonesChanged;
+	// Captured frames, timestamped by the grabber thread, waiting for the analysis loop in record().
+	FrameQueue<frameContainer> frameQueue;
+	// The buffers of the analyzed frames go back to the grabber thread, so reading the camera doesn't allocate.
+	FrameQueue<cv::Mat> spareFrames;
+	std::uint64_t reportedDrops;
+	// When the last stats were sent to the GUI, and how many frames were analyzed then, only used by record().
+	std::chrono::time_point<std::chrono::high_resolution_clock> lastStatsEvent;
+	std::uint64_t analyzedAtLastStats;
+
+	EventJournal journal;
+	std::uint64_t currentClip;  // the name of the video being recorded in the journal
+	std::chrono::time_point<std::chrono::high_resolution_clock> clipStart;
+	std::chrono::time_point<std::chrono::high_resolution_clock> lastJournalRecord;
+	// Frames waiting to be compressed into frameBackCapture, only used when the buffer is compressed.
+	FrameQueue<frameContainer> compressionQueue;
+	// How many of them are not in frameBackCapture yet, beginEvent() waits on compressionDone until it's 0.
+	std::size_t framesBeingCompressed;
+	std::mutex compressionMutex;
+	std::condition_variable compressionDone;
+	void sizeFrameBackCapture();
+	void grabFrames();
+	void compressFrames();
+	void finishCompression();
+	void reportDroppedFrames();
+	void sendStatsEvent(std::chrono::time_point<std::chrono::high_resolution_clock> now);
+	void writeJournal(std::chrono::time_point<std::chrono::high_resolution_clock> time, const DetectionConfig& config,
+	                  bool humanFound, bool faceFound);
+	void saveFrameToBuffer(frameContainer& container);
 	void clearExpiredFrames();
-	void saveToStream(cv::Mat frame, int x);
-	void saveVideo();
+	void saveToStream(const cv::Mat& frame);
+	void beginEvent(const cv::Mat& frame);
+	void endEvent();
 	void checkRecordingLength();
 	HumanFilter humanFilter;
 	FaceFilter faceFilter;
 	MotionFilter motionFilter;
+	// The grayscale, blurred and scaled copies of the current frame, shared by all of the filters.
+	FrameContext frameContext;
+	// The filters above only run on some frames, these follow what they found in between.
+	DetectionScheduler humanScheduler;
+	DetectionScheduler faceScheduler;
+	// The version of the detection settings the last frame was analyzed with, only used by record().
+	std::uint64_t configVersion;
 	const bool debug = false;
 };
 #endif
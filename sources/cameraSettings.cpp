@@ -0,0 +1,284 @@
+/**
+ * File Name:  cameraSettings.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This struct holds the settings of a single camera that are not global to the whole daemon.
+ * They are read from $SmartCCTV_Project_dir/settings/cameraN.yml when the Camera is created.
+ * Every setting that is missing from the file, or the whole file if it doesn't exist, keeps it's default value.
+ */
+
+#include "cameraSettings.hpp"
+#include <opencv2/core.hpp>
+#include <sys/stat.h>  /* for stat() */
+#include <syslog.h>    /* for syslog() */
+#include <cstdlib>     /* for getenv() */
+#include <string>      /* for std::string */
+
+using std::string;
+
+#define log_facility LOG_LOCAL0
+
+
+static OverflowPolicy parseOverflowPolicy(const string& name, OverflowPolicy defaultPolicy)
+{
+	if (name == "drop_oldest")
+	{
+		return OverflowPolicy::DropOldest;
+	}
+	else if (name == "drop_newest")
+	{
+		return OverflowPolicy::DropNewest;
+	}
+	else if (name == "block")
+	{
+		return OverflowPolicy::Block;
+	}
+
+	syslog(log_facility | LOG_WARNING, "Unknown frame_queue_policy %s, using the default", name.c_str());
+	return defaultPolicy;
+}
+
+
+static FrameCompression parseFrameCompression(const string& name, FrameCompression defaultCompression)
+{
+	if (name == "none")
+	{
+		return FrameCompression::None;
+	}
+	else if (name == "jpeg")
+	{
+		return FrameCompression::Jpeg;
+	}
+	else if (name == "yuv420")
+	{
+		return FrameCompression::Yuv420;
+	}
+
+	syslog(log_facility | LOG_WARNING, "Unknown buffer_compression %s, using the default", name.c_str());
+	return defaultCompression;
+}
+
+
+static VideoCodec parseVideoCodec(const string& name, VideoCodec defaultCodec)
+{
+	if (name == "mjpg")
+	{
+		return VideoCodec::Mjpg;
+	}
+	else if (name == "h264")
+	{
+		return VideoCodec::H264;
+	}
+	else if (name == "h265")
+	{
+		return VideoCodec::H265;
+	}
+
+	syslog(log_facility | LOG_WARNING, "Unknown video_codec %s, using the default", name.c_str());
+	return defaultCodec;
+}
+
+
+static TrackerType parseTrackerType(const string& name, TrackerType defaultType)
+{
+	if (name == "mosse")
+	{
+		return TrackerType::Mosse;
+	}
+	else if (name == "kcf")
+	{
+		return TrackerType::Kcf;
+	}
+
+	syslog(log_facility | LOG_WARNING, "Unknown tracker %s, using the default", name.c_str());
+	return defaultType;
+}
+
+
+static MotionAlgorithm parseMotionAlgorithm(const string& name, MotionAlgorithm defaultAlgorithm)
+{
+	if (name == "fused")
+	{
+		return MotionAlgorithm::Fused;
+	}
+	else if (name == "contours")
+	{
+		return MotionAlgorithm::Contours;
+	}
+	else if (name == "average")
+	{
+		return MotionAlgorithm::RunningAverage;
+	}
+	else if (name == "mog2")
+	{
+		return MotionAlgorithm::Mog2;
+	}
+
+	syslog(log_facility | LOG_WARNING, "Unknown motion_algorithm %s, using the default", name.c_str());
+	return defaultAlgorithm;
+}
+
+
+string cameraSettingsFileName(int cameraNumber)
+{
+	const char* SmartCCTV_Project_dir = getenv("SmartCCTV_Project_dir");
+	if (SmartCCTV_Project_dir == nullptr)
+	{
+		return string();
+	}
+
+	string fileName = SmartCCTV_Project_dir;
+	fileName += "/settings/camera" + std::to_string(cameraNumber) + ".yml";
+	return fileName;
+}
+
+
+CameraSettings loadCameraSettings(int cameraNumber, bool isMediaFile)
+{
+	CameraSettings settings;
+	settings.frameQueueCapacity = 8;
+	settings.frameQueuePolicy = isMediaFile ? OverflowPolicy::Block : OverflowPolicy::DropOldest;
+	settings.preRollSeconds = 10;
+	settings.recordingSeconds = 15;
+	settings.bufferCompression = FrameCompression::None;
+	settings.jpegQuality = 90;
+	settings.bufferMemoryBudget = 0;
+	settings.encoderThreads = 0;
+	settings.videoCodec = VideoCodec::Mjpg;
+	settings.videoPreset = "veryfast";
+	settings.videoCrf = 23;
+	settings.detectionInterval = 10;
+	settings.trackerType = TrackerType::Mosse;
+	settings.analysisScale = 1.0;
+	settings.motionAlgorithm = MotionAlgorithm::Fused;
+	settings.motionLearningRate = 0.01;
+	settings.httpPort = 0;
+	settings.httpAddress = "127.0.0.1";
+	settings.httpClientQueue = 2;
+
+	string fileName = cameraSettingsFileName(cameraNumber);
+	if (fileName.empty())
+	{
+		return settings;
+	}
+
+	// Not having a settings file is perfectly normal, only a file that exists but can't be read is an error.
+	struct stat fileInfo;
+	if (stat(fileName.c_str(), &fileInfo) == -1)
+	{
+		return settings;
+	}
+
+	cv::FileStorage storage(fileName, cv::FileStorage::READ);
+	if (!storage.isOpened())
+	{
+		syslog(log_facility | LOG_ERR, "Could not read the settings file %s, using the defaults", fileName.c_str());
+		return settings;
+	}
+
+	cv::FileNode node = storage["frame_queue_capacity"];
+	if (!node.empty() && (int) node > 0)
+	{
+		settings.frameQueueCapacity = (int) node;
+	}
+	node = storage["frame_queue_policy"];
+	if (!node.empty())
+	{
+		settings.frameQueuePolicy = parseOverflowPolicy((string) node, settings.frameQueuePolicy);
+	}
+
+	node = storage["pre_roll_seconds"];
+	if (!node.empty() && (int) node >= 0)
+	{
+		settings.preRollSeconds = (int) node;
+	}
+	node = storage["recording_seconds"];
+	if (!node.empty() && (int) node > 0)
+	{
+		settings.recordingSeconds = (int) node;
+	}
+
+	node = storage["buffer_compression"];
+	if (!node.empty())
+	{
+		settings.bufferCompression = parseFrameCompression((string) node, settings.bufferCompression);
+	}
+	node = storage["jpeg_quality"];
+	if (!node.empty() && (int) node >= 0 && (int) node <= 100)
+	{
+		settings.jpegQuality = (int) node;
+	}
+	node = storage["buffer_memory_budget_mb"];
+	if (!node.empty() && (int) node >= 0)
+	{
+		settings.bufferMemoryBudget = (std::size_t) (int) node * 1024 * 1024;
+	}
+	node = storage["encoder_threads"];
+	if (!node.empty() && (int) node >= 0)
+	{
+		settings.encoderThreads = (int) node;
+	}
+	node = storage["video_codec"];
+	if (!node.empty())
+	{
+		settings.videoCodec = parseVideoCodec((string) node, settings.videoCodec);
+	}
+	node = storage["video_preset"];
+	if (!node.empty())
+	{
+		settings.videoPreset = (string) node;
+	}
+	node = storage["video_crf"];
+	if (!node.empty() && (int) node >= 0 && (int) node <= 51)
+	{
+		settings.videoCrf = (int) node;
+	}
+	node = storage["detection_interval"];
+	if (!node.empty() && (int) node > 0)
+	{
+		settings.detectionInterval = (int) node;
+	}
+	node = storage["tracker"];
+	if (!node.empty())
+	{
+		settings.trackerType = parseTrackerType((string) node, settings.trackerType);
+	}
+	node = storage["analysis_scale"];
+	if (!node.empty() && (double) node > 0 && (double) node <= 1)
+	{
+		settings.analysisScale = (double) node;
+	}
+	node = storage["motion_algorithm"];
+	if (!node.empty())
+	{
+		settings.motionAlgorithm = parseMotionAlgorithm((string) node, settings.motionAlgorithm);
+	}
+	node = storage["motion_learning_rate"];
+	if (!node.empty() && (double) node > 0 && (double) node <= 1)
+	{
+		settings.motionLearningRate = (double) node;
+	}
+	node = storage["http_port"];
+	if (!node.empty() && (int) node >= 0 && (int) node <= 65535)
+	{
+		settings.httpPort = (int) node;
+	}
+	node = storage["http_address"];
+	if (!node.empty())
+	{
+		settings.httpAddress = (string) node;
+	}
+	node = storage["http_client_queue"];
+	if (!node.empty() && (int) node > 0)
+	{
+		settings.httpClientQueue = (int) node;
+	}
+
+	syslog(log_facility | LOG_NOTICE, "Loaded the settings file %s", fileName.c_str());
+	return settings;
+}
@@ -0,0 +1,111 @@
+/**
+ * File Name:  cameraSettings.hpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This struct holds the settings of a single camera that are not global to the whole daemon.
+ * They are read from $SmartCCTV_Project_dir/settings/cameraN.yml when the Camera is created.
+ * Every setting that is missing from the file, or the whole file if it doesn't exist, keeps it's default value.
+ */
+
+#ifndef CAMERASETTINGS_HPP
+#define CAMERASETTINGS_HPP
+
+#include <cstddef>
+#include <string>
+#include "frameQueue.hpp"
+#include "frameRing.hpp"
+
+enum class VideoCodec
+{
+	Mjpg,  // Motion JPEG in an AVI file, cheap to encode but about 10 times bigger
+	H264,  // H.264 in an MP4 file, encoded by FFmpeg (libx264)
+	H265   // H.265 in an MP4 file, encoded by FFmpeg (libx265), the smallest and the most expensive to encode
+};
+
+enum class TrackerType
+{
+	Mosse,  // the fastest, follows an object as long as it doesn't change it's look much
+	Kcf     // slower, but keeps up with objects that turn around or change their size
+};
+
+enum class MotionAlgorithm
+{
+	Fused,           // one SIMD pass over a half size frame that counts the changed pixels per tile
+	Contours,        // absdiff, threshold, dilate and findContours on the full frame, the reference the fused pass is compared to
+	RunningAverage,  // the fused pass against a running average of the past frames instead of just the last frame
+	Mog2             // OpenCV's MOG2 background model, a mixture of Gaussians per pixel that learns flickering lights
+};
+
+struct CameraSettings
+{
+	// How many captured frames may wait for the analysis thread.
+	std::size_t frameQueueCapacity;
+	// What the grabber thread does with a new frame when that many frames are already waiting.
+	// A camera can't wait for us so the default is to drop the oldest frame,
+	// but a media file can, so by default it is never allowed to skip frames.
+	OverflowPolicy frameQueuePolicy;
+	// How many seconds before a detection event are kept and saved into the clip.
+	int preRollSeconds;
+	// How many seconds are recorded after a detection event.
+	int recordingSeconds;
+	// How the buffered frames are kept in memory, compressing them saves memory but costs CPU.
+	FrameCompression bufferCompression;
+	// JPEG quality from 0 to 100, used when bufferCompression is Jpeg and for the event videos.
+	int jpegQuality;
+	// The most memory the buffered frames of this camera may take up, in bytes. 0 means no limit.
+	std::size_t bufferMemoryBudget;
+	// How many threads compress the frames of an event video, 0 means one per core.
+	int encoderThreads;
+	// The codec of the event videos.
+	VideoCodec videoCodec;
+	// The x264/x265 speed preset, from ultrafast to veryslow. Faster presets make bigger files.
+	// This and videoCrf are daemon-wide, the first camera that records H.264 or H.265 decides them.
+	std::string videoPreset;
+	// The x264/x265 constant rate factor, lower is better quality and bigger files.
+	int videoCrf;
+	// The human and face detectors run on every Nth frame, a tracker follows what they found in between.
+	// 1 runs the detectors on every frame.
+	int detectionInterval;
+	// The tracker that follows the detected humans and faces between two detections.
+	TrackerType trackerType;
+	// The detectors look at a copy of the frame that is scaled down by this factor, 1 is the full resolution.
+	// The recording and the outlines always keep the full resolution.
+	double analysisScale;
+	// How the motion detection compares two frames.
+	MotionAlgorithm motionAlgorithm;
+	// How much of each frame the background model of RunningAverage and Mog2 takes in, from 0 to 1.
+	double motionLearningRate;
+	// The port of the MJPEG over HTTP live stream of this camera, 0 turns it off.
+	int httpPort;
+	// The IP address the live stream listens on, 127.0.0.1 for this computer only or 0.0.0.0 for the LAN.
+	std::string httpAddress;
+	// How many frames may wait for an HTTP client before the frames of that client are dropped.
+	int httpClientQueue;
+};
+
+/**
+ * Reads the settings of one camera.
+ *
+ * @param int cameraNumber - The number of the camera, selects the file cameraN.yml
+ *
+ * @param bool isMediaFile - true if the camera is reading a media file instead of a device
+ *
+ * @return CameraSettings - The settings from the file, or the defaults.
+ */
+CameraSettings loadCameraSettings(int cameraNumber, bool isMediaFile);
+
+/**
+ * The name of the settings file of one camera, $SmartCCTV_Project_dir/settings/cameraN.yml
+ *
+ * @param int cameraNumber - The number of the camera
+ *
+ * @return std::string - The name of the file, or an empty string if $SmartCCTV_Project_dir is not set.
+ */
+std::string cameraSettingsFileName(int cameraNumber);
+
+#endif
@@ -17,14 +17,26 @@
 #include "camera_daemon.h"
 #include "low_level_cctv_daemon_apis.h"
 #include "camera.hpp"
-#include "write_message.h"
+#include "control_channel.h"
+#include "detectionConfig.hpp"
+#include "event_channel.h"
+#include "retentionManager.hpp"
 
 #include <sys/types.h>
-#include <signal.h>  /* for sigemptyset(), kill(), signal constants */
-#include <syslog.h>  /* for syslog() */
-#include <unistd.h>  /* for sleep() */
-#include <vector>    /* for std::vector */
-
+#include <sys/signalfd.h>  /* for signalfd(), struct signalfd_siginfo */
+#include <signal.h>   /* for sigemptyset(), signal constants */
+#include <pthread.h>  /* for pthread_sigmask() */
+#include <syslog.h>   /* for syslog() */
+#include <unistd.h>   /* for read(), close() */
+#include <cctype>     /* for isdigit() */
+#include <set>        /* for std::set */
+#include <string>     /* for std::string, std::stoi() */
+#include <thread>     /* for std::thread */
+#include <vector>     /* for std::vector */
+
+using std::set;
+using std::string;
+using std::thread;
 using std::vector;
 
 #pragma GCC diagnostic push
@@ -33,145 +45,230 @@ using std::vector;
 
 extern Daemon_data daemon_data;
 extern vector<Camera*> cameras;
+extern vector<string> camera_sources;
+
+// The number of each camera in cameras, the media files get one too.
+static vector<int> camera_numbers;
 
 void camera_daemon()
 {
     syslog(log_facility | LOG_NOTICE, "The camera daemon has started running.");
 
-    syslog(log_facility | LOG_NOTICE, "enable human detection: %d", daemon_data.enable_human_detection);
-    syslog(log_facility | LOG_NOTICE, "enable motion detection: %d", daemon_data.enable_motion_detection);
-    syslog(log_facility | LOG_NOTICE, "enable outlines: %d", daemon_data.enable_outlines);
-
-    daemon_data.is_live_stream_running = check_live_stream();
-    //syslog(log_facility | LOG_NOTICE, "daemon_data.is_live_stream_running = %d", daemon_data.is_live_stream_running);
-    //syslog(log_facility | LOG_NOTICE, "daemon_data.live_stream_viewer_pid = %d", daemon_data.live_stream_viewer_pid);
-
-    // This sets up the signal handler for when the LiveStream Viewer starts up.
-    struct sigaction action2;
-    action2.sa_handler = livestream_viewer_starts_up;
-    sigemptyset(&action2.sa_mask);
-    sigaddset(&action2.sa_mask, SIGTSTP);
-    sigaddset(&action2.sa_mask, SIGHUP);
-    sigaddset(&action2.sa_mask, SIGUSR1);
-    sigaddset(&action2.sa_mask, SIGUSR2);
-    sigaddset(&action2.sa_mask, SIGCONT);
-    sigaddset(&action2.sa_mask, SIGCHLD);
-    action2.sa_flags = 0;
-    sigaction(SIGUSR1, &action2, nullptr);
-
-    // This sets up the signal handler for when the LiveStream Viewer shuts down.
-    struct sigaction action3;
-    action3.sa_handler = livestream_viewer_shuts_down;
-    sigemptyset(&action3.sa_mask);
-    sigaddset(&action3.sa_mask, SIGTSTP);
-    sigaddset(&action3.sa_mask, SIGHUP);
-    sigaddset(&action3.sa_mask, SIGUSR1);
-    sigaddset(&action3.sa_mask, SIGUSR2);
-    sigaddset(&action3.sa_mask, SIGCONT);
-    sigaddset(&action3.sa_mask, SIGCHLD);
-    action3.sa_flags = 0;
-    sigaction(SIGUSR2, &action3, nullptr);
-
-    syslog(log_facility | LOG_NOTICE, "The camera%d is being used.", daemon_data.cameraNumber);
-
-    Camera cam(daemon_data.cameraNumber);
-    cameras.push_back(&cam);
-    // The LiveStream process recieves SIGUSR1 when the daemon starts up.
-    if (daemon_data.live_stream_viewer_pid) {
-        kill(daemon_data.live_stream_viewer_pid, SIGUSR1);
-    }
-    cam.record();
-	
-    syslog(log_facility | LOG_NOTICE, "The camera daemon has completed running.");
-
-    terminate_daemon(0);
-}
-
+    // The settings the daemon was started with are the first snapshot the cameras use.
+    // From then on the control channel can change them, without restarting the daemon.
+    DetectionConfig initial_config = *currentDetectionConfig();
+    initial_config.humanDetection = daemon_data.enable_human_detection;
+    initial_config.motionDetection = daemon_data.enable_motion_detection;
+    initial_config.outlines = daemon_data.enable_outlines;
+    publishDetectionConfig(initial_config);
 
-void livestream_viewer_starts_up(int)
-{
-    syslog(log_facility | LOG_NOTICE, "livestream_viewer_starts_up()");
-    daemon_data.is_live_stream_running = check_live_stream();
-}
-
-
-void livestream_viewer_shuts_down(int)
-{
-    syslog(log_facility | LOG_NOTICE, "livestream_viewer_shuts_down()");
+    // The live stream is only published while a LiveStream Viewer is subscribed on the control channel.
     daemon_data.is_live_stream_running = false;
-}
 
+    // The termination signals and SIGHUP are blocked before any camera thread is created.
+    // The threads inherit this signal mask, so only this thread ever recieves these signals,
+    // through the signalfd below, instead of the signal handler interrupting a camera in the middle of a frame.
+    // SIGHUP doesn't stop the daemon, it makes the cameras read their zones again.
+    sigset_t waited_signals;
+    sigemptyset(&waited_signals);
+    sigaddset(&waited_signals, SIGINT);
+    sigaddset(&waited_signals, SIGTERM);
+    sigaddset(&waited_signals, SIGQUIT);
+    sigaddset(&waited_signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &waited_signals, nullptr);
+    int signal_fd = signalfd(-1, &waited_signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd == -1) {
+        syslog(log_facility | LOG_ERR, "Error: Could not set up the signals : %m");
+        syslog(log_facility | LOG_CRIT, "SmartCCTV Daemon unexpected failure.");
+        send_gui_event(EVENT_DAEMON_FAILED, -1, "SmartCCTV unexpected failure.");
+        daemon_data.daemon_exit_status = EXIT_FAILURE;
+        terminate_daemon(0);
+    }
 
-bool check_live_stream()
-{
-    // The name of the LiveStream Viewer's PID file.
-    const char* livestream_pid_file_name = "/tmp/LiveStream_viewer_pid";
-    FILE* livestream_pid_file_pointer = nullptr;
-
-    // Try to open the PID file, check if the LiveStream Viewer is already running.
-    if ( (livestream_pid_file_pointer = fopen(livestream_pid_file_name, "r")) != nullptr) {
-        syslog(log_facility | LOG_NOTICE, "A PID file of LiveStream Viewer already exists.");
-        syslog(log_facility | LOG_NOTICE, "Checking if the LiveStream Viewer is running.");
+    // Camera numbers that are already taken, media files get the first free number.
+    set<int> used_camera_numbers;
+    for (const string& source : camera_sources) {
+        if (is_camera_number(source)) {
+            used_camera_numbers.insert(std::stoi(source));
+        }
+    }
 
-        char digit = '\0';
-        // Check if the PID file contains a valid process ID of the LiveStream viewer.
-        // Check if all the characters in the PID file are digits.
-        // Check if the PID file was not tampered.
-        while (true) {
-            digit = fgetc(livestream_pid_file_pointer);
+    // All the cameras are opened up front in this thread.
+    // If any of them can't be opened, terminate_daemon() is called before any camera thread exists.
+    int next_free_number = 0;
+    for (const string& source : camera_sources) {
+        if (is_camera_number(source)) {
+            int camera_number = std::stoi(source);
+            syslog(log_facility | LOG_NOTICE, "The camera%d is being used.", camera_number);
+            cameras.push_back(new Camera(camera_number));
+            camera_numbers.push_back(camera_number);
+        } else {
+            while (used_camera_numbers.count(next_free_number)) {
+                ++next_free_number;
+            }
+            used_camera_numbers.insert(next_free_number);
+            syslog(log_facility | LOG_NOTICE, "The media file %s is being used as camera%d.", source.c_str(), next_free_number);
+            cameras.push_back(new Camera(source, next_free_number));
+            camera_numbers.push_back(next_free_number);
+        }
+    }
 
-            if (digit == EOF)
-                break;
+    // The FFmpeg encoder options are in the environment, which may only be changed while this is the only thread.
+    // They are daemon-wide, the first camera that records H.264 or H.265 decides them.
+    const CameraSettings* ffmpeg_settings = nullptr;
+    for (size_t i = 0; i < cameras.size(); ++i) {
+        const CameraSettings& settings = cameras[i]->currentSettings();
+        if (settings.videoCodec == VideoCodec::Mjpg) {
+            continue;
+        }
+        if (ffmpeg_settings == nullptr) {
+            setFfmpegWriterOptions(settings);
+            ffmpeg_settings = &settings;
+        } else if (settings.videoPreset != ffmpeg_settings->videoPreset || settings.videoCrf != ffmpeg_settings->videoCrf) {
+            syslog(log_facility | LOG_WARNING,
+                   "camera%d records with the video_preset and video_crf of the first H.264 or H.265 camera instead of its own.",
+                   camera_numbers[i]);
+        }
+    }
 
-            if (digit == '\0' || digit == '\n')
-                continue;
+    // The old videos are deleted on a thread of their own, so that no camera waits for the disk.
+    RetentionManager::instance().start(string(daemon_data.home_directory) + "/SmartCCTV_recordings/", daemon_data.retention_days);
 
-            if (!isdigit(digit)) {
-                syslog(log_facility | LOG_ERR, "Error: Invalid PID file: text is not a process id");
-                syslog(log_facility | LOG_ERR, "Invalid PID file %s", livestream_pid_file_name);
+    // Each camera runs it's own capture and analysis loop on it's own thread.
+    vector<thread> camera_threads;
+    for (Camera* camera : cameras) {
+        camera_threads.emplace_back(&Camera::record, camera);
+    }
 
-                syslog(log_facility | LOG_ERR, "LiveStream PID file has been tampered.");
+    // The requests that came in while the cameras were being opened wait in the control socket, they are answered now.
+    bool stop_requested = false;
+    Control_server control_server(daemon_data.control_socket_fd, signal_fd,
+                                  [&stop_requested](const vector<string>& words) { return handle_control_request(words, stop_requested); });
+
+    // Answer the control channel until the daemon is told to shut down, or until every camera has stopped on it's own.
+    // The timeout lets this thread notice cameras that stopped because of an error.
+    while (!stop_requested) {
+        bool all_cameras_finished = true;
+        for (Camera* camera : cameras) {
+            all_cameras_finished = all_cameras_finished && camera->hasFinished();
+        }
+        if (all_cameras_finished) {
+            syslog(log_facility | LOG_NOTICE, "All of the cameras have stopped.");
+            break;
+        }
 
-                if (fclose(livestream_pid_file_pointer) == EOF) {
-                    syslog(log_facility | LOG_ERR, "Error: Could not close LiveStream PID file %s : %m", livestream_pid_file_name);
+        if (control_server.wait(1000)) {
+            struct signalfd_siginfo signal_info;
+            while (read(signal_fd, &signal_info, sizeof(signal_info)) == sizeof(signal_info)) {
+                if (signal_info.ssi_signo == SIGHUP) {
+                    syslog(log_facility | LOG_NOTICE, "Recieved SIGHUP, reloading the zones of the cameras.");
+                    for (Camera* camera : cameras) {
+                        camera->reloadZones();
+                    }
+                } else {
+                    syslog(log_facility | LOG_NOTICE, "Recieved signal %d, stopping the cameras.", signal_info.ssi_signo);
+                    stop_requested = true;
                 }
-
-                return false;
             }
         }
+        // A LiveStream Viewer that exits, or crashes, is unsubscribed when it's connection closes.
+        bool live_stream_running = control_server.subscriber_count() > 0;
+        if (live_stream_running != daemon_data.is_live_stream_running) {
+            syslog(log_facility | LOG_NOTICE, live_stream_running ? "A LiveStream Viewer subscribed to the live stream."
+                                                                   : "The LiveStream Viewer unsubscribed from the live stream.");
+            daemon_data.is_live_stream_running = live_stream_running;
+        }
+    }
 
-        int livestream_pid = 0;
-        fseek(livestream_pid_file_pointer, 0, SEEK_SET);
-        fscanf(livestream_pid_file_pointer, "%d", &livestream_pid);
+    for (Camera* camera : cameras) {
+        camera->stop();
+    }
+    for (thread& camera_thread : camera_threads) {
+        camera_thread.join();
+    }
 
-        // Check if the PID file contains a valid process ID of the LiveStream Viewer.
-        // If the PID file is indeed all digits, we must then make sure that it represents a valid process ID.
-        // kill() with a signal of 0, doesn't send a signal to the process, but it checks if that process exists.
-        // If that process doesn't exist, then kill() will return -1 and errno will be set.
-        // This only works if you're the user owning that process, or if you are the root user.
-        if (kill(livestream_pid, 0) == -1) {
-            syslog(log_facility | LOG_ERR, "Error: Invalid PID file: defunct process %d", livestream_pid);
-            syslog(log_facility | LOG_ERR, "Invalid PID file %s", livestream_pid_file_name);
+    syslog(log_facility | LOG_NOTICE, "The camera daemon has completed running.");
 
-            syslog(log_facility | LOG_ERR, "LiveStream PID file has been tampered.");
+    terminate_daemon(0);
+}
 
-            if (fclose(livestream_pid_file_pointer) == EOF) {
-                syslog(log_facility | LOG_ERR, "Error: Could not close LiveStream PID file %s : %m", livestream_pid_file_name);
-            }
 
+bool is_camera_number(const string& camera_source)
+{
+    if (camera_source.empty()) {
+        return false;
+    }
+    for (char character : camera_source) {
+        if (!isdigit(character)) {
             return false;
+        }
+    }
+    return true;
+}
 
-        // If that process does exist, it means that the LiveStream Viewer is running.
-        } else {
-            if (fclose(livestream_pid_file_pointer) == EOF) {
-                syslog(log_facility | LOG_ERR, "Error: Could not close PID file %s : %m", livestream_pid_file_name);
+
+string handle_control_request(const vector<string>& words, bool& stop_requested)
+{
+    const string& command = words[0];
+    if (command == "status" && words.size() == 1) {
+        int running = 0;
+        for (Camera* camera : cameras) {
+            running += camera->hasFinished() ? 0 : 1;
+        }
+        return "ok pid=" + std::to_string(daemon_data.camera_daemon_pid) +
+               " cameras=" + std::to_string(cameras.size()) +
+               " running=" + std::to_string(running) +
+               " live_stream=" + std::to_string(daemon_data.is_live_stream_running) +
+               " " + describeDetectionConfig(*currentDetectionConfig()) +
+               " " + RetentionManager::instance().describe();
+    }
+
+    if (command == "stats" && words.size() == 1) {
+        string response = "ok";
+        for (size_t i = 0; i < cameras.size(); ++i) {
+            CameraStats stats = cameras[i]->stats();
+            string name = " camera" + std::to_string(camera_numbers[i]) + ".";
+            response += name + "captured=" + std::to_string(stats.captured) +
+                        name + "dropped=" + std::to_string(stats.dropped) +
+                        name + "analyzed=" + std::to_string(stats.analyzed) +
+                        name + "events=" + std::to_string(stats.events) +
+                        name + "recording=" + std::to_string(stats.recording) +
+                        name + "finished=" + std::to_string(stats.finished) +
+                        name + "recordings_mb=" + std::to_string(RetentionManager::instance().cameraBytes(camera_numbers[i]) / (1024 * 1024));
+        }
+        return response;
+    }
+
+    if (command == "set" && words.size() == 3) {
+        string error;
+        // The retention settings belong to the retention manager, it applies them right away.
+        if (words[1].compare(0, 10, "retention_") == 0) {
+            if (!RetentionManager::instance().setSetting(words[1], words[2], error)) {
+                return "error " + error;
             }
-            daemon_data.live_stream_viewer_pid = livestream_pid;
-            return true;
+            return "ok";
         }
-    } else {
-        return false;
+        // The cameras take the new snapshot before their next frame, the frame they are analyzing keeps the old one.
+        if (!setDetectionSetting(words[1], words[2], error)) {
+            return "error " + error;
+        }
+        return "ok config_version=" + std::to_string(currentDetectionConfig()->version);
+    }
+
+    if (command == "reload_zones" && words.size() == 1) {
+        for (Camera* camera : cameras) {
+            camera->reloadZones();
+        }
+        return "ok";
     }
+
+    if (command == "stop" && words.size() == 1) {
+        syslog(log_facility | LOG_NOTICE, "The control channel asked to stop, stopping the cameras.");
+        stop_requested = true;
+        return "ok";
+    }
+
+    return "error unknown request " + command;
 }
 
 
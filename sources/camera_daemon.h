@@ -15,6 +15,9 @@
 #ifndef CAMERA_DAEMON_H
 #define CAMERA_DAEMON_H
 
+#include <string>  /* for std::string */
+#include <vector>  /* for std::vector */
+
 /**
  * This function is run when the camera daemon starts up.
  * The camera daemon remains in this function for it's entire life time.
@@ -22,39 +25,40 @@
  * The daemon runs in the background forever, unless it gets shut down from
  * the command line.
  *
+ * One Camera is created for every entry of camera_sources, and each Camera records on it's own thread.
+ * This thread answers the requests of the control channel and waits for the termination signals,
+ * then it stops all the cameras and terminates the daemon.
+ *
  * Put any code that you want the camera daemon to execute in this function.
  */
 void camera_daemon();
 
 
 /**
- * The camera daemon process recieves SIGUSR1 when the livestream viewer starts up.
- * This function handles that signal.
- * It tells SmartCCTV Camera to start saving images into the livestream directory.
- */
-void livestream_viewer_starts_up(int);
-
-
-/**
- * The camera daemon process recieves SIGUSR2 when the livestream viewer shuts down.
- * This function handles that signal.
- * It tells SmartCCTV Camera to stop saving images into the livestream directory.
+ * This is a helper function for the camera daemon.
+ * It checks if an entry of camera_sources is a camera number or the path to a media file.
+ *
+ * @param const std::string& camera_source - The entry to check.
+ *
+ * @return bool - true if the entry is made up only of digits
+ *                false otherwise
  */
-void livestream_viewer_shuts_down(int);
+bool is_camera_number(const std::string& camera_source);
 
 
 /**
  * This is a helper function for the camera daemon.
- * It checks to se if the LiveStream Viewer process is running or not.
+ * It answers a request from the control channel, other than subscribe and unsubscribe,
+ * which the Control_server handles itself. See control_channel.h for the requests.
+ * It is called on the thread that waits for the signals, so it never races with them.
+ *
+ * @param const std::vector<std::string>& words - The words of the request.
  *
- * if the LiveStream Viewer process is currently running:
- *   daemon_data.live_stream_viewer_pid is set to the PID of the LiveStream Viewer process
- *   @return true
+ * @param bool& stop_requested - Set to true by the stop request.
  *
- * if the LiveStream Viewer process is not currently running:
- *   @return false
+ * @return std::string - The answer, "ok ..." or "error ...".
  */
-bool check_live_stream();
+std::string handle_control_request(const std::vector<std::string>& words, bool& stop_requested);
 
 
 #endif  /* CAMERA_DAEMON_H */
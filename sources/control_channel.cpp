@@ -0,0 +1,327 @@
+/**
+ * File Name:   control_channel.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This file contains the definitions of the control channel of the SmartCCTV Daemon,
+ * the unix domain socket that the GUI and the LiveStream Viewer send their requests to.
+ */
+
+#include "control_channel.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>   /* for socket(), bind(), listen(), accept4(), connect(), send(), recv() */
+#include <sys/un.h>       /* for struct sockaddr_un */
+#include <sys/epoll.h>    /* for epoll_create1(), epoll_ctl(), epoll_wait() */
+#include <unistd.h>       /* for close(), getuid() */
+#include <poll.h>         /* for poll() */
+#include <errno.h>        /* for errno */
+#include <syslog.h>       /* for syslog() */
+#include <cstddef>        /* for offsetof() */
+#include <algorithm>      /* for std::min() */
+#include <cstring>        /* for memcpy() */
+#include <sstream>        /* for std::istringstream */
+
+using std::string;
+using std::vector;
+
+const char* const daemon_control_socket = "SmartCCTV_daemon";
+const char* const livestream_lock_socket = "SmartCCTV_LiveStream_viewer";
+
+// A request longer than this is not a request, the client is disconnected.
+static const size_t max_request_length = 512;
+// A client that doesn't read it's answers is disconnected when this much is waiting for it.
+static const size_t max_output_length = 64 * 1024;
+
+
+/**
+ * Fills in the address of the socket with the given name in the abstract namespace,
+ * which starts with a '\0' instead of a path. The abstract namespace is shared by all of the users
+ * of the host, so the uid is added to the name, like SmartCCTV_daemon.1000,
+ * and every user has their own daemon and LiveStream Viewer.
+ */
+static socklen_t control_address(const char* name, struct sockaddr_un& address)
+{
+    string full_name = string(name) + "." + std::to_string(getuid());
+    address = {};
+    address.sun_family = AF_UNIX;
+    size_t length = std::min(full_name.size(), sizeof(address.sun_path) - 1);
+    memcpy(address.sun_path + 1, full_name.data(), length);
+    return offsetof(struct sockaddr_un, sun_path) + 1 + length;
+}
+
+
+int bind_control_socket(const char* name, bool listening)
+{
+    int socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (socket_fd == -1) {
+        return -1;
+    }
+    struct sockaddr_un address;
+    socklen_t length = control_address(name, address);
+    if (bind(socket_fd, reinterpret_cast<struct sockaddr*>(&address), length) == -1 ||
+        (listening && listen(socket_fd, 16) == -1)) {
+        int error = errno;
+        close(socket_fd);
+        errno = error;
+        return -1;
+    }
+    return socket_fd;
+}
+
+
+int connect_control_socket(const char* name)
+{
+    int socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (socket_fd == -1) {
+        return -1;
+    }
+    struct sockaddr_un address;
+    socklen_t length = control_address(name, address);
+    if (connect(socket_fd, reinterpret_cast<struct sockaddr*>(&address), length) == -1) {
+        close(socket_fd);
+        return -1;
+    }
+
+    // Any user can bind any name in the abstract namespace, even the one with our uid in it,
+    // so the requests and the live stream are only trusted to a process of our own user.
+    struct ucred credentials;
+    socklen_t credentials_length = sizeof(credentials);
+    if (getsockopt(socket_fd, SOL_SOCKET, SO_PEERCRED, &credentials, &credentials_length) == -1 ||
+        credentials.uid != getuid()) {
+        syslog(log_facility | LOG_WARNING, "Refused to use the control socket %s, it belongs to another user", name);
+        close(socket_fd);
+        return -1;
+    }
+    return socket_fd;
+}
+
+
+bool control_request(const char* name, const string& request, string& response, int timeout)
+{
+    int socket_fd = connect_control_socket(name);
+    if (socket_fd == -1) {
+        return false;
+    }
+
+    string line = request + "\n";
+    if (send(socket_fd, line.data(), line.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(line.size())) {
+        close(socket_fd);
+        return false;
+    }
+
+    // The answer is one line, it is read until the newline.
+    response.clear();
+    char buffer[256];
+    while (true) {
+        struct pollfd ready = { socket_fd, POLLIN, 0 };
+        if (poll(&ready, 1, timeout) <= 0) {
+            break;
+        }
+        ssize_t received = recv(socket_fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            break;
+        }
+        response.append(buffer, received);
+        size_t end = response.find('\n');
+        if (end != string::npos) {
+            response.erase(end);
+            close(socket_fd);
+            return true;
+        }
+    }
+    close(socket_fd);
+    return false;
+}
+
+
+Control_server::Control_server(int listen_fd, int signal_fd, Request_handler handler)
+ : listen_fd(listen_fd), signal_fd(signal_fd), epoll_fd(epoll_create1(EPOLL_CLOEXEC)), handler(handler), subscribers(0)
+{
+    for (int fd : { listen_fd, signal_fd }) {
+        struct epoll_event watch = {};
+        watch.events = EPOLLIN;
+        watch.data.fd = fd;
+        if (epoll_fd == -1 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &watch) == -1) {
+            syslog(log_facility | LOG_ERR, "Error: Could not set up the control channel : %m");
+        }
+    }
+}
+
+
+Control_server::~Control_server()
+{
+    for (auto& client : clients) {
+        close(client.first);
+    }
+    close(listen_fd);
+    if (epoll_fd != -1) {
+        close(epoll_fd);
+    }
+}
+
+
+bool Control_server::wait(int timeout)
+{
+    struct epoll_event ready[16];
+    int count = epoll_wait(epoll_fd, ready, 16, timeout);
+    bool signal_ready = false;
+    for (int i = 0; i < count; i++) {
+        int fd = ready[i].data.fd;
+        if (fd == signal_fd) {
+            signal_ready = true;
+        } else if (fd == listen_fd) {
+            accept_clients();
+        } else {
+            auto client = clients.find(fd);
+            if (client == clients.end()) {
+                continue;
+            }
+            bool keep = !(ready[i].events & EPOLLERR);
+            if (keep && (ready[i].events & (EPOLLIN | EPOLLHUP))) {
+                keep = read_requests(fd, client->second);
+            }
+            if (keep && (ready[i].events & EPOLLOUT)) {
+                keep = write_answers(fd, client->second);
+            }
+            if (!keep) {
+                close_client(fd);
+            }
+        }
+    }
+    return signal_ready;
+}
+
+
+size_t Control_server::subscriber_count() const
+{
+    return subscribers;
+}
+
+
+void Control_server::accept_clients()
+{
+    while (true) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            return;
+        }
+
+        // The abstract namespace has no file permissions, so the user is checked here instead.
+        struct ucred credentials;
+        socklen_t length = sizeof(credentials);
+        if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == -1 ||
+            (credentials.uid != getuid() && credentials.uid != 0)) {
+            syslog(log_facility | LOG_WARNING, "Refused a control connection from another user");
+            close(fd);
+            continue;
+        }
+
+        struct epoll_event watch = {};
+        watch.events = EPOLLIN;
+        watch.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &watch) == -1) {
+            close(fd);
+            continue;
+        }
+        clients[fd] = Client{ string(), string(), false };
+    }
+}
+
+
+bool Control_server::read_requests(int fd, Client& client)
+{
+    char buffer[512];
+    ssize_t received;
+    while ( (received = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        client.input.append(buffer, received);
+    }
+    bool connected = received == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+
+    size_t end;
+    while ( (end = client.input.find('\n')) != string::npos) {
+        std::istringstream line(client.input.substr(0, end));
+        client.input.erase(0, end + 1);
+
+        vector<string> words;
+        string word;
+        while (line >> word) {
+            words.push_back(word);
+        }
+        if (words.empty()) {
+            continue;
+        }
+
+        if (words[0] == "subscribe") {
+            if (!client.subscribed) {
+                client.subscribed = true;
+                subscribers++;
+            }
+            client.output += "ok\n";
+        } else if (words[0] == "unsubscribe") {
+            if (client.subscribed) {
+                client.subscribed = false;
+                subscribers--;
+            }
+            client.output += "ok\n";
+        } else {
+            client.output += handler(words) + "\n";
+        }
+    }
+    if (client.input.size() > max_request_length) {
+        syslog(log_facility | LOG_WARNING, "Disconnected a control client that sent a request that is too long");
+        return false;
+    }
+
+    // The answers are sent even if the client already closed it's end for writing.
+    return write_answers(fd, client) && connected;
+}
+
+
+bool Control_server::write_answers(int fd, Client& client)
+{
+    while (!client.output.empty()) {
+        ssize_t sent = send(fd, client.output.data(), client.output.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                return false;
+            }
+            break;
+        }
+        client.output.erase(0, sent);
+    }
+    if (client.output.size() > max_output_length) {
+        syslog(log_facility | LOG_WARNING, "Disconnected a control client that doesn't read the answers");
+        return false;
+    }
+
+    // EPOLLOUT is only watched while there is something waiting to be sent.
+    struct epoll_event watch = {};
+    watch.events = client.output.empty() ? EPOLLIN : EPOLLIN | EPOLLOUT;
+    watch.data.fd = fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &watch);
+    return true;
+}
+
+
+void Control_server::close_client(int fd)
+{
+    auto client = clients.find(fd);
+    if (client == clients.end()) {
+        return;
+    }
+    // A LiveStream Viewer that crashed is unsubscribed just the same as one that closed normally.
+    if (client->second.subscribed) {
+        subscribers--;
+    }
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    clients.erase(client);
+}
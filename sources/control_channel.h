@@ -0,0 +1,152 @@
+/**
+ * File Name:   control_channel.h
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This file contains the declarations of the control channel of the SmartCCTV Daemon.
+ * The daemon listens on a unix domain socket, and the GUI and the LiveStream Viewer send it requests,
+ * one line of text each, and get back one line of text that starts with "ok" or "error":
+ *
+ *   status                        - ok pid=1234 cameras=2 running=2 live_stream=1 config_version=1 human_detection=1 ...
+ *                                   retention_days=7 ... recordings_mb=5120 videos=212
+ *   subscribe                     - ok, the daemon publishes the live stream for as long as this connection is open
+ *   unsubscribe                   - ok, the connection no longer counts as a viewer
+ *   set <setting> <value>         - ok config_version=2, turns human_detection, motion_detection or outlines on or off (0|1),
+ *                                   or changes detection_interval or motion_threshold, from the next frame on
+ *                                 - ok, changes retention_days, retention_quota_mb or retention_min_free_mb right away
+ *   stats                         - ok camera0.captured=1200 camera0.dropped=3 ...
+ *   reload_zones                  - ok, the cameras read their zones again
+ *   stop                          - ok, the daemon stops the cameras and turns off
+ *
+ * The sockets are in the abstract namespace, so there is no file that can be left behind or tampered with.
+ * The uid of the user is part of their names, every user of the host runs their own daemon.
+ * Binding the socket of the daemon is what keeps a second daemon from starting, and the same goes for the
+ * LiveStream Viewer, the kernel frees them when the process ends, however it ends.
+ * Only the processes of the same user as the daemon, and root, are answered,
+ * and the GUI and the LiveStream Viewer only talk to a socket that is bound by their own user.
+ */
+
+#ifndef CONTROL_CHANNEL_H
+#define CONTROL_CHANNEL_H
+
+#include <cstddef>     /* for std::size_t */
+#include <functional>  /* for std::function */
+#include <map>         /* for std::map */
+#include <string>      /* for std::string */
+#include <vector>      /* for std::vector */
+
+// You can change this to make the syslog() output to a different file.
+#define log_facility LOG_LOCAL0
+
+// The name of the socket the SmartCCTV Daemon listens on, the uid of the user is added to it.
+extern const char* const daemon_control_socket;
+// The name of the socket the LiveStream Viewer holds while it is running, the uid of the user is added to it.
+extern const char* const livestream_lock_socket;
+
+
+/**
+ * This function binds a unix domain socket with the given name in the abstract namespace.
+ * Only one process can have a name at a time, so this also tells if the process that has it is running.
+ *
+ * @param const char* name - The name of the socket, like daemon_control_socket.
+ *
+ * @param bool listening - true to listen for connections on the socket, false to only hold the name.
+ *
+ * @return int - The socket, or -1 if it failed. errno is EADDRINUSE if another process has the name.
+ */
+int bind_control_socket(const char* name, bool listening);
+
+/**
+ * This function connects to the socket with the given name.
+ *
+ * @param const char* name - The name of the socket, like daemon_control_socket.
+ *
+ * @return int - The connected socket, or -1 if nobody is listening on it,
+ *               or if the process listening on it belongs to another user.
+ */
+int connect_control_socket(const char* name);
+
+/**
+ * This function sends one request to the socket with the given name, and waits for the answer.
+ *
+ * @param const char* name - The name of the socket, like daemon_control_socket.
+ *
+ * @param const std::string& request - The request, without the newline at the end.
+ *
+ * @param std::string& response - The answer, without the newline at the end.
+ *
+ * @param int timeout - How many milliseconds to wait for the answer.
+ *
+ * @return bool - true if there was an answer
+ *                false if nobody is listening on the socket, or it didn't answer in time
+ */
+bool control_request(const char* name, const std::string& request, std::string& response, int timeout = 2000);
+
+
+/**
+ * The daemon's side of the control channel.
+ * It answers the requests on the daemon's thread that waits for the signals, so the requests never race
+ * with the signals or with each other. subscribe is handled here, the other requests by the handler.
+ */
+class Control_server {
+  public:
+    // Gets the words of a request, and returns the answer without the newline at the end.
+    typedef std::function<std::string(const std::vector<std::string>& words)> Request_handler;
+
+    /**
+     * @param int listen_fd - The socket from bind_control_socket(), the server closes it.
+     *
+     * @param int signal_fd - A signalfd, wait() returns as soon as it can be read.
+     *
+     * @param Request_handler handler - Answers the requests, other than subscribe and unsubscribe.
+     */
+    Control_server(int listen_fd, int signal_fd, Request_handler handler);
+
+    /**
+     * The destructor disconnects all of the clients.
+     */
+    ~Control_server();
+
+    Control_server(const Control_server&) = delete;
+    Control_server& operator=(const Control_server&) = delete;
+
+    /**
+     * This function waits for requests and answers them, until the signal_fd can be read or the time is up.
+     *
+     * @param int timeout - How many milliseconds to wait.
+     *
+     * @return bool - true if the signal_fd can be read.
+     */
+    bool wait(int timeout);
+
+    /**
+     * @return std::size_t - How many clients have subscribed to the live stream and are still connected.
+     */
+    std::size_t subscriber_count() const;
+
+  private:
+    struct Client {
+        std::string input;   // What was read, up to the end of the request that is not complete yet.
+        std::string output;  // The answers the socket didn't take yet.
+        bool subscribed;
+    };
+
+    void accept_clients();
+    bool read_requests(int fd, Client& client);
+    bool write_answers(int fd, Client& client);
+    void close_client(int fd);
+
+    int listen_fd;
+    int signal_fd;
+    int epoll_fd;
+    Request_handler handler;
+    std::map<int, Client> clients;
+    std::size_t subscribers;
+};
+
+
+#endif  /* CONTROL_CHANNEL_H */
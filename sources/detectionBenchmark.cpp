@@ -0,0 +1,126 @@
+/**
+ * File Name:  detectionBenchmark.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This program measures what the analysis_scale setting trades. It runs the human detector over
+ * the frames of a video at 1x, 0.5x and 0.25x and prints how many frames per second each scale manages,
+ * and how many of the humans found at 1x are still found (the recall, with 1x as the reference).
+ * It is built with "make benchmark" and is not part of SmartCCTV itself.
+ *
+ * Usage:  detectionBenchmark video [frames]
+ */
+
+#include "low_level_cctv_daemon_apis.h"
+#include "humanFilter.hpp"
+#include "detectionScheduler.hpp"
+#include <opencv2/videoio.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// The filters read the daemon's settings, the benchmark has no daemon so it has it's own.
+Daemon_data daemon_data = {};
+
+
+// How many of the reference boxes have a box in found that covers at least half of their union.
+static std::size_t matchedBoxes(const std::vector<cv::Rect>& reference, const std::vector<cv::Rect>& found)
+{
+	std::size_t matched = 0;
+	for(const cv::Rect& expected : reference)
+	{
+		for(const cv::Rect& box : found)
+		{
+			double overlap = (expected & box).area();
+			if(overlap / (expected.area() + box.area() - overlap) >= 0.5)
+			{
+				matched++;
+				break;
+			}
+		}
+	}
+	return matched;
+}
+
+
+int main(int argc, char* argv[])
+{
+	if(argc < 2)
+	{
+		std::fprintf(stderr, "Usage: %s video [frames]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	int maxFrames = argc > 2 ? std::atoi(argv[2]) : 300;
+
+	std::vector<cv::Mat> frames;
+	cv::VideoCapture video(argv[1]);
+	cv::Mat frame;
+	while((int) frames.size() < maxFrames && video.read(frame))
+	{
+		frames.push_back(frame.clone());
+	}
+	if(frames.empty())
+	{
+		std::fprintf(stderr, "Could not read any frames from %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	HumanFilter humanFilter;
+	FrameContext context;
+	std::vector<cv::Rect> wholeFrame(1, cv::Rect(0, 0, frames[0].cols, frames[0].rows));
+	// Without the outlines, so the frames stay the same for every scale.
+	const DetectionConfig config = { 0, true, true, false, 0, 25 };
+	const double scales[] = { 1.0, 0.5, 0.25 };
+	// The boxes found at 1x, for every frame.
+	std::vector<std::vector<cv::Rect>> reference;
+
+	std::printf("%zu frames of %dx%d\n", frames.size(), frames[0].cols, frames[0].rows);
+	std::printf("%6s %10s %8s %14s %14s\n", "scale", "fps", "speedup", "frame recall", "box recall");
+	double baselineSeconds = 0;
+	for(double scale : scales)
+	{
+		// Interval 1 runs the detector on every frame, the trackers would hide the cost being measured.
+		DetectionScheduler scheduler([&humanFilter](FrameContext& context, double scale, const cv::Rect& region, std::vector<cv::Rect>& humans)
+		                             { humanFilter.detect(context.scaled(scale)(region), humans); },
+		                             1, TrackerType::Mosse, cv::Size(64, 128), scale, cv::Scalar(0, 255, 0));
+		std::size_t framesWithHumans = 0, framesFound = 0, boxesExpected = 0, boxesFound = 0;
+
+		auto begin = std::chrono::steady_clock::now();
+		for(std::size_t i = 0; i < frames.size(); i++)
+		{
+			context.reset(frames[i]);
+			scheduler.runRecognition(context, wholeFrame, config);
+			if(scale == 1.0)
+			{
+				reference.push_back(scheduler.objects());
+				continue;
+			}
+			if(!reference[i].empty())
+			{
+				framesWithHumans++;
+				framesFound += scheduler.objects().empty() ? 0 : 1;
+				boxesExpected += reference[i].size();
+				boxesFound += matchedBoxes(reference[i], scheduler.objects());
+			}
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+		if(scale == 1.0)
+		{
+			baselineSeconds = seconds;
+			std::printf("%6.2f %10.1f %7.2fx %14s %14s\n", scale, frames.size() / seconds, 1.0, "reference", "reference");
+			continue;
+		}
+
+		double frameRecall = framesWithHumans > 0 ? 100.0 * framesFound / framesWithHumans : 100.0;
+		double boxRecall = boxesExpected > 0 ? 100.0 * boxesFound / boxesExpected : 100.0;
+		std::printf("%6.2f %10.1f %7.2fx %13.1f%% %13.1f%%\n", scale, frames.size() / seconds, baselineSeconds / seconds,
+		            frameRecall, boxRecall);
+	}
+
+	return EXIT_SUCCESS;
+}
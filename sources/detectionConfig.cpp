@@ -0,0 +1,132 @@
+/**
+ * File Name:  detectionConfig.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This struct holds the detection settings of the daemon that can be changed while the cameras are running.
+ * The snapshot is swapped with std::atomic_store(), so the cameras never take a lock to read it,
+ * and a camera that is still using the old snapshot keeps it alive until it takes the next one.
+ */
+
+#include "detectionConfig.hpp"
+#include <syslog.h>  /* for syslog() */
+#include <cerrno>    /* for errno */
+#include <cstdlib>   /* for strtol() */
+#include <mutex>
+#include <string>
+
+using std::string;
+
+#define log_facility LOG_LOCAL0
+
+// The defaults are the settings the daemon had before they could be changed, until the daemon publishes it's own.
+static std::shared_ptr<const DetectionConfig> currentConfig = std::make_shared<const DetectionConfig>(DetectionConfig{ 0, true, true, true, 0, 25 });
+// Only serializes the publishers with each other, so that two changes at once don't lose one of them.
+static std::mutex publishMutex;
+
+
+std::shared_ptr<const DetectionConfig> currentDetectionConfig()
+{
+	return std::atomic_load(&currentConfig);
+}
+
+
+// Called with publishMutex locked, so the version numbers follow each other.
+static std::shared_ptr<const DetectionConfig> publishLocked(const DetectionConfig& config)
+{
+	std::shared_ptr<DetectionConfig> published = std::make_shared<DetectionConfig>(config);
+	published->version = std::atomic_load(&currentConfig)->version + 1;
+	std::atomic_store(&currentConfig, std::shared_ptr<const DetectionConfig>(published));
+	syslog(log_facility | LOG_NOTICE, "Detection settings version %llu: %s", (unsigned long long) published->version,
+	       describeDetectionConfig(*published).c_str());
+	return published;
+}
+
+
+std::shared_ptr<const DetectionConfig> publishDetectionConfig(const DetectionConfig& config)
+{
+	std::lock_guard<std::mutex> lock(publishMutex);
+	return publishLocked(config);
+}
+
+
+// Reads a whole decimal number from minimum to maximum, returns false if value is anything else.
+static bool parseSetting(const string& value, long minimum, long maximum, long& number)
+{
+	if(value.empty())
+	{
+		return false;
+	}
+	char* end = nullptr;
+	errno = 0;
+	number = strtol(value.c_str(), &end, 10);
+	return errno == 0 && *end == '\0' && number >= minimum && number <= maximum;
+}
+
+
+bool setDetectionSetting(const string& name, const string& value, string& error)
+{
+	long number = 0;
+	bool isSwitch = name == "human_detection" || name == "motion_detection" || name == "outlines";
+	if(isSwitch && !parseSetting(value, 0, 1, number))
+	{
+		error = value + " is not 0 or 1";
+		return false;
+	}
+	if(name == "detection_interval" && !parseSetting(value, 0, 1000, number))
+	{
+		error = value + " is not a detection interval from 0 to 1000";
+		return false;
+	}
+	if(name == "motion_threshold" && !parseSetting(value, 0, 255, number))
+	{
+		error = value + " is not a motion threshold from 0 to 255";
+		return false;
+	}
+
+	// The change is made to a copy of the current settings under the lock, so a change at the same time is not lost.
+	std::lock_guard<std::mutex> lock(publishMutex);
+	DetectionConfig config = *std::atomic_load(&currentConfig);
+	if(name == "human_detection")
+	{
+		config.humanDetection = number != 0;
+	}
+	else if(name == "motion_detection")
+	{
+		config.motionDetection = number != 0;
+	}
+	else if(name == "outlines")
+	{
+		config.outlines = number != 0;
+	}
+	else if(name == "detection_interval")
+	{
+		config.detectionInterval = (int) number;
+	}
+	else if(name == "motion_threshold")
+	{
+		config.motionThreshold = (int) number;
+	}
+	else
+	{
+		error = "unknown setting " + name;
+		return false;
+	}
+	publishLocked(config);
+	return true;
+}
+
+
+string describeDetectionConfig(const DetectionConfig& config)
+{
+	return "config_version=" + std::to_string(config.version) +
+	       " human_detection=" + std::to_string(config.humanDetection) +
+	       " motion_detection=" + std::to_string(config.motionDetection) +
+	       " outlines=" + std::to_string(config.outlines) +
+	       " detection_interval=" + std::to_string(config.detectionInterval) +
+	       " motion_threshold=" + std::to_string(config.motionThreshold);
+}
@@ -0,0 +1,77 @@
+/**
+ * File Name:  detectionConfig.hpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This struct holds the detection settings of the daemon that can be changed while the cameras are running.
+ * The settings are published as a snapshot that never changes, a change publishes a whole new snapshot.
+ * Each camera takes the current snapshot once before every frame, so a frame is analyzed with one set of settings
+ * from start to end, and a change takes effect with the next frame, without restarting the daemon.
+ */
+
+#ifndef DETECTIONCONFIG_HPP
+#define DETECTIONCONFIG_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct DetectionConfig
+{
+	// Goes up by one with every published change, the first snapshot is version 0.
+	std::uint64_t version;
+	bool humanDetection;
+	bool motionDetection;
+	bool outlines;
+	// The human and face detectors run on every Nth frame, 0 keeps the detectionInterval of each camera's settings.
+	int detectionInterval;
+	// A pixel moved if it changed by more than this, from 0 to 255.
+	int motionThreshold;
+};
+
+/**
+ * The detection settings in effect right now. Can be called from any thread.
+ *
+ * @return std::shared_ptr<const DetectionConfig> - The current snapshot, it stays valid for as long as it is held.
+ */
+std::shared_ptr<const DetectionConfig> currentDetectionConfig();
+
+/**
+ * Publishes new detection settings, the cameras use them from their next frame. Can be called from any thread.
+ *
+ * @param const DetectionConfig& config - The new settings, the version is ignored.
+ *
+ * @return std::shared_ptr<const DetectionConfig> - The published snapshot, with the version after the current one.
+ */
+std::shared_ptr<const DetectionConfig> publishDetectionConfig(const DetectionConfig& config);
+
+/**
+ * Publishes the current detection settings with one of them changed.
+ * The settings are human_detection, motion_detection and outlines (0 or 1),
+ * detection_interval (0 to 1000, 0 for each camera's own) and motion_threshold (0 to 255).
+ *
+ * @param const std::string& name - The name of the setting.
+ *
+ * @param const std::string& value - The new value, as text.
+ *
+ * @param std::string& error - Why the setting was not changed, only set if it returns false.
+ *
+ * @return bool - true if the change was published
+ *                false if there is no such setting or the value is not valid for it
+ */
+bool setDetectionSetting(const std::string& name, const std::string& value, std::string& error);
+
+/**
+ * The settings as text, for the status request of the control channel.
+ *
+ * @param const DetectionConfig& config - The settings.
+ *
+ * @return std::string - config_version=3 human_detection=1 motion_detection=1 outlines=0 ...
+ */
+std::string describeDetectionConfig(const DetectionConfig& config);
+
+#endif
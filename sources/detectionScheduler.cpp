@@ -0,0 +1,243 @@
+/**
+ * File Name:  detectionScheduler.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class decides on which frames a detector (HumanFilter or FaceFilter) really runs.
+ * The detectors are the most expensive part of the analysis, so they only run every Nth frame,
+ * and in between the boxes they found are followed by a cheap tracker (MOSSE or KCF).
+ * As soon as a tracker loses it's object, the detector runs again on the next frame.
+ * The detector only looks at the areas of the frame that moved, padded and merged together,
+ * so on a mostly still scene it's cost follows the amount of motion instead of the size of the frame.
+ * The detector can also look at a downscaled copy of the frame, the boxes are mapped back to the full frame.
+ * Each instance of this class is to correspond to a single detector of a single camera.
+ */
+
+#include "detectionScheduler.hpp"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <utility>
+
+
+
+DetectionScheduler::DetectionScheduler(Detector detector, int detectionInterval, TrackerType trackerType,
+                                       cv::Size minRegionSize, double analysisScale, cv::Scalar outlineColor, ZoneMask* zones)
+ : detector(std::move(detector)), detectionInterval(detectionInterval > 1 ? detectionInterval : 1),
+   trackerType(trackerType), minRegionSize(minRegionSize),
+   analysisScale(analysisScale > 0 && analysisScale < 1 ? analysisScale : 1), outlineColor(outlineColor),
+   zones(zones), framesSinceDetection(0), detectionDue(false), detections(0), frames(0)
+{
+	// The first frame is always a detection.
+	framesSinceDetection = this->detectionInterval;
+}
+
+
+cv::Ptr<cv::Tracker> DetectionScheduler::createTracker() const
+{
+	if(trackerType == TrackerType::Kcf)
+	{
+		return cv::TrackerKCF::create();
+	}
+	return cv::TrackerMOSSE::create();
+}
+
+
+void DetectionScheduler::findDetectionRegions(const std::vector<cv::Rect>& regions, cv::Size frameSize)
+{
+	cv::Rect frameArea(0, 0, frameSize.width, frameSize.height);
+	// The smallest region in full frame pixels, that is still big enough once it is scaled down.
+	cv::Size minSize(cvCeil(minRegionSize.width / analysisScale), cvCeil(minRegionSize.height / analysisScale));
+	detectionRegions.clear();
+	for(cv::Rect region : regions)
+	{
+		if(zones != nullptr)
+		{
+			// The parts of a region outside of the zones are never scanned.
+			region &= zones->boundingBox(frameSize);
+			if(region.area() <= 0)
+			{
+				continue;
+			}
+		}
+		// Often only a part of a person moves, an arm or the legs, so the region is grown by half of it's size
+		// on every side, and to at least the size that the detector can find anything in.
+		int padX = std::max(16, region.width / 2);
+		int padY = std::max(16, region.height / 2);
+		cv::Rect padded(region.x - padX, region.y - padY, region.width + 2 * padX, region.height + 2 * padY);
+		if(padded.width < minSize.width)
+		{
+			padded.x -= (minSize.width - padded.width) / 2;
+			padded.width = minSize.width;
+		}
+		if(padded.height < minSize.height)
+		{
+			padded.y -= (minSize.height - padded.height) / 2;
+			padded.height = minSize.height;
+		}
+		// A region at the edge of the frame is moved inside of it rather than cut down below the minimum size.
+		padded.x = std::max(0, std::min(padded.x, frameArea.width - padded.width));
+		padded.y = std::max(0, std::min(padded.y, frameArea.height - padded.height));
+		detectionRegions.push_back(padded & frameArea);
+	}
+
+	// Overlapping regions are merged, so no part of the frame is scanned twice.
+	bool merged = true;
+	while(merged)
+	{
+		merged = false;
+		for(std::size_t i = 0; i < detectionRegions.size() && !merged; i++)
+		{
+			for(std::size_t j = i + 1; j < detectionRegions.size(); j++)
+			{
+				if((detectionRegions[i] & detectionRegions[j]).area() > 0)
+				{
+					detectionRegions[i] |= detectionRegions[j];
+					detectionRegions.erase(detectionRegions.begin() + j);
+					merged = true;
+					break;
+				}
+			}
+		}
+	}
+
+	// When most of the frame moves, one scan of the whole frame is cheaper than scanning many pieces of it.
+	int regionArea = 0;
+	for(const cv::Rect& region : detectionRegions)
+	{
+		regionArea += region.area();
+	}
+	if(regionArea * 10 > frameArea.area() * 6)
+	{
+		detectionRegions.assign(1, zones != nullptr ? zones->boundingBox(frameSize) : frameArea);
+	}
+
+	// A region inside of the bounding box of the zones can still lie completely in an exclude zone.
+	if(zones != nullptr)
+	{
+		detectionRegions.erase(std::remove_if(detectionRegions.begin(), detectionRegions.end(),
+		                                      [this, frameSize](const cv::Rect& region) { return zones->excluded(region, frameSize); }),
+		                       detectionRegions.end());
+	}
+}
+
+
+void DetectionScheduler::detect(FrameContext& context, const std::vector<cv::Rect>& regions, int interval)
+{
+	const cv::Mat& frame = context.frame();
+	boxes.clear();
+	findDetectionRegions(regions, frame.size());
+	// The size cv::resize() gives the scaled frame, it is only made by the context if the detector asks for it.
+	cv::Rect scaledArea(0, 0, cvRound(frame.cols * analysisScale), cvRound(frame.rows * analysisScale));
+	for(const cv::Rect& region : detectionRegions)
+	{
+		// The scaled frame comes from the context, so both detectors share one resize of the frame.
+		cv::Rect scaledRegion(cvFloor(region.x * analysisScale), cvFloor(region.y * analysisScale),
+		                      cvRound(region.width * analysisScale), cvRound(region.height * analysisScale));
+		scaledRegion &= scaledArea;
+		if(scaledRegion.width < minRegionSize.width || scaledRegion.height < minRegionSize.height)
+		{
+			// The frame itself is smaller than what the detector needs.
+			continue;
+		}
+		detector(context, analysisScale, scaledRegion, regionBoxes);
+		for(const cv::Rect& box : regionBoxes)
+		{
+			// Back to the pixels of the full frame, for the trackers, the outlines and the recording.
+			cv::Rect frameBox(cvRound((scaledRegion.x + box.x) / analysisScale), cvRound((scaledRegion.y + box.y) / analysisScale),
+			                  cvRound(box.width / analysisScale), cvRound(box.height / analysisScale));
+			// A padded region reaches into the excluded parts of the frame, what is found only there doesn't count.
+			if(zones == nullptr || !zones->excluded(frameBox, frame.size()))
+			{
+				boxes.push_back(frameBox);
+			}
+		}
+	}
+	detections++;
+	framesSinceDetection = 0;
+	detectionDue = false;
+
+	// Every detected box gets a new tracker, the old trackers have drifted for detectionInterval frames.
+	trackers.clear();
+	if(interval == 1)
+	{
+		return;
+	}
+	cv::Rect frameArea(0, 0, frame.cols, frame.rows);
+	for(const cv::Rect& box : boxes)
+	{
+		cv::Rect2d start = box & frameArea;
+		if(start.area() <= 0)
+		{
+			continue;
+		}
+		cv::Ptr<cv::Tracker> tracker = createTracker();
+		if(tracker && tracker->init(frame, start))
+		{
+			trackers.push_back(tracker);
+		}
+	}
+}
+
+
+bool DetectionScheduler::track(const cv::Mat& frame)
+{
+	boxes.clear();
+	cv::Rect frameArea(0, 0, frame.cols, frame.rows);
+	for(cv::Ptr<cv::Tracker>& tracker : trackers)
+	{
+		cv::Rect2d box;
+		// The tracker says it lost the object when it's confidence (the peak of the correlation) drops too low.
+		if(!tracker->update(frame, box))
+		{
+			return false;
+		}
+		cv::Rect visible = cv::Rect(box) & frameArea;
+		if(visible.area() <= 0)
+		{
+			// The object walked out of the frame.
+			return false;
+		}
+		boxes.push_back(visible);
+	}
+	return true;
+}
+
+
+bool DetectionScheduler::runRecognition(FrameContext& context, const std::vector<cv::Rect>& regions, const DetectionConfig& config)
+{
+	const cv::Mat& frame = context.frame();
+	frames++;
+	framesSinceDetection++;
+
+	// Tracking can only follow what is already there, a new person entering the frame is only seen by the detector.
+	// So an empty frame still waits for the next scheduled detection, at most detectionInterval frames later.
+	// The interval can change between two frames, the trackers keep following their objects until the next detection.
+	int interval = config.detectionInterval > 0 ? config.detectionInterval : detectionInterval;
+	if(detectionDue || framesSinceDetection >= interval || !track(frame))
+	{
+		detect(context, regions, interval);
+	}
+	return !boxes.empty();
+}
+
+
+void DetectionScheduler::skipFrame()
+{
+	frames++;
+	trackers.clear();
+	boxes.clear();
+	detectionDue = true;
+}
+
+
+void DetectionScheduler::drawOutlines(cv::Mat& frame) const
+{
+	for(const cv::Rect& box : boxes)
+	{
+		cv::rectangle(frame, box.tl(), box.br(), outlineColor, 2);
+	}
+}
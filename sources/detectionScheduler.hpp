@@ -0,0 +1,93 @@
+/**
+ * File Name:  detectionScheduler.hpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class decides on which frames a detector (HumanFilter or FaceFilter) really runs.
+ * The detectors are the most expensive part of the analysis, so they only run every Nth frame,
+ * and in between the boxes they found are followed by a cheap tracker (MOSSE or KCF).
+ * As soon as a tracker loses it's object, the detector runs again on the next frame.
+ * The detector only looks at the areas of the frame that moved, padded and merged together,
+ * so on a mostly still scene it's cost follows the amount of motion instead of the size of the frame.
+ * The detector can also look at a downscaled copy of those areas, the boxes are mapped back to the full frame.
+ * Each instance of this class is to correspond to a single detector of a single camera.
+ */
+
+#ifndef DETECTIONSCHEDULER_HPP
+#define DETECTIONSCHEDULER_HPP
+
+#include <opencv2/core.hpp>
+#include <opencv2/tracking.hpp>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "cameraSettings.hpp"
+#include "detectionConfig.hpp"
+#include "frameContext.hpp"
+#include "zoneMask.hpp"
+
+class DetectionScheduler
+{
+public:
+	// Finds the boxes of the objects inside of region of the frame scaled down by scale.
+	// The detector takes the image it needs from the context, region and the boxes are in the pixels of that image.
+	typedef std::function<void (FrameContext& context, double scale, const cv::Rect& region, std::vector<cv::Rect>& boxes)> Detector;
+
+	// detectionInterval is the most frames between two runs of the detector, 1 runs it on every frame.
+	// minRegionSize is the smallest image the detector can find an object in.
+	// analysisScale shrinks the image the detector looks at, 0.5 is half the width and half the height.
+	// drawOutlines() outlines the boxes in outlineColor.
+	// Nothing is detected outside of zones, nullptr detects everywhere.
+	DetectionScheduler(Detector detector, int detectionInterval, TrackerType trackerType,
+	                   cv::Size minRegionSize, double analysisScale, cv::Scalar outlineColor, ZoneMask* zones = nullptr);
+
+	// Detects or tracks the objects in this frame, returns true if there is at least one.
+	// The detector only looks inside of regions, pass the whole frame to have it look everywhere.
+	// The detectionInterval of config replaces the one given to the constructor, unless it is 0.
+	// The frame is not drawn on, the detectors and the trackers of every stage see the pixels of the camera.
+	bool runRecognition(FrameContext& context, const std::vector<cv::Rect>& regions, const DetectionConfig& config);
+
+	// Called instead of runRecognition() on a frame the detector is skipped on, because nothing moved in it.
+	// The trackers can't follow their objects over frames they never see, so they are thrown away,
+	// and the next frame given to runRecognition() is a detection.
+	void skipFrame();
+
+	// Outlines the boxes of the last frame, once all of the analysis of the frame is done.
+	void drawOutlines(cv::Mat& frame) const;
+
+	// The boxes of the objects in the last frame.
+	const std::vector<cv::Rect>& objects() const { return boxes; }
+	// How many frames the detector really ran on, and how many frames there were.
+	std::uint64_t detectionCount() const { return detections; }
+	std::uint64_t frameCount() const { return frames; }
+
+private:
+	void detect(FrameContext& context, const std::vector<cv::Rect>& regions, int interval);
+	void findDetectionRegions(const std::vector<cv::Rect>& regions, cv::Size frameSize);
+	bool track(const cv::Mat& frame);
+	cv::Ptr<cv::Tracker> createTracker() const;
+
+	Detector detector;
+	const int detectionInterval;
+	const TrackerType trackerType;
+	const cv::Size minRegionSize;
+	const double analysisScale;
+	const cv::Scalar outlineColor;
+	ZoneMask* const zones;
+	// The padded and merged regions that the detector looks at.
+	std::vector<cv::Rect> detectionRegions;
+	std::vector<cv::Rect> regionBoxes;
+	std::vector<cv::Ptr<cv::Tracker>> trackers;
+	std::vector<cv::Rect> boxes;
+	int framesSinceDetection;
+	// The trackers were thrown away by skipFrame().
+	bool detectionDue;
+	std::uint64_t detections;
+	std::uint64_t frames;
+};
+
+#endif
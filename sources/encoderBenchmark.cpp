@@ -0,0 +1,121 @@
+/**
+ * File Name:  encoderBenchmark.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This program measures how long it takes to write an event video through the JpegEncoderPool
+ * and the MjpegAviWriter with 1, 2, 4, ... encoder threads, up to the number of cores.
+ * It is built with "make benchmark" and is not part of SmartCCTV itself.
+ *
+ * Usage:  encoderBenchmark [frames] [width] [height]
+ */
+
+#include "jpegEncoderPool.hpp"
+#include "mjpegAviWriter.hpp"
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+
+// Every frame is different, so no frame compresses better than a real one just because it repeats.
+static std::vector<cv::Mat> makeFrames(int count, int width, int height)
+{
+	std::vector<cv::Mat> frames;
+	cv::Mat background(height, width, CV_8UC3);
+	cv::randu(background, cv::Scalar::all(0), cv::Scalar::all(255));
+	cv::GaussianBlur(background, background, cv::Size(9, 9), 0);
+	for(int i = 0; i < count; i++)
+	{
+		cv::Mat frame = background.clone();
+		int x = (i * 8) % width;
+		cv::rectangle(frame, cv::Rect(x, height / 3, width / 8, height / 3), cv::Scalar(40, 200, 90), -1);
+		frames.push_back(frame);
+	}
+	return frames;
+}
+
+
+static double writeVideo(const std::vector<cv::Mat>& frames, std::size_t threadCount, std::size_t& fileSize)
+{
+	auto begin = std::chrono::steady_clock::now();
+
+	JpegEncoderPool pool(threadCount, 90);
+	MjpegAviWriter writer;
+	if(!writer.open("/tmp/encoderBenchmark.avi", frames[0].cols, frames[0].rows, 30))
+	{
+		std::fprintf(stderr, "Could not create /tmp/encoderBenchmark.avi\n");
+		std::exit(EXIT_FAILURE);
+	}
+
+	// The same submit and write loop as the EventRecorder.
+	std::vector<uchar> packet;
+	for(const cv::Mat& frame : frames)
+	{
+		frameContainer container;
+		container.frame = frame;
+		pool.submit(std::move(container), FrameCompression::None);
+		while(pool.tryNextPacket(packet))
+		{
+			writer.writeJpeg(packet.data(), packet.size());
+		}
+	}
+	while(pool.nextPacket(packet))
+	{
+		writer.writeJpeg(packet.data(), packet.size());
+	}
+	fileSize = writer.bytesWritten();
+	writer.close();
+
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(end - begin).count();
+}
+
+
+int main(int argc, char* argv[])
+{
+	int frameCount = argc > 1 ? std::atoi(argv[1]) : 300;
+	int width = argc > 2 ? std::atoi(argv[2]) : 1280;
+	int height = argc > 3 ? std::atoi(argv[3]) : 720;
+	if(frameCount <= 0 || width <= 0 || height <= 0)
+	{
+		std::fprintf(stderr, "Usage: %s [frames] [width] [height]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	// The JPEG encoder must not start threads of it's own, only the pool's threads should count.
+	cv::setNumThreads(0);
+	std::vector<cv::Mat> frames = makeFrames(frameCount, width, height);
+	std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+
+	std::printf("%d frames of %dx%d, %zu cores\n", frameCount, width, height, cores);
+	std::printf("%8s %10s %10s %9s %12s\n", "threads", "seconds", "fps", "speedup", "video bytes");
+	std::vector<std::size_t> threadCounts;
+	for(std::size_t threads = 1; threads < cores; threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(cores);
+
+	double baseline = 0;
+	for(std::size_t threads : threadCounts)
+	{
+		std::size_t fileSize = 0;
+		double seconds = writeVideo(frames, threads, fileSize);
+		if(threads == 1)
+		{
+			baseline = seconds;
+		}
+		std::printf("%8zu %10.3f %10.1f %8.2fx %12zu\n", threads, seconds, frameCount / seconds, baseline / seconds, fileSize);
+	}
+
+	return EXIT_SUCCESS;
+}
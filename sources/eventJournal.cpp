@@ -0,0 +1,429 @@
+/**
+ * File Name:  eventJournal.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * The event journal is the record of what every camera detected, and when, see eventJournal.hpp.
+ * The records are written with one write() each and are not synced, they survive the daemon crashing
+ * but the last few seconds of them can be lost if the power fails.
+ */
+
+#include "eventJournal.hpp"
+#include <sys/mman.h>   /* for mmap(), munmap() */
+#include <sys/stat.h>   /* for fstat(), S_IRUSR, S_IWUSR */
+#include <fcntl.h>      /* for open(), O_* constants */
+#include <unistd.h>     /* for pread(), pwrite(), write(), ftruncate(), close() */
+#include <syslog.h>     /* for syslog() */
+#include <errno.h>      /* for errno */
+#include <algorithm>    /* for std::lower_bound(), std::min() */
+#include <cstring>      /* for memcmp(), memcpy(), strerror() */
+#include <fstream>      /* for std::ifstream */
+
+#define log_facility LOG_LOCAL0
+
+static const char JournalMagic[8] = "SCCTVJ1";
+
+
+static bool writeAll(int file, const void* data, std::size_t size)
+{
+	const char* bytes = static_cast<const char*>(data);
+	while(size > 0)
+	{
+		ssize_t written = ::write(file, bytes, size);
+		if(written == -1)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			return false;
+		}
+		bytes += written;
+		size -= static_cast<std::size_t>(written);
+	}
+	return true;
+}
+
+
+static bool readRecordTime(int file, std::uint64_t record, std::int64_t& time)
+{
+	off_t offset = sizeof(JournalHeader) + record * sizeof(JournalRecord) + offsetof(JournalRecord, time);
+	return pread(file, &time, sizeof(time), offset) == static_cast<ssize_t>(sizeof(time));
+}
+
+
+EventJournal::EventJournal()
+ : recordsFile(-1), indexFile(-1), clipsFile(-1), records(0), clipsSize(0), lastTime(0)
+{
+}
+
+
+EventJournal::~EventJournal()
+{
+	close();
+}
+
+
+bool EventJournal::open(const std::string& directory, int camera)
+{
+	close();
+	this->directory = directory;
+	std::string recordsPath = directory + "journal.events";
+	std::string indexPath = directory + "journal.index";
+	std::string clipsPath = directory + "journal.clips";
+
+	// The records and the clips are only ever appended, the index is written at the place of each entry.
+	recordsFile = ::open(recordsPath.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+	indexFile = ::open(indexPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+	clipsFile = ::open(clipsPath.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+	if(recordsFile == -1 || indexFile == -1 || clipsFile == -1)
+	{
+		syslog(log_facility | LOG_ERR, "Failed to open the event journal in %s : %m", directory.c_str());
+		close();
+		return false;
+	}
+
+	struct stat clipsStat;
+	if(fstat(clipsFile, &clipsStat) == -1 || !repair(camera))
+	{
+		close();
+		return false;
+	}
+	clipsSize = static_cast<std::uint64_t>(clipsStat.st_size);
+	syslog(log_facility | LOG_NOTICE, "Opening the event journal %s with %llu records", recordsPath.c_str(),
+	       (unsigned long long) records);
+	return true;
+}
+
+
+bool EventJournal::repair(int camera)
+{
+	std::string recordsPath = directory + "journal.events";
+	struct stat recordsStat;
+	if(fstat(recordsFile, &recordsStat) == -1)
+	{
+		syslog(log_facility | LOG_ERR, "Failed to read %s : %m", recordsPath.c_str());
+		return false;
+	}
+
+	std::uint64_t size = static_cast<std::uint64_t>(recordsStat.st_size);
+	if(size < sizeof(JournalHeader))
+	{
+		// A new journal, or one whose header was cut short before anything was written after it.
+		JournalHeader header = {};
+		memcpy(header.magic, JournalMagic, sizeof(header.magic));
+		header.recordSize = sizeof(JournalRecord);
+		header.camera = camera;
+		if(ftruncate(recordsFile, 0) == -1 || !writeAll(recordsFile, &header, sizeof(header)))
+		{
+			syslog(log_facility | LOG_ERR, "Failed to write %s : %m", recordsPath.c_str());
+			return false;
+		}
+		size = sizeof(header);
+	}
+	else
+	{
+		JournalHeader header;
+		if(pread(recordsFile, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+		   memcmp(header.magic, JournalMagic, sizeof(header.magic)) != 0 || header.recordSize != sizeof(JournalRecord))
+		{
+			syslog(log_facility | LOG_ERR, "%s is not an event journal of this version of SmartCCTV", recordsPath.c_str());
+			return false;
+		}
+	}
+
+	std::uint64_t partial = (size - sizeof(JournalHeader)) % sizeof(JournalRecord);
+	if(partial > 0)
+	{
+		// The daemon stopped in the middle of writing a record.
+		syslog(log_facility | LOG_WARNING, "Throwing away a record of %s that was cut short", recordsPath.c_str());
+		size -= partial;
+		if(ftruncate(recordsFile, static_cast<off_t>(size)) == -1)
+		{
+			syslog(log_facility | LOG_ERR, "Failed to write %s : %m", recordsPath.c_str());
+			return false;
+		}
+	}
+	records = (size - sizeof(JournalHeader)) / sizeof(JournalRecord);
+	lastTime = 0;
+	if(records > 0 && !readRecordTime(recordsFile, records - 1, lastTime))
+	{
+		syslog(log_facility | LOG_ERR, "Failed to read %s : %m", recordsPath.c_str());
+		return false;
+	}
+
+	// The index has to have an entry for every stride of records, and the last one has to match it's record.
+	std::uint64_t entries = (records + JournalIndexStride - 1) / JournalIndexStride;
+	struct stat indexStat;
+	bool matches = fstat(indexFile, &indexStat) == 0 &&
+	               static_cast<std::uint64_t>(indexStat.st_size) == entries * sizeof(JournalIndexEntry);
+	if(matches && entries > 0)
+	{
+		JournalIndexEntry entry;
+		std::int64_t time;
+		matches = pread(indexFile, &entry, sizeof(entry), (entries - 1) * sizeof(entry)) == static_cast<ssize_t>(sizeof(entry)) &&
+		          readRecordTime(recordsFile, (entries - 1) * JournalIndexStride, time) &&
+		          entry.record == (entries - 1) * JournalIndexStride && entry.time == time;
+	}
+	return matches || rebuildIndex();
+}
+
+
+bool EventJournal::rebuildIndex()
+{
+	std::string indexPath = directory + "journal.index";
+	syslog(log_facility | LOG_NOTICE, "Making %s again from the records", indexPath.c_str());
+	if(ftruncate(indexFile, 0) == -1)
+	{
+		syslog(log_facility | LOG_ERR, "Failed to write %s : %m", indexPath.c_str());
+		return false;
+	}
+	for(std::uint64_t record = 0; record < records; record += JournalIndexStride)
+	{
+		JournalIndexEntry entry;
+		entry.record = record;
+		off_t offset = (record / JournalIndexStride) * sizeof(entry);
+		if(!readRecordTime(recordsFile, record, entry.time) ||
+		   pwrite(indexFile, &entry, sizeof(entry), offset) != static_cast<ssize_t>(sizeof(entry)))
+		{
+			syslog(log_facility | LOG_ERR, "Failed to write %s : %m", indexPath.c_str());
+			return false;
+		}
+	}
+	return true;
+}
+
+
+void EventJournal::close()
+{
+	for(int* file : { &recordsFile, &indexFile, &clipsFile })
+	{
+		if(*file != -1)
+		{
+			::close(*file);
+			*file = -1;
+		}
+	}
+	records = 0;
+	clipsSize = 0;
+	lastTime = 0;
+}
+
+
+std::uint64_t EventJournal::addClip(const std::string& name)
+{
+	if(clipsFile == -1)
+	{
+		return JournalNoClip;
+	}
+	std::string line = name + '\n';
+	if(!writeAll(clipsFile, line.data(), line.size()))
+	{
+		syslog(log_facility | LOG_ERR, "Failed to write %sjournal.clips : %m", directory.c_str());
+		// A name that was cut short would be joined with the next one.
+		if(ftruncate(clipsFile, static_cast<off_t>(clipsSize)) == -1)
+		{
+			close();
+		}
+		return JournalNoClip;
+	}
+	std::uint64_t clip = clipsSize;
+	clipsSize += line.size();
+	return clip;
+}
+
+
+bool EventJournal::append(JournalRecord& record)
+{
+	if(recordsFile == -1)
+	{
+		return false;
+	}
+	// The records have to stay sorted by time for the index, even if the clock is set back.
+	if(record.time < lastTime)
+	{
+		record.time = lastTime;
+	}
+	if(!writeAll(recordsFile, &record, sizeof(record)))
+	{
+		syslog(log_facility | LOG_ERR, "Failed to write %sjournal.events : %m", directory.c_str());
+		if(ftruncate(recordsFile, static_cast<off_t>(sizeof(JournalHeader) + records * sizeof(JournalRecord))) == -1)
+		{
+			close();
+		}
+		return false;
+	}
+
+	if(records % JournalIndexStride == 0)
+	{
+		JournalIndexEntry entry;
+		entry.time = record.time;
+		entry.record = records;
+		off_t offset = (records / JournalIndexStride) * sizeof(entry);
+		if(pwrite(indexFile, &entry, sizeof(entry), offset) != static_cast<ssize_t>(sizeof(entry)))
+		{
+			// The readers don't trust an entry that doesn't match it's record, and the next open() makes the index again.
+			syslog(log_facility | LOG_ERR, "Failed to write %sjournal.index : %m", directory.c_str());
+		}
+	}
+	records++;
+	lastTime = record.time;
+	return true;
+}
+
+
+JournalReader::JournalReader()
+ : recordsMap(nullptr), recordsMapSize(0), indexMap(nullptr), indexMapSize(0), recordData(nullptr), indexData(nullptr),
+   records(0), indexEntries(0)
+{
+}
+
+
+JournalReader::~JournalReader()
+{
+	close();
+}
+
+
+// Maps the whole file read-only, returns false if it couldn't be opened or mapped. An empty file maps to nullptr.
+static bool mapFile(const std::string& path, void*& map, std::size_t& size, std::string& error)
+{
+	int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	struct stat fileStat;
+	if(file == -1 || fstat(file, &fileStat) == -1)
+	{
+		error = path + ": " + strerror(errno);
+		if(file != -1)
+		{
+			::close(file);
+		}
+		return false;
+	}
+	size = static_cast<std::size_t>(fileStat.st_size);
+	map = nullptr;
+	if(size > 0)
+	{
+		map = mmap(nullptr, size, PROT_READ, MAP_SHARED, file, 0);
+		if(map == MAP_FAILED)
+		{
+			error = path + ": " + strerror(errno);
+			map = nullptr;
+			size = 0;
+			::close(file);
+			return false;
+		}
+	}
+	// The mapping stays valid after the file is closed.
+	::close(file);
+	return true;
+}
+
+
+bool JournalReader::open(const std::string& directory, std::string& error)
+{
+	close();
+	this->directory = directory;
+	std::string recordsPath = directory + "journal.events";
+	if(!mapFile(recordsPath, recordsMap, recordsMapSize, error))
+	{
+		return false;
+	}
+	const JournalHeader* header = static_cast<const JournalHeader*>(recordsMap);
+	if(recordsMapSize < sizeof(JournalHeader) || memcmp(header->magic, JournalMagic, sizeof(header->magic)) != 0 ||
+	   header->recordSize != sizeof(JournalRecord))
+	{
+		error = recordsPath + " is not an event journal of this version of SmartCCTV";
+		close();
+		return false;
+	}
+	// A record that is being written right now is left out.
+	records = (recordsMapSize - sizeof(JournalHeader)) / sizeof(JournalRecord);
+	recordData = reinterpret_cast<const JournalRecord*>(static_cast<const char*>(recordsMap) + sizeof(JournalHeader));
+
+	// Without the index the records are searched directly, which is slower but gives the same answer.
+	std::string ignored;
+	if(mapFile(directory + "journal.index", indexMap, indexMapSize, ignored))
+	{
+		indexData = static_cast<const JournalIndexEntry*>(indexMap);
+		indexEntries = std::min<std::uint64_t>(indexMapSize / sizeof(JournalIndexEntry),
+		                                       (records + JournalIndexStride - 1) / JournalIndexStride);
+	}
+	return true;
+}
+
+
+void JournalReader::close()
+{
+	if(recordsMap != nullptr)
+	{
+		munmap(recordsMap, recordsMapSize);
+	}
+	if(indexMap != nullptr)
+	{
+		munmap(indexMap, indexMapSize);
+	}
+	recordsMap = indexMap = nullptr;
+	recordsMapSize = indexMapSize = 0;
+	recordData = nullptr;
+	indexData = nullptr;
+	records = indexEntries = 0;
+}
+
+
+std::uint64_t JournalReader::lowerBound(std::int64_t time) const
+{
+	std::uint64_t first = 0;
+	std::uint64_t last = records;
+	if(indexEntries > 0)
+	{
+		// The first entry at time or later, the record is in the stride before it's record.
+		const JournalIndexEntry* entry = std::lower_bound(indexData, indexData + indexEntries, time,
+		                                                  [](const JournalIndexEntry& entry, std::int64_t time)
+		                                                  { return entry.time < time; });
+		std::uint64_t after = static_cast<std::uint64_t>(entry - indexData);
+		std::uint64_t before = after > 0 ? after - 1 : 0;
+		// An entry that is being written, or that failed to be written, doesn't match it's record.
+		auto matches = [this](std::uint64_t i)
+		{
+			std::uint64_t record = i * JournalIndexStride;
+			return indexData[i].record == record && record < records && indexData[i].time == recordData[record].time;
+		};
+		if(matches(before) && (after == indexEntries || matches(after)))
+		{
+			first = after > 0 ? before * JournalIndexStride : 0;
+			last = after < indexEntries ? after * JournalIndexStride : records;
+		}
+	}
+	const JournalRecord* found = std::lower_bound(recordData + first, recordData + last, time,
+	                                              [](const JournalRecord& record, std::int64_t time)
+	                                              { return record.time < time; });
+	return static_cast<std::uint64_t>(found - recordData);
+}
+
+
+std::pair<std::uint64_t, std::uint64_t> JournalReader::range(std::int64_t begin, std::int64_t end) const
+{
+	std::uint64_t first = lowerBound(begin);
+	std::uint64_t last = end > begin ? lowerBound(end) : first;
+	return std::make_pair(first, last);
+}
+
+
+std::string JournalReader::clipName(std::uint64_t clip) const
+{
+	if(clip == JournalNoClip)
+	{
+		return "";
+	}
+	std::ifstream clips(directory + "journal.clips");
+	std::string name;
+	if(!clips.seekg(static_cast<std::streamoff>(clip)) || !std::getline(clips, name))
+	{
+		return "";
+	}
+	return name;
+}
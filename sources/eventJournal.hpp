@@ -0,0 +1,159 @@
+/**
+ * File Name:  eventJournal.hpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * The event journal is the record of what every camera detected, and when. Each camera appends fixed size
+ * records to a journal in it's recordings directory, about once a second while it detects something:
+ *
+ *   journal.events - a JournalHeader, then the JournalRecords in the order of their time
+ *   journal.index  - a JournalIndexEntry for every JournalIndexStride'th record
+ *   journal.clips  - the names of the videos the records point into, one per line
+ *
+ * The time of a record never goes back, even if the clock is set back, so the records are sorted by time.
+ * The index is small enough to stay in memory for months of records, a query finds the first record of a range
+ * with a binary search of the index and then of one stride of records, it touches a few pages of each file.
+ * The journal is only appended to. A record that was cut short by a crash is thrown away when the journal is
+ * opened again, and the index is made again from the records if it doesn't match them.
+ */
+
+#ifndef EVENTJOURNAL_HPP
+#define EVENTJOURNAL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+// The detectors that found something in the frame of a record, a record can have several of them.
+enum JournalDetector : std::uint8_t
+{
+	JournalMotion = 1,
+	JournalHuman = 2,
+	JournalFace = 4
+};
+
+struct JournalBox
+{
+	std::int16_t x;
+	std::int16_t y;
+	std::int16_t width;
+	std::int16_t height;
+};
+
+const std::size_t JournalMaxBoxes = 6;
+// A record that is not part of a video.
+const std::uint64_t JournalNoClip = ~std::uint64_t(0);
+
+struct JournalRecord
+{
+	std::int64_t time;        // milliseconds since the epoch
+	std::int32_t camera;
+	std::int32_t motionScore; // how many pixels moved, 0 if the motion detection is off
+	std::uint64_t clip;       // where the name of the video starts in journal.clips, or JournalNoClip
+	std::int32_t clipOffset;  // milliseconds from the first frame of the video to this frame
+	std::uint8_t detectors;   // JournalDetector bits
+	std::uint8_t boxCount;
+	std::uint8_t boxDetectors[JournalMaxBoxes];  // the JournalDetector that found each box
+	std::uint8_t reserved[4];
+	JournalBox boxes[JournalMaxBoxes];           // in the coordinates of the full frame
+};
+static_assert(sizeof(JournalRecord) == 88, "The size of a JournalRecord is part of the file format");
+
+struct JournalHeader
+{
+	char magic[8];            // "SCCTVJ1"
+	std::uint32_t recordSize; // sizeof(JournalRecord)
+	std::int32_t camera;
+};
+static_assert(sizeof(JournalHeader) == 16, "The size of a JournalHeader is part of the file format");
+
+struct JournalIndexEntry
+{
+	std::int64_t time;        // the time of the record
+	std::uint64_t record;     // the number of the record, always a multiple of JournalIndexStride
+};
+
+const std::uint64_t JournalIndexStride = 64;
+
+
+// The writing side, used by the analysis thread of one camera.
+class EventJournal
+{
+public:
+	EventJournal();
+	~EventJournal();
+	EventJournal(const EventJournal&) = delete;
+	EventJournal& operator=(const EventJournal&) = delete;
+
+	// Opens or creates the journal in directory, which ends with a '/'.
+	// Returns false and logs why if it can't be used, append() does nothing then.
+	bool open(const std::string& directory, int camera);
+	void close();
+	bool isOpen() const { return recordsFile != -1; }
+
+	// Remembers the name of a video, the records of it's frames point to the name with the returned number.
+	std::uint64_t addClip(const std::string& name);
+
+	// Appends the record, it's time is moved forward to the time of the previous record if it is older.
+	bool append(JournalRecord& record);
+
+	std::uint64_t recordCount() const { return records; }
+
+private:
+	bool repair(int camera);
+	bool rebuildIndex();
+
+	std::string directory;
+	int recordsFile;
+	int indexFile;
+	int clipsFile;
+	std::uint64_t records;
+	std::uint64_t clipsSize;
+	std::int64_t lastTime;
+};
+
+
+// The reading side, it maps the journal of one camera read-only and can be used while the camera appends to it.
+// It sees the records that were there when it was opened.
+class JournalReader
+{
+public:
+	JournalReader();
+	~JournalReader();
+	JournalReader(const JournalReader&) = delete;
+	JournalReader& operator=(const JournalReader&) = delete;
+
+	// Maps the journal in directory, which ends with a '/'. error says why if it returns false.
+	bool open(const std::string& directory, std::string& error);
+	void close();
+
+	std::uint64_t size() const { return records; }
+	const JournalRecord& operator[](std::uint64_t i) const { return recordData[i]; }
+
+	// The first record at time or later, size() if there is none.
+	std::uint64_t lowerBound(std::int64_t time) const;
+
+	// The records from begin up to but not including end, as [first, last).
+	std::pair<std::uint64_t, std::uint64_t> range(std::int64_t begin, std::int64_t end) const;
+
+	// The name of the video a record points to, "" if there is none.
+	std::string clipName(std::uint64_t clip) const;
+
+private:
+	std::string directory;
+	void* recordsMap;
+	std::size_t recordsMapSize;
+	void* indexMap;
+	std::size_t indexMapSize;
+	const JournalRecord* recordData;
+	const JournalIndexEntry* indexData;
+	std::uint64_t records;
+	std::uint64_t indexEntries;
+};
+
+#endif
@@ -0,0 +1,346 @@
+/**
+ * File Name:  eventRecorder.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class writes the video of a detection event on it's own thread, while the event is still happening.
+ * The Camera hands it the pre-roll frames when the event starts and then every new frame as it arrives,
+ * so the analysis loop never waits for the disk and no more than the pre-roll is ever kept in memory.
+ * Motion JPEG videos are compressed in parallel by a JpegEncoderPool and written by the MjpegAviWriter,
+ * H.264 and H.265 videos are encoded by the FFmpeg backend of cv::VideoWriter.
+ */
+
+#include "eventRecorder.hpp"
+#include "event_channel.h"
+#include "retentionManager.hpp"
+#include <chrono>
+#include <cstdlib>      /* for setenv() */
+#include <sys/stat.h>   /* for stat() */
+#include <syslog.h>     /* for syslog() */
+#include <time.h>       /* for clock_gettime() */
+#define log_facility LOG_LOCAL0
+
+
+static double threadCpuSeconds()
+{
+	timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+EventRecorder::EventRecorder(int cameraNumber)
+ : cameraNumber(cameraNumber), codec(VideoCodec::Mjpg), droppedFrames(0),
+   videoOpened(false), fileCreated(false), bytesBeforeFailure(0), usingFfmpeg(false), framesWritten(0), writerCpuAtOpen(0), poolCpuAtOpen(0)
+{
+}
+
+
+EventRecorder::~EventRecorder()
+{
+	stop();
+}
+
+
+void EventRecorder::start(std::size_t queueCapacity, const CameraSettings& settings)
+{
+	codec = settings.videoCodec;
+	// The pool is also there for H.264 and H.265, in case FFmpeg can't be used and the videos fall back to Motion JPEG.
+	encoderPool.reset(new JpegEncoderPool(settings.encoderThreads, settings.jpegQuality));
+	// A full queue means that the disk can't keep up, the newest frames are dropped instead of
+	// making the analysis loop wait. The frames already queued keep the video continuous up to that point.
+	queue.reset(new FrameQueue<Item>(queueCapacity, OverflowPolicy::DropNewest));
+	writerThread = std::thread(&EventRecorder::writeFrames, this);
+}
+
+
+void EventRecorder::pushControl(Item&& item)
+{
+	if(!queue)
+	{
+		return;
+	}
+	// Beginning or ending a video must never be dropped, wait for the writer to make room.
+	// A stopped recorder has closed the queue, then the item is thrown away instead of waiting forever.
+	queue->pushWait(std::move(item));
+}
+
+
+void EventRecorder::beginEvent(const std::string& baseName, double fps, cv::Size frameSize)
+{
+	Item item;
+	item.kind = Item::Begin;
+	item.fileName = baseName;
+	item.fps = fps;
+	item.frameSize = frameSize;
+	droppedFrames = 0;
+	pushControl(std::move(item));
+}
+
+
+void EventRecorder::addFrame(frameContainer&& container, FrameCompression format)
+{
+	if(!queue)
+	{
+		return;
+	}
+	Item item;
+	item.kind = Item::Frame;
+	item.container = std::move(container);
+	item.format = format;
+	if(!queue->push(std::move(item)))
+	{
+		droppedFrames++;
+	}
+}
+
+
+void EventRecorder::endEvent()
+{
+	Item item;
+	item.kind = Item::End;
+	pushControl(std::move(item));
+
+	if(droppedFrames > 0)
+	{
+		syslog(log_facility | LOG_WARNING, "Camera %d dropped %llu frames of the event video, the disk can't keep up",
+		       cameraNumber, (unsigned long long) droppedFrames);
+	}
+}
+
+
+void EventRecorder::stop()
+{
+	if(!queue)
+	{
+		return;
+	}
+	queue->close();
+	if(writerThread.joinable())
+	{
+		writerThread.join();
+	}
+	queue.reset();
+	encoderPool.reset();
+}
+
+
+void EventRecorder::writeFrames()
+{
+	Item item;
+	while(queue->pop(item))
+	{
+		if(item.kind == Item::Begin)
+		{
+			closeVideo();
+			openVideo(item);
+		}
+		else if(item.kind == Item::Frame)
+		{
+			if(videoOpened)
+			{
+				writeFrame(item);
+			}
+		}
+		else
+		{
+			closeVideo();
+		}
+	}
+
+	// The daemon is shutting down in the middle of an event, keep what was recorded.
+	closeVideo();
+}
+
+
+void EventRecorder::openVideo(const Item& item)
+{
+	framesWritten = 0;
+	firstFrameTime = std::chrono::time_point<std::chrono::high_resolution_clock>();
+	lastFrameTime = firstFrameTime;
+	writerCpuAtOpen = threadCpuSeconds();
+	poolCpuAtOpen = encoderPool->cpuSeconds();
+
+	if(codec != VideoCodec::Mjpg)
+	{
+		usingFfmpeg = openFfmpegVideo(item);
+		if(usingFfmpeg)
+		{
+			videoOpened = true;
+			fileCreated = true;
+			return;
+		}
+		syslog(log_facility | LOG_WARNING, "FFmpeg could not create %s, recording Motion JPEG instead", fileName.c_str());
+	}
+
+	fileName = item.fileName + ".avi";
+	videoOpened = mjpegWriter.open(fileName, item.frameSize.width, item.frameSize.height, item.fps);
+	fileCreated = videoOpened;
+	bytesBeforeFailure = 0;
+	if(!videoOpened)
+	{
+		syslog(log_facility | LOG_ERR, "Failed to create the video %s", fileName.c_str());
+	}
+}
+
+
+bool EventRecorder::openFfmpegVideo(const Item& item)
+{
+	fileName = item.fileName + ".mp4";
+	int fourcc = codec == VideoCodec::H264 ? cv::VideoWriter::fourcc('a','v','c','1')
+	                                       : cv::VideoWriter::fourcc('h','v','c','1');
+
+	// The encoder options were put into the environment by setFfmpegWriterOptions() before the cameras started.
+	return ffmpegWriter.open(fileName, cv::CAP_FFMPEG, fourcc, item.fps, item.frameSize);
+}
+
+
+void setFfmpegWriterOptions(const CameraSettings& settings)
+{
+	// x264 and x265 run on the writer thread, a video is encoded in real time while it is recorded anyway.
+	// This way the cameras don't all compete for every core, and the CPU time of a video can be measured.
+	std::string options = "preset;" + settings.videoPreset + "|crf;" + std::to_string(settings.videoCrf) + "|threads;1";
+	setenv("OPENCV_FFMPEG_WRITER_OPTIONS", options.c_str(), 1);
+	syslog(log_facility | LOG_NOTICE, "The H.264 and H.265 videos are encoded with %s", options.c_str());
+}
+
+
+void EventRecorder::writeFrame(Item& item)
+{
+	if(firstFrameTime == std::chrono::time_point<std::chrono::high_resolution_clock>())
+	{
+		firstFrameTime = item.container.start;
+	}
+	lastFrameTime = item.container.start;
+
+	if(usingFfmpeg)
+	{
+		decodeFrame(item.container, item.format, decoded);
+		if(decoded.empty())
+		{
+			return;
+		}
+		// VideoWriter::write() gives back nothing, a backend that fails either throws or closes the writer.
+		bool written = false;
+		try
+		{
+			ffmpegWriter.write(decoded);
+			written = ffmpegWriter.isOpened();
+		}
+		catch(const cv::Exception& error)
+		{
+			syslog(log_facility | LOG_ERR, "FFmpeg: %s", error.what());
+		}
+		if(!written)
+		{
+			syslog(log_facility | LOG_ERR, "Failed to write the video %s", fileName.c_str());
+			// The rest of the frames of this video are thrown away, the file is closed with what was written.
+			ffmpegWriter.release();
+			videoOpened = false;
+			return;
+		}
+		framesWritten++;
+		return;
+	}
+
+	// submit() only waits when every encoder thread is busy and has a backlog.
+	encoderPool->submit(std::move(item.container), item.format);
+	writePackets(false);
+}
+
+
+void EventRecorder::writePackets(bool waitForAll)
+{
+	// The packets come back in the order the frames were submitted, even though they are compressed in parallel.
+	while(waitForAll ? encoderPool->nextPacket(packet) : encoderPool->tryNextPacket(packet))
+	{
+		if(!videoOpened)
+		{
+			continue;
+		}
+		if(!mjpegWriter.writeJpeg(packet.data(), packet.size()))
+		{
+			syslog(log_facility | LOG_ERR, "Failed to write the video %s", fileName.c_str());
+			// The rest of the frames of this video are thrown away, the file is closed with what was written.
+			bytesBeforeFailure = mjpegWriter.bytesWritten();
+			mjpegWriter.close();
+			videoOpened = false;
+			continue;
+		}
+		framesWritten++;
+	}
+}
+
+
+void EventRecorder::closeVideo()
+{
+	// The frame rate the frames really came in at, so the video plays back at the speed of real time.
+	double measuredFps = 0;
+	double seconds = std::chrono::duration<double>(lastFrameTime - firstFrameTime).count();
+	if(framesWritten > 1 && seconds > 0)
+	{
+		measuredFps = (framesWritten - 1) / seconds;
+	}
+
+	std::uint64_t fileSize = 0;
+	if(usingFfmpeg)
+	{
+		if(!fileCreated)
+		{
+			return;
+		}
+		// The frame rate of an FFmpeg video is fixed when it is opened, the first guess has to do.
+		ffmpegWriter.release();
+		struct stat status;
+		if(stat(fileName.c_str(), &status) == -1)
+		{
+			fileCreated = false;
+			videoOpened = false;
+			return;
+		}
+		fileSize = status.st_size;
+	}
+	else
+	{
+		writePackets(true);
+		if(!fileCreated)
+		{
+			return;
+		}
+		if(mjpegWriter.isOpened())
+		{
+			if(measuredFps > 0)
+			{
+				mjpegWriter.setFrameRate(measuredFps);
+			}
+			fileSize = mjpegWriter.bytesWritten();
+			mjpegWriter.close();
+		}
+		else
+		{
+			// Writing it failed, the frames up to the failure are still on the disk.
+			fileSize = bytesBeforeFailure;
+		}
+	}
+	fileCreated = false;
+	videoOpened = false;
+	// The retention manager counts the video with the size that was written, without looking at the directory.
+	// A video that could not be written to the end is counted too, or it would never be deleted.
+	RetentionManager::instance().clipSaved(cameraNumber, fileName, fileSize);
+
+	if(framesWritten == 0)
+	{
+		syslog(log_facility | LOG_ERR, "Error: Saved an empty video %s", fileName.c_str());
+		return;
+	}
+
+	double cpuSeconds = (threadCpuSeconds() - writerCpuAtOpen) + (encoderPool->cpuSeconds() - poolCpuAtOpen);
+	syslog(log_facility | LOG_NOTICE, "Saved a video %s: %zu frames at %.1f fps, %.1f MB, %.2f s of CPU to encode (%.1f ms per frame)",
+	       fileName.c_str(), framesWritten, measuredFps, fileSize / (1024.0 * 1024.0), cpuSeconds,
+	       cpuSeconds * 1000 / framesWritten);
+	send_gui_event(EVENT_CLIP_SAVED, cameraNumber, fileName);
+}
@@ -0,0 +1,120 @@
+/**
+ * File Name:  eventRecorder.hpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class writes the video of a detection event on it's own thread, while the event is still happening.
+ * The Camera hands it the pre-roll frames when the event starts and then every new frame as it arrives,
+ * so the analysis loop never waits for the disk and no more than the pre-roll is ever kept in memory.
+ * Motion JPEG videos are compressed in parallel by a JpegEncoderPool and written by the MjpegAviWriter,
+ * H.264 and H.265 videos are encoded by the FFmpeg backend of cv::VideoWriter.
+ */
+
+#ifndef EVENTRECORDER_HPP
+#define EVENTRECORDER_HPP
+
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cameraSettings.hpp"
+#include "frameQueue.hpp"
+#include "frameRing.hpp"
+#include "jpegEncoderPool.hpp"
+#include "mjpegAviWriter.hpp"
+
+class EventRecorder
+{
+public:
+	EventRecorder(int cameraNumber);
+	~EventRecorder();
+	EventRecorder(const EventRecorder&) = delete;
+	EventRecorder& operator=(const EventRecorder&) = delete;
+
+	// Starts the writer thread, the codec comes from the settings of the camera.
+	// queueCapacity frames may wait to be written, it has to hold the whole pre-roll.
+	void start(std::size_t queueCapacity, const CameraSettings& settings);
+
+	// Everything below is called by the analysis loop of the Camera only, and never waits for the disk.
+
+	// The frames added after this go into a new video, the extension of the codec is added to baseName.
+	// fps is only a first guess, the frame rate is measured from the timestamps of the frames.
+	void beginEvent(const std::string& baseName, double fps, cv::Size frameSize);
+	// format is how the frame is stored, the pre-roll frames come out of the FrameRing compressed.
+	// Frames that are already JPEG images are written as they are.
+	// If the writer has fallen too far behind, the frame is dropped.
+	void addFrame(frameContainer&& container, FrameCompression format);
+	// Closes the video once it's frames are written.
+	void endEvent();
+
+	// Writes the frames that are still queued, closes the video and stops the writer thread.
+	void stop();
+
+private:
+	struct Item
+	{
+		enum Kind { Begin, Frame, End } kind;
+		frameContainer container;
+		FrameCompression format;
+		std::string fileName;
+		double fps;
+		cv::Size frameSize;
+	};
+
+	void pushControl(Item&& item);
+	void writeFrames();
+	void openVideo(const Item& item);
+	bool openFfmpegVideo(const Item& item);
+	void writeFrame(Item& item);
+	void writePackets(bool waitForAll);
+	void closeVideo();
+
+	const int cameraNumber;
+	std::unique_ptr<FrameQueue<Item>> queue;
+	std::thread writerThread;
+	std::unique_ptr<JpegEncoderPool> encoderPool;
+	VideoCodec codec;
+	// Frames that did not fit into the queue during the current event, only touched by the analysis loop.
+	std::uint64_t droppedFrames;
+
+	// The state of the video being written, only touched by the writer thread.
+	std::string fileName;
+	bool videoOpened;
+	// The file of the video exists, even if writing it failed later and videoOpened went back to false.
+	bool fileCreated;
+	// What was written of a Motion JPEG video before writing it failed.
+	std::uint64_t bytesBeforeFailure;
+	// false if this video is Motion JPEG, either because of the settings or because FFmpeg could not open it
+	bool usingFfmpeg;
+	MjpegAviWriter mjpegWriter;
+	cv::VideoWriter ffmpegWriter;
+	cv::Mat decoded;
+	std::size_t framesWritten;
+	std::chrono::time_point<std::chrono::high_resolution_clock> firstFrameTime;
+	std::chrono::time_point<std::chrono::high_resolution_clock> lastFrameTime;
+	// To report how much CPU time the encoding of every video took.
+	double writerCpuAtOpen;
+	double poolCpuAtOpen;
+	// Handed back and forth with the encoder pool, so writing a frame does not allocate.
+	std::vector<uchar> packet;
+};
+
+/**
+ * OpenCV only takes the FFmpeg encoder options from the environment, so they are the same for every camera.
+ * Changing the environment while other threads run can crash a thread that reads it at the same time,
+ * so this is called once by the daemon, before any camera or recorder thread exists.
+ *
+ * @param const CameraSettings& settings - The settings whose video_preset and video_crf are used.
+ */
+void setFfmpegWriterOptions(const CameraSettings& settings);
+
+#endif
@@ -0,0 +1,239 @@
+/**
+ * File Name:   event_channel.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This file contains the definitions of the event channel, which tells the GUI process what happened
+ * in the SmartCCTV Daemon and the LiveStream Viewer.
+ */
+
+#include "event_channel.h"
+
+#include <mqueue.h>     /* for mqd_t, mq_open(), mq_send(), mq_receive(), mq_close(), mq_unlink() */
+#include <fcntl.h>      /* for O_* constants */
+#include <sys/stat.h>   /* for S_IRUSR, S_IWUSR */
+#include <unistd.h>     /* for getpid(), getuid() */
+#include <time.h>       /* for clock_gettime() */
+#include <errno.h>      /* for errno */
+#include <syslog.h>     /* for syslog() */
+#include <chrono>       /* for std::chrono::steady_clock */
+#include <cstring>      /* for memset(), memcpy(), strncpy() */
+#include <deque>        /* for std::deque */
+#include <map>          /* for std::map */
+#include <mutex>        /* for std::mutex, std::lock_guard */
+#include <string>       /* for std::string */
+
+using std::string;
+
+// The text messages used "/SmartCCTV_Message_handler", a queue left behind by an older GUI can't be mistaken for this one.
+// The message queues are shared by all of the users of the host, so the uid is added like for the control socket,
+// like /SmartCCTV_events.1000, and a daemon only talks to the GUI of it's own user.
+static const string queue_name = "/SmartCCTV_events." + std::to_string(getuid());
+// The most events the queue holds, 10 is the most an unprivileged user may ask for by default.
+static const long queue_length = 10;
+// mq_receive() gives the messages with the highest priority first.
+static const unsigned int error_priority = 1;
+static const unsigned int normal_priority = 0;
+// The most events that wait in this process for room in the queue, the oldest ones are thrown away.
+static const size_t max_pending_events = 32;
+
+// The sending side, shared by all of the threads of the process.
+static std::mutex writer_mutex;
+static mqd_t writer = (mqd_t) -1;
+static bool opened_before = false;
+static std::chrono::steady_clock::time_point last_open;
+static std::deque<std::pair<Gui_event, unsigned int>> pending_events;
+static std::map<int, Gui_event> pending_stats;
+
+
+static std::uint64_t milliseconds_now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return static_cast<std::uint64_t>(now.tv_sec) * 1000 + now.tv_nsec / 1000000;
+}
+
+
+/**
+ * Opens the queue if it is not open. Called with writer_mutex locked.
+ * The queue is opened at most once a second, so sending the stats while the GUI is not running costs nothing.
+ * With reopen, the queue is opened again even if it is open. A GUI that was restarted made a new queue,
+ * and the old queue it removed fills up because nobody reads it anymore.
+ */
+static bool open_writer(bool reopen)
+{
+    if (writer != (mqd_t) -1 && !reopen) {
+        return true;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (opened_before && now - last_open < std::chrono::seconds(1)) {
+        return writer != (mqd_t) -1;
+    }
+    opened_before = true;
+    last_open = now;
+
+    if (writer != (mqd_t) -1) {
+        mq_close(writer);
+    }
+    writer = mq_open(queue_name.c_str(), O_WRONLY | O_NONBLOCK);
+    if (writer == (mqd_t) -1) {
+        // The GUI is not running, what was waiting for it is not needed anymore.
+        pending_events.clear();
+        pending_stats.clear();
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * Sends one event. Called with writer_mutex locked.
+ *
+ * @return int - 0 if it was sent, EAGAIN if the queue is full, or the error.
+ */
+static int send_now(const Gui_event& event, unsigned int priority)
+{
+    if (mq_send(writer, reinterpret_cast<const char*>(&event), sizeof(event), priority) == 0) {
+        return 0;
+    }
+    int error = errno;
+    if (error != EAGAIN) {
+        syslog(log_facility | LOG_ERR, "Failed to send an event to the GUI : %m");
+        mq_close(writer);
+        writer = (mqd_t) -1;
+    }
+    return error;
+}
+
+
+/**
+ * Sends the events that are waiting, oldest first and the stats last. Called with writer_mutex locked.
+ *
+ * @return bool - true if nothing is waiting anymore
+ */
+static bool send_pending()
+{
+    while (!pending_events.empty()) {
+        if (send_now(pending_events.front().first, pending_events.front().second) != 0) {
+            return false;
+        }
+        pending_events.pop_front();
+    }
+    while (!pending_stats.empty()) {
+        if (send_now(pending_stats.begin()->second, normal_priority) != 0) {
+            return false;
+        }
+        pending_stats.erase(pending_stats.begin());
+    }
+    return true;
+}
+
+
+/**
+ * Sends the waiting events and then this one, or keeps it waiting. Called with writer_mutex locked.
+ */
+static bool send_or_keep(const Gui_event& event, unsigned int priority)
+{
+    if (!open_writer(false)) {
+        return false;
+    }
+    bool sent = send_pending() && send_now(event, priority) == 0;
+    if (!sent && writer != (mqd_t) -1 && open_writer(true)) {
+        // The queue was full, if the GUI was restarted this is it's new queue.
+        sent = send_pending() && send_now(event, priority) == 0;
+    }
+    if (sent) {
+        return true;
+    }
+    if (writer == (mqd_t) -1) {
+        return false;
+    }
+
+    if (event.type == EVENT_CAMERA_STATS) {
+        // Only the newest stats of a camera are worth sending.
+        pending_stats[event.camera] = event;
+    } else {
+        if (pending_events.size() == max_pending_events) {
+            pending_events.pop_front();
+        }
+        pending_events.emplace_back(event, priority);
+    }
+    return true;
+}
+
+
+bool send_gui_event(Gui_event_type type, int camera, const string& text)
+{
+    Gui_event event;
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.camera = static_cast<std::int16_t>(camera);
+    event.sender = static_cast<std::uint32_t>(getpid());
+    event.time = milliseconds_now();
+    strncpy(event.text, text.c_str(), sizeof(event.text) - 1);
+
+    bool is_error = type == EVENT_DAEMON_FAILED || type == EVENT_PERMISSION_ERROR || type == EVENT_CAMERA_ERROR ||
+                    type == EVENT_VIEWER_STOPPED || type == EVENT_DISK_FULL;
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    return send_or_keep(event, is_error ? error_priority : normal_priority);
+}
+
+
+bool send_gui_stats(const Gui_event& stats)
+{
+    Gui_event event = stats;
+    event.type = EVENT_CAMERA_STATS;
+    event.sender = static_cast<std::uint32_t>(getpid());
+    event.time = milliseconds_now();
+    event.text[sizeof(event.text) - 1] = '\0';
+
+    std::lock_guard<std::mutex> lock(writer_mutex);
+    // Stats that are still waiting are older than these, and are replaced instead of being sent first.
+    pending_stats.erase(event.camera);
+    return send_or_keep(event, normal_priority);
+}
+
+
+int open_gui_event_queue()
+{
+    struct mq_attr attributes;
+    memset(&attributes, 0, sizeof(attributes));
+    attributes.mq_maxmsg = queue_length;
+    attributes.mq_msgsize = sizeof(Gui_event);
+
+    mqd_t queue = mq_open(queue_name.c_str(), O_RDONLY | O_CREAT | O_EXCL | O_NONBLOCK | O_CLOEXEC, S_IRUSR | S_IWUSR, &attributes);
+    if (queue == (mqd_t) -1) {
+        return -1;
+    }
+    syslog(log_facility | LOG_NOTICE, "Creating %s", queue_name.c_str());
+    return static_cast<int>(queue);
+}
+
+
+bool receive_gui_event(int queue, Gui_event& event)
+{
+    char buffer[sizeof(Gui_event)];
+    ssize_t received;
+    while ( (received = mq_receive(static_cast<mqd_t>(queue), buffer, sizeof(buffer), nullptr)) != -1) {
+        if (received != static_cast<ssize_t>(sizeof(Gui_event))) {
+            // Not something this channel sent.
+            continue;
+        }
+        memcpy(&event, buffer, sizeof(event));
+        event.text[sizeof(event.text) - 1] = '\0';
+        return true;
+    }
+    return false;
+}
+
+
+void close_gui_event_queue(int queue)
+{
+    syslog(log_facility | LOG_NOTICE, "Closing %s", queue_name.c_str());
+    mq_close(static_cast<mqd_t>(queue));
+    mq_unlink(queue_name.c_str());
+}
@@ -0,0 +1,117 @@
+/**
+ * File Name:   event_channel.h
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This file contains the declarations of the event channel, which tells the GUI process what happened
+ * in the SmartCCTV Daemon and the LiveStream Viewer. It replaces the text messages of write_message().
+ *
+ * Every event is one fixed size Gui_event in a POSIX message queue that the GUI creates.
+ * The GUI waits for the queue on it's event loop, because on Linux the queue is a file descriptor.
+ * Each process that sends events keeps the queue open, instead of opening it for every event.
+ * Errors are sent with a higher priority than the rest, so the GUI reads them first.
+ * The stats of a camera are coalesced: while the queue is full only the newest stats of each camera are kept,
+ * and they are sent as soon as there is room again.
+ */
+
+#ifndef EVENT_CHANNEL_H
+#define EVENT_CHANNEL_H
+
+#include <cstdint>  /* for std::uint16_t, std::int16_t, std::uint64_t */
+#include <string>   /* for std::string */
+
+// You can change this to make the syslog() output to a different file.
+#define log_facility LOG_LOCAL0
+
+
+enum Gui_event_type : std::uint16_t {
+    EVENT_DAEMON_FAILED = 1,    // The SmartCCTV Daemon stopped because of an error, text says why.
+    EVENT_PERMISSION_ERROR,     // The SmartCCTV Daemon could not create text, it stopped.
+    EVENT_CAMERA_ERROR,         // The camera failed, text says why. The daemon stops when all of it's cameras stopped.
+    EVENT_VIEWER_STOPPED,       // The LiveStream Viewer stopped, text says why.
+    EVENT_DETECTION_STARTED,    // The camera started recording a detection event.
+    EVENT_DETECTION_ENDED,      // The camera stopped recording the detection event.
+    EVENT_CLIP_SAVED,           // The video of a detection event was saved as text.
+    EVENT_CAMERA_STATS,         // The counters of the camera, sent about once a second while it records.
+    EVENT_DISK_FULL             // The disk of the recordings is almost full and no video is left to delete, text says how full.
+};
+
+struct Gui_event {
+    std::uint16_t type;      // A Gui_event_type.
+    std::int16_t camera;     // The number of the camera, -1 if the event is not about a camera.
+    std::uint32_t sender;    // The PID of the process that sent the event.
+    std::uint64_t time;      // When it happened, in milliseconds since the epoch.
+    // Only used by EVENT_CAMERA_STATS, the counters since the camera started recording.
+    std::uint64_t captured;
+    std::uint64_t dropped;
+    std::uint64_t analyzed;
+    std::uint64_t events;
+    float fps;               // The frames analyzed per second, since the previous stats.
+    char text[164];          // Ends with a '\0', cut short if it is too long.
+};
+
+
+/**
+ * This function sends an event to the GUI process. It never waits for the GUI.
+ * If the GUI is not running the event is thrown away, if it can't keep up the event waits in this process,
+ * and is sent together with the next one. Can be called from any thread.
+ *
+ * @param Gui_event_type type - What happened.
+ *
+ * @param int camera - The number of the camera, -1 if it is not about a camera.
+ *
+ * @param const std::string& text - The text of the event.
+ *
+ * @return bool - true if the event was sent or is waiting to be sent
+ *                false if the queue of the GUI process could not be opened
+ */
+bool send_gui_event(Gui_event_type type, int camera = -1, const std::string& text = "");
+
+/**
+ * This function sends the stats of a camera to the GUI process, see send_gui_event().
+ * Stats that are still waiting to be sent are replaced by these.
+ *
+ * @param const Gui_event& stats - An EVENT_CAMERA_STATS, with the camera and the counters filled in.
+ *
+ * @return bool - true if the stats were sent or are waiting to be sent
+ *                false if the queue of the GUI process could not be opened
+ */
+bool send_gui_stats(const Gui_event& stats);
+
+/**
+ * This function creates the queue of the event channel.
+ * It is called in the GUI process only.
+ *
+ * @return int - The file descriptor of the queue, it can be read when there is an event,
+ *               or -1 if it failed. errno is EEXIST if another GUI process has the queue.
+ */
+int open_gui_event_queue();
+
+/**
+ * This function reads the next event from the queue, without waiting.
+ * It is called in the GUI process only.
+ *
+ * @param int queue - The file descriptor from open_gui_event_queue().
+ *
+ * @param Gui_event& event - The event.
+ *
+ * @return bool - true if there was an event
+ *                false if the queue is empty
+ */
+bool receive_gui_event(int queue, Gui_event& event);
+
+/**
+ * This function closes the queue and removes it. The processes that still have it open
+ * open the queue of the next GUI process once the old queue is full.
+ * It is called in the GUI process only.
+ *
+ * @param int queue - The file descriptor from open_gui_event_queue().
+ */
+void close_gui_event_queue(int queue);
+
+
+#endif  /* EVENT_CHANNEL_H */
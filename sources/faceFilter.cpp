@@ -11,12 +11,14 @@
  * Each instance of this class is to correspond to a single camera or video file.
  */
  
-#include "write_message.h"
+#include "event_channel.h"
 #include "low_level_cctv_daemon_apis.h"
 #include "faceFilter.hpp"
 #include <syslog.h>  /* for syslog() */
 #include <cstdlib>   /* for getenv(), EXIT_FAILURE */
 #include <string>    /* for std::string */
+#include <fstream>   /* for std::ifstream */
+#include <sstream>   /* for std::ostringstream */
 
 using std::string;
 
@@ -34,50 +36,68 @@ FaceFilter::FaceFilter()
         //Error state! Exit the daemon
         syslog(log_facility | LOG_ERR, "Error: $SmartCCTV_Project_dir environmental varaible not set : failed to identify project directory");
         syslog(log_facility | LOG_CRIT, "%s", error_message.c_str());
-        write_message("Cannot find project configuration files.");
+        send_gui_event(EVENT_DAEMON_FAILED, -1, "Cannot find project configuration files.");
         daemon_data.daemon_exit_status = EXIT_FAILURE;
         terminate_daemon(0);
     }
     string fullPath = SmartCCTV_Project_dir;
     fullPath.append("/cascade.xml");
+
+    const string& cascadeData = sharedCascadeData(fullPath);
+    bool loaded = false;
+    if (!cascadeData.empty())
+    {
+        cv::FileStorage storage(cascadeData, cv::FileStorage::READ | cv::FileStorage::MEMORY);
+        loaded = storage.isOpened() && cascade.read(storage.getFirstTopLevelNode());
+    }
 	
-	if (!cascade.load(fullPath))
+	if (!loaded)
     {
         //Error state! Exit the daemon
         syslog(log_facility | LOG_ERR, "Could not open %s", fullPath.c_str());
         syslog(log_facility | LOG_CRIT, "%s", error_message.c_str());
-        write_message("Cannot find project configuration files.");
+        send_gui_event(EVENT_DAEMON_FAILED, -1, "Cannot find project configuration files.");
         daemon_data.daemon_exit_status = EXIT_FAILURE;
         terminate_daemon(0);
     }
 }
 
-bool FaceFilter::runRecognition(cv::Mat &frame)
+const string& FaceFilter::sharedCascadeData(const string& fullPath)
 {
-    boxes.clear();
-    cv::Mat gray, smallImg;
+    // A function local static is initialized exactly once, even if several cameras get here at once.
+    // If the file can not be read the string stays empty.
+    static const string cascadeData = [&fullPath]()
+    {
+        std::ifstream cascadeFile(fullPath);
+        std::ostringstream contents;
+        if (cascadeFile.is_open())
+        {
+            contents << cascadeFile.rdbuf();
+        }
+        return contents.str();
+    }();
+    return cascadeData;
+}
 
+void FaceFilter::detect(const cv::Mat &frame, std::vector<cv::Rect> &faces)
+{
     cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
     equalizeHist(gray, gray);
-    cascade.detectMultiScale(gray, boxes, 1.1, 2, 0 | cv::CASCADE_SCALE_IMAGE, cv::Size(30, 30));
-    
-    if(boxes.size() < 1)
-    {
-		return false;
-	}
-    
-    if(daemon_data.enable_outlines)
+    detectEqualized(gray, faces);
+}
+
+void FaceFilter::detectEqualized(const cv::Mat &equalized, std::vector<cv::Rect> &faces)
+{
+    faces.clear();
+
+    cascade.detectMultiScale(equalized, faces, 1.1, 2, 0 | cv::CASCADE_SCALE_IMAGE, cv::Size(30, 30));
+
+    for(size_t i = 0; i < faces.size(); i++)
     {
-		for(size_t i = 0; i < boxes.size(); i++)
-		{
-			cv::Rect &rect = boxes[i];        
-			rect.x += cvRound(rect.width*0.1);
-			rect.width = cvRound(rect.width*0.8);
-			rect.y += cvRound(rect.height*0.07);
-			rect.height = cvRound(rect.height*0.8);
-			rectangle(frame, rect.tl(), rect.br(), cv::Scalar(255, 0, 0), 2);
-		}
-	}
-    
-    return true;
+        cv::Rect &rect = faces[i];
+        rect.x += cvRound(rect.width*0.1);
+        rect.width = cvRound(rect.width*0.8);
+        rect.y += cvRound(rect.height*0.07);
+        rect.height = cvRound(rect.height*0.8);
+    }
 }
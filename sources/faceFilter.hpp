@@ -20,16 +20,23 @@
 #include <opencv2/videoio.hpp>
 #include <iostream>
 #include <vector>
+#include <string>
 #include <iomanip>
 
 class FaceFilter
 {
 public:
 	FaceFilter();
-	bool runRecognition(cv::Mat &frame);
+	// Only finds the faces, the frame is not drawn on.
+	void detect(const cv::Mat &frame, std::vector<cv::Rect> &faces);
+	// The same, on a frame that is already converted to grayscale and equalized.
+	void detectEqualized(const cv::Mat &equalized, std::vector<cv::Rect> &faces);
     
 private:
+	// cascade.xml is read from the disk only once and every camera parses its classifier from that copy.
+	// The classifier itself can not be shared, detectMultiScale() keeps per image state inside of it.
+	static const std::string& sharedCascadeData(const std::string& fullPath);
 	cv::CascadeClassifier cascade;
-	std::vector<cv::Rect> boxes;
+	cv::Mat gray;
 };
 #endif
@@ -0,0 +1,134 @@
+/**
+ * File Name:  frameContext.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class holds the images that the filters derive from a frame: grayscale, equalized, blurred and scaled down.
+ * Each image is only computed the first time a filter asks for it, and then every other filter gets the same image,
+ * so no filter converts the frame again. The storage is reused from one frame to the next.
+ * Each instance of this class is to correspond to a single camera or video file.
+ */
+
+#include "frameContext.hpp"
+#include <opencv2/imgproc.hpp>
+
+
+FrameContext::FrameContext()
+ : grayValid(false), equalizedValid(false), blurredValid(false), halfBlurredValid(false)
+{
+}
+
+
+void FrameContext::reset(cv::Mat& frame)
+{
+	bgrFrame = frame;
+	grayValid = false;
+	equalizedValid = false;
+	blurredValid = false;
+	halfBlurredValid = false;
+	for(ScaledImage& level : scaledFrames)
+	{
+		level.valid = false;
+	}
+	for(ScaledImage& level : scaledEqualizedFrames)
+	{
+		level.valid = false;
+	}
+}
+
+
+const cv::Mat& FrameContext::gray()
+{
+	if(!grayValid)
+	{
+		cv::cvtColor(bgrFrame, grayFrame, cv::COLOR_BGR2GRAY);
+		grayValid = true;
+	}
+	return grayFrame;
+}
+
+
+const cv::Mat& FrameContext::equalized()
+{
+	if(!equalizedValid)
+	{
+		cv::equalizeHist(gray(), equalizedFrame);
+		equalizedValid = true;
+	}
+	return equalizedFrame;
+}
+
+
+const cv::Mat& FrameContext::blurred()
+{
+	if(!blurredValid)
+	{
+		cv::GaussianBlur(gray(), blurredFrame, cv::Size(21, 21), 0);
+		blurredValid = true;
+	}
+	return blurredFrame;
+}
+
+
+const cv::Mat& FrameContext::halfBlurred()
+{
+	if(!halfBlurredValid)
+	{
+		cv::resize(gray(), halfGrayFrame, cv::Size(), 0.5, 0.5, cv::INTER_AREA);
+		cv::GaussianBlur(halfGrayFrame, halfBlurredFrame, cv::Size(11, 11), 0);
+		halfBlurredValid = true;
+	}
+	return halfBlurredFrame;
+}
+
+
+const cv::Mat& FrameContext::findScaled(std::vector<ScaledImage>& levels, const cv::Mat& source, double scale)
+{
+	// There are only ever one or two scales in use, a list is the quickest to search.
+	ScaledImage* level = nullptr;
+	for(ScaledImage& candidate : levels)
+	{
+		if(candidate.scale == scale)
+		{
+			level = &candidate;
+			break;
+		}
+	}
+	if(level == nullptr)
+	{
+		levels.push_back(ScaledImage{ scale, false, cv::Mat() });
+		level = &levels.back();
+	}
+
+	if(!level->valid)
+	{
+		// INTER_AREA averages the pixels that are merged, so small details don't alias into false edges.
+		cv::resize(source, level->image, cv::Size(), scale, scale, cv::INTER_AREA);
+		level->valid = true;
+	}
+	return level->image;
+}
+
+
+const cv::Mat& FrameContext::scaled(double scale)
+{
+	if(scale >= 1)
+	{
+		return bgrFrame;
+	}
+	return findScaled(scaledFrames, bgrFrame, scale);
+}
+
+
+const cv::Mat& FrameContext::scaledEqualized(double scale)
+{
+	if(scale >= 1)
+	{
+		return equalized();
+	}
+	return findScaled(scaledEqualizedFrames, equalized(), scale);
+}
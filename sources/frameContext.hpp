@@ -0,0 +1,69 @@
+/**
+ * File Name:  frameContext.hpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class holds the images that the filters derive from a frame: grayscale, equalized, blurred and scaled down.
+ * Each image is only computed the first time a filter asks for it, and then every other filter gets the same image,
+ * so no filter converts the frame again. The storage is reused from one frame to the next.
+ * Each instance of this class is to correspond to a single camera or video file.
+ */
+
+#ifndef FRAMECONTEXT_HPP
+#define FRAMECONTEXT_HPP
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+class FrameContext
+{
+public:
+	FrameContext();
+
+	// Starts over with a new frame, the images of the previous frame are forgotten.
+	// The frame is not copied, it has to stay alive until the next call to reset().
+	void reset(cv::Mat& frame);
+
+	// The frame itself in BGR, the outlines are drawn into it.
+	cv::Mat& frame() { return bgrFrame; }
+	const cv::Mat& gray();
+	// The grayscale frame with it's histogram equalized, for the face detector.
+	const cv::Mat& equalized();
+	// The grayscale frame with a 21x21 Gaussian blur, for the motion detection.
+	const cv::Mat& blurred();
+	// The grayscale frame at half the width and height with an 11x11 Gaussian blur, the same blur as blurred()
+	// at a quarter of the pixels, for the fused motion detection.
+	const cv::Mat& halfBlurred();
+	// The frame, and the equalized frame, scaled down by scale (1 gives back the full resolution).
+	const cv::Mat& scaled(double scale);
+	const cv::Mat& scaledEqualized(double scale);
+
+private:
+	struct ScaledImage
+	{
+		double scale;
+		bool valid;
+		cv::Mat image;
+	};
+
+	const cv::Mat& findScaled(std::vector<ScaledImage>& levels, const cv::Mat& source, double scale);
+
+	cv::Mat bgrFrame;
+	cv::Mat grayFrame;
+	cv::Mat equalizedFrame;
+	cv::Mat blurredFrame;
+	cv::Mat halfGrayFrame;
+	cv::Mat halfBlurredFrame;
+	bool grayValid;
+	bool equalizedValid;
+	bool blurredValid;
+	bool halfBlurredValid;
+	std::vector<ScaledImage> scaledFrames;
+	std::vector<ScaledImage> scaledEqualizedFrames;
+};
+
+#endif
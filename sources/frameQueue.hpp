@@ -0,0 +1,281 @@
+/**
+ * File Name:  frameQueue.hpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class is a fixed-capacity queue that hands frames from the grabber thread of a Camera
+ * to it's analysis thread. There is exactly one producer (the grabber) and one consumer (the analysis loop).
+ * Pushing and popping never take a lock, each slot carries a sequence number that says whose turn it is.
+ * When the queue is full, the OverflowPolicy decides what happens to the new frame.
+ */
+
+#ifndef FRAMEQUEUE_HPP
+#define FRAMEQUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <errno.h>      /* for errno, EINTR */
+#include <semaphore.h>  /* for sem_init(), sem_post(), sem_wait(), sem_destroy() */
+
+enum class OverflowPolicy
+{
+	DropOldest,  // throw away the oldest queued frame to make room, the queue always has the newest frames
+	DropNewest,  // throw away the frame that is being pushed
+	Block        // wait until the consumer makes room, no frame is ever lost
+};
+
+template <typename T>
+class FrameQueue
+{
+public:
+	FrameQueue(std::size_t capacity, OverflowPolicy policy);
+	~FrameQueue();
+	FrameQueue(const FrameQueue&) = delete;
+	FrameQueue& operator=(const FrameQueue&) = delete;
+
+	// Called by the producer only.
+	// Returns false if this item was dropped, or if the queue was closed.
+	bool push(T&& item);
+
+	// Called by the producer only, whatever the policy is.
+	// Waits until there is room for the item, returns false only if the queue was closed.
+	bool pushWait(T&& item);
+
+	// Called by the consumer only.
+	// Waits until there is an item, returns false once the queue is closed and empty.
+	bool pop(T& item);
+
+	// Takes the oldest item if there is one, never waits.
+	bool tryPop(T& item);
+
+	// Wakes up the consumer and makes every later push() fail.
+	void close();
+
+	std::size_t capacity() const { return slotCount; }
+	// Every item that push() accepted, an item that was evicted later was accepted first.
+	std::uint64_t pushedCount() const { return pushed.load(std::memory_order_relaxed); }
+	// The items that push() turned away (DropNewest), and the accepted ones it threw out to make room (DropOldest).
+	std::uint64_t rejectedCount() const { return rejected.load(std::memory_order_relaxed); }
+	std::uint64_t evictedCount() const { return evicted.load(std::memory_order_relaxed); }
+	// Every item that was handed to push() and that the consumer never gets.
+	std::uint64_t droppedCount() const { return rejectedCount() + evictedCount(); }
+	// Every item that was handed to push() while the queue was open.
+	std::uint64_t offeredCount() const { return pushedCount() + rejectedCount(); }
+
+private:
+	// Puts the item into the next slot if it is free, the item is only moved from if it returns true.
+	bool tryPush(T& item);
+
+	struct Slot
+	{
+		// sequence == position      the slot is free for the push at that position
+		// sequence == position + 1  the slot holds the item pushed at that position
+		std::atomic<std::size_t> sequence;
+		T item;
+	};
+
+	// At least 2, with a single slot "holds position p" and "free for position p + 1" would look the same.
+	const std::size_t slotCount;
+	const OverflowPolicy policy;
+	std::unique_ptr<Slot[]> slots;
+	// The two positions are written by different threads, keep them on different cache lines.
+	alignas(64) std::atomic<std::size_t> enqueuePosition;
+	alignas(64) std::atomic<std::size_t> dequeuePosition;
+	alignas(64) std::atomic<bool> closed;
+	std::atomic<std::uint64_t> pushed;
+	std::atomic<std::uint64_t> rejected;
+	std::atomic<std::uint64_t> evicted;
+	// Only used to put the consumer to sleep while the queue is empty, it is not part of the data path.
+	sem_t itemsAvailable;
+	// The same for a producer in pushWait() while the queue is full, the consumer only posts it while one waits.
+	std::atomic<bool> producerWaiting;
+	sem_t spaceAvailable;
+};
+
+
+template <typename T>
+FrameQueue<T>::FrameQueue(std::size_t capacity, OverflowPolicy policy)
+ : slotCount(capacity > 2 ? capacity : 2), policy(policy), slots(new Slot[capacity > 2 ? capacity : 2]),
+   enqueuePosition(0), dequeuePosition(0), closed(false), pushed(0), rejected(0), evicted(0), producerWaiting(false)
+{
+	for (std::size_t i = 0; i < slotCount; i++)
+	{
+		slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+	sem_init(&itemsAvailable, 0, 0);
+	sem_init(&spaceAvailable, 0, 0);
+}
+
+
+template <typename T>
+FrameQueue<T>::~FrameQueue()
+{
+	sem_destroy(&itemsAvailable);
+	sem_destroy(&spaceAvailable);
+}
+
+
+template <typename T>
+bool FrameQueue<T>::tryPush(T& item)
+{
+	std::size_t position = enqueuePosition.load(std::memory_order_relaxed);
+	Slot& slot = slots[position % slotCount];
+	if (slot.sequence.load(std::memory_order_acquire) != position)
+	{
+		return false;
+	}
+	slot.item = std::move(item);
+	slot.sequence.store(position + 1, std::memory_order_release);
+	enqueuePosition.store(position + 1, std::memory_order_relaxed);
+	pushed.fetch_add(1, std::memory_order_relaxed);
+	sem_post(&itemsAvailable);
+	return true;
+}
+
+
+template <typename T>
+bool FrameQueue<T>::push(T&& item)
+{
+	if (policy == OverflowPolicy::Block)
+	{
+		return pushWait(std::move(item));
+	}
+	while (!closed.load(std::memory_order_acquire))
+	{
+		if (tryPush(item))
+		{
+			return true;
+		}
+
+		// The queue is full.
+		if (policy == OverflowPolicy::DropNewest)
+		{
+			rejected.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		else if (policy == OverflowPolicy::DropOldest)
+		{
+			// The producer steals the oldest item, exactly like the consumer would.
+			// If the consumer is still moving out of the slot we need, this just goes around again.
+			T oldest;
+			if (tryPop(oldest))
+			{
+				evicted.fetch_add(1, std::memory_order_relaxed);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+	return false;
+}
+
+
+template <typename T>
+bool FrameQueue<T>::pushWait(T&& item)
+{
+	while (!closed.load(std::memory_order_acquire))
+	{
+		if (tryPush(item))
+		{
+			return true;
+		}
+		producerWaiting.store(true);
+		// The consumer may have made room before it could see the flag, so look once more before going to sleep.
+		if (tryPush(item))
+		{
+			producerWaiting.store(false);
+			return true;
+		}
+		if (closed.load(std::memory_order_acquire))
+		{
+			break;
+		}
+		// close() posts it too, a post left over from an earlier wait just goes around the loop again.
+		while (sem_wait(&spaceAvailable) == -1 && errno == EINTR)
+		{
+		}
+	}
+	producerWaiting.store(false);
+	return false;
+}
+
+
+template <typename T>
+bool FrameQueue<T>::tryPop(T& item)
+{
+	std::size_t position = dequeuePosition.load(std::memory_order_relaxed);
+	while (true)
+	{
+		Slot& slot = slots[position % slotCount];
+		std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+		if (sequence == position + 1)
+		{
+			// The consumer and a dropping producer may both want this slot, only one of them gets it.
+			if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				item = std::move(slot.item);
+				slot.item = T();
+				slot.sequence.store(position + slotCount, std::memory_order_release);
+				if (producerWaiting.exchange(false))
+				{
+					sem_post(&spaceAvailable);
+				}
+				return true;
+			}
+			// compare_exchange_weak() reloaded position, try again.
+		}
+		else if (sequence == position)
+		{
+			// Nothing has been pushed into this slot yet, the queue is empty.
+			return false;
+		}
+		else
+		{
+			position = dequeuePosition.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+
+template <typename T>
+bool FrameQueue<T>::pop(T& item)
+{
+	while (true)
+	{
+		if (tryPop(item))
+		{
+			return true;
+		}
+		if (closed.load(std::memory_order_acquire))
+		{
+			// One last look, the producer may have pushed right before it closed the queue.
+			return tryPop(item);
+		}
+		// The semaphore count is only a hint, dropped items leave extra posts behind.
+		// Spurious wake ups simply go around the loop again.
+		while (sem_wait(&itemsAvailable) == -1 && errno == EINTR)
+		{
+		}
+	}
+}
+
+
+template <typename T>
+void FrameQueue<T>::close()
+{
+	closed.store(true, std::memory_order_release);
+	sem_post(&itemsAvailable);
+	sem_post(&spaceAvailable);
+}
+
+#endif
@@ -0,0 +1,274 @@
+/**
+ * File Name:  frameRing.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class is a fixed-capacity circular buffer of frames, used by the Camera to remember the frames
+ * before and during a detection event. The cv::Mat of every slot is reused, a new frame is copied into
+ * the storage of the frame that it replaces, so once every slot has been filled once, no more memory is allocated.
+ *
+ * The frames can also be kept compressed, either as JPEG images or as planar YUV 4:2:0,
+ * and the total size of the kept frames can be capped by a memory budget.
+ */
+
+#include "frameRing.hpp"
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <algorithm>
+#include <utility>
+
+FrameRing::FrameRing()
+ : usableSlots(1), oldest(0), count(0), overwritten(0), compressionFormat(FrameCompression::None),
+   memoryBudget(0), heldBytes(0)
+{
+	slots.resize(1);
+}
+
+
+void FrameRing::setCapacity(std::size_t capacity)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	slots.clear();
+	slots.resize(capacity > 0 ? capacity : 1);
+	usableSlots = slots.size();
+	oldest = 0;
+	count = 0;
+	overwritten = 0;
+	heldBytes = 0;
+	frameDimensions = cv::Size();
+}
+
+
+void FrameRing::setCompression(FrameCompression compression, int jpegQuality, std::size_t memoryBudget)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	compressionFormat = compression;
+	jpegParameters = { cv::IMWRITE_JPEG_QUALITY, jpegQuality };
+	this->memoryBudget = memoryBudget;
+	for(frameContainer& slot : slots)
+	{
+		slot.frame.release();
+		std::vector<uchar>().swap(slot.jpeg);
+	}
+	usableSlots = slots.size();
+	oldest = 0;
+	count = 0;
+	overwritten = 0;
+	heldBytes = 0;
+	frameDimensions = cv::Size();
+}
+
+
+std::size_t FrameRing::frameBytes(const frameContainer& slot) const
+{
+	if(compressionFormat == FrameCompression::Jpeg)
+	{
+		return slot.jpeg.size();
+	}
+	return slot.frame.total() * slot.frame.elemSize();
+}
+
+
+void FrameRing::dropOldest()
+{
+	// The storage of the slot is kept for the frame that is pushed into it next.
+	heldBytes -= frameBytes(slots[oldest]);
+	oldest = (oldest + 1) % usableSlots;
+	count--;
+}
+
+
+void FrameRing::resizeUsedSlots(std::size_t usable)
+{
+	// The frames are moved to the front first, rotating swaps the slots and allocates nothing.
+	std::rotate(slots.begin(), slots.begin() + oldest, slots.begin() + usableSlots);
+	oldest = 0;
+	for(std::size_t i = usable; i < usableSlots; i++)
+	{
+		std::vector<uchar>().swap(slots[i].jpeg);
+	}
+	usableSlots = usable;
+}
+
+
+void FrameRing::fitJpegBudget(std::size_t newBytes)
+{
+	bool dropped = false;
+	while(count > 0 && heldBytes + newBytes > memoryBudget)
+	{
+		dropOldest();
+		overwritten++;
+		dropped = true;
+	}
+	// The sizes of the JPEG images are only known once they are encoded, so the slots follow the budget:
+	// when the budget runs out before the slots do, the slots past the frames that fit are given up,
+	// and while there is room in the budget, a full ring gets one more slot instead of dropping a frame.
+	// The slots that are kept keep their storage, so from then on the images are encoded into reused buffers.
+	if(dropped && count + 1 < usableSlots)
+	{
+		resizeUsedSlots(count + 1);
+	}
+	else if(!dropped && count == usableSlots && usableSlots < slots.size())
+	{
+		resizeUsedSlots(usableSlots + 1);
+	}
+}
+
+
+void FrameRing::push(const cv::Mat& frame, std::chrono::time_point<std::chrono::high_resolution_clock> start)
+{
+	// The compression is the slow part, so it is done before taking the lock.
+	if(compressionFormat == FrameCompression::Jpeg)
+	{
+		cv::imencode(".jpg", frame, scratch.jpeg, jpegParameters);
+	}
+	else if(compressionFormat == FrameCompression::Yuv420)
+	{
+		cv::cvtColor(frame, scratch.frame, cv::COLOR_BGR2YUV_I420);
+	}
+
+	std::lock_guard<std::mutex> guard(mutex);
+
+	if(frameDimensions != frame.size())
+	{
+		frameDimensions = frame.size();
+		// Raw and YUV frames always take the same number of bytes, so the budget is simply a number of slots.
+		// This is decided while the ring is empty, so the slots are never allocated beyond the budget.
+		if(memoryBudget > 0 && compressionFormat != FrameCompression::Jpeg && count == 0)
+		{
+			std::size_t bytesPerFrame = frame.total() * frame.elemSize();
+			if(compressionFormat == FrameCompression::Yuv420)
+			{
+				bytesPerFrame = bytesPerFrame / 2;
+			}
+			std::size_t fitting = bytesPerFrame > 0 ? memoryBudget / bytesPerFrame : slots.size();
+			usableSlots = std::max<std::size_t>(1, std::min(fitting, slots.size()));
+			oldest = 0;
+		}
+	}
+
+	if(compressionFormat == FrameCompression::Jpeg && memoryBudget > 0)
+	{
+		fitJpegBudget(scratch.jpeg.size());
+	}
+
+	if(count == usableSlots)
+	{
+		// Full, the slot of the oldest frame becomes the slot of the newest one.
+		dropOldest();
+		overwritten++;
+	}
+
+	frameContainer& slot = slots[(oldest + count) % usableSlots];
+	if(compressionFormat == FrameCompression::None)
+	{
+		// copyTo() only allocates if the slot is still empty or the frame size has changed.
+		frame.copyTo(slot.frame);
+	}
+	else if(compressionFormat == FrameCompression::Jpeg)
+	{
+		std::swap(slot.jpeg, scratch.jpeg);
+	}
+	else
+	{
+		std::swap(slot.frame, scratch.frame);
+	}
+	slot.start = start;
+	heldBytes += frameBytes(slot);
+	count++;
+}
+
+
+bool FrameRing::popOldest(frameContainer& container)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	if(count == 0)
+	{
+		return false;
+	}
+	// Moving the storage out would leave the slot empty, and the ring would allocate again after every event.
+	const frameContainer& slot = slots[oldest];
+	if(compressionFormat == FrameCompression::Jpeg)
+	{
+		container.jpeg.assign(slot.jpeg.begin(), slot.jpeg.end());
+		container.frame.release();
+	}
+	else
+	{
+		slot.frame.copyTo(container.frame);
+		container.jpeg.clear();
+	}
+	container.start = slot.start;
+	dropOldest();
+	return true;
+}
+
+
+void FrameRing::dropOlderThan(std::chrono::time_point<std::chrono::high_resolution_clock> limit)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	// The frames are in capture order, so this stops at the first frame that is new enough.
+	while(count > 0 && slots[oldest].start < limit)
+	{
+		dropOldest();
+	}
+}
+
+
+void FrameRing::clear()
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	while(count > 0)
+	{
+		dropOldest();
+	}
+	oldest = 0;
+	overwritten = 0;
+}
+
+
+std::size_t FrameRing::size() const
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	return count;
+}
+
+
+std::size_t FrameRing::memoryUsed() const
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	return heldBytes;
+}
+
+
+const frameContainer& FrameRing::operator[](std::size_t index) const
+{
+	return slots[(oldest + index) % usableSlots];
+}
+
+
+void decodeFrame(const frameContainer& container, FrameCompression format, cv::Mat& frame)
+{
+	if(format == FrameCompression::Jpeg)
+	{
+		frame = cv::imdecode(container.jpeg, cv::IMREAD_COLOR);
+	}
+	else if(format == FrameCompression::Yuv420)
+	{
+		cv::cvtColor(container.frame, frame, cv::COLOR_YUV2BGR_I420);
+	}
+	else
+	{
+		frame = container.frame;
+	}
+}
+
+
+void FrameRing::decode(std::size_t index, cv::Mat& frame) const
+{
+	decodeFrame((*this)[index], compressionFormat, frame);
+}
@@ -0,0 +1,115 @@
+/**
+ * File Name:  frameRing.hpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class is a fixed-capacity circular buffer of frames, used by the Camera to remember the frames
+ * before and during a detection event. The cv::Mat of every slot is reused, a new frame is copied into
+ * the storage of the frame that it replaces, so once every slot has been filled once, no more memory is allocated.
+ *
+ * The frames can also be kept compressed, either as JPEG images or as planar YUV 4:2:0,
+ * and the total size of the kept frames can be capped by a memory budget.
+ */
+
+#ifndef FRAMERING_HPP
+#define FRAMERING_HPP
+
+#include <opencv2/core.hpp>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+struct frameContainer
+{
+	cv::Mat frame;              // BGR, or YUV 4:2:0 if the ring is compressed that way
+	std::vector<uchar> jpeg;    // the JPEG image if the ring is compressed that way
+	std::chrono::time_point<std::chrono::high_resolution_clock> start;
+};
+
+enum class FrameCompression
+{
+	None,    // raw BGR, 3 bytes per pixel
+	Jpeg,    // intra-only JPEG, about 10 times smaller, can be written into a Motion JPEG video as it is
+	Yuv420   // planar YUV 4:2:0, 1.5 bytes per pixel, lossless apart from the color subsampling
+};
+
+// Gives back a frame that was stored in the given format as a BGR image.
+void decodeFrame(const frameContainer& container, FrameCompression format, cv::Mat& frame);
+
+class FrameRing
+{
+public:
+	FrameRing();
+
+	// Throws away all the frames and makes room for capacity frames.
+	// The storage of the slots is allocated the first time each slot is used.
+	void setCapacity(std::size_t capacity);
+
+	// Throws away all the frames, and keeps the new ones in this format.
+	// memoryBudget is the most bytes that the kept frames may take up, 0 means no limit.
+	void setCompression(FrameCompression compression, int jpegQuality, std::size_t memoryBudget);
+
+	// Copies (or compresses) the frame into the slot after the newest frame.
+	// If the ring is full, or over it's memory budget, the oldest frames are overwritten.
+	// Only one thread at a time may push, but it may be a different thread than the one that reads the frames.
+	void push(const cv::Mat& frame, std::chrono::time_point<std::chrono::high_resolution_clock> start);
+
+	// Copies the oldest frame into container and forgets it, the slot keeps it's storage for the next push().
+	// The storage of container is reused if it is big enough.
+	// Returns false if the ring is empty.
+	bool popOldest(frameContainer& container);
+
+	// Forgets every frame that was captured before limit, oldest first.
+	void dropOlderThan(std::chrono::time_point<std::chrono::high_resolution_clock> limit);
+
+	// Forgets every frame, the storage is kept for reuse.
+	void clear();
+
+	// index 0 is the oldest frame
+	// The frames may only be read while no push() is running.
+	const frameContainer& operator[](std::size_t index) const;
+	// Gives back the frame at index as a BGR image, whatever the compression.
+	void decode(std::size_t index, cv::Mat& frame) const;
+	std::size_t size() const;
+	bool empty() const { return size() == 0; }
+	std::size_t capacity() const { return usableSlots; }
+	FrameCompression compression() const { return compressionFormat; }
+	// The size of the frames that were pushed, they all have the same size.
+	cv::Size frameSize() const { return frameDimensions; }
+	std::size_t memoryUsed() const;
+
+	// How many frames were overwritten before they were used, since the last call to clear().
+	std::size_t overwrittenCount() const { return overwritten; }
+
+private:
+	void dropOldest();
+	// Drops the oldest JPEG images until the new one fits into the budget, and adjusts the slots that are used.
+	void fitJpegBudget(std::size_t newBytes);
+	// Uses only the first usable slots, the frames are kept and the storage of the slots past them is freed.
+	void resizeUsedSlots(std::size_t usable);
+	std::size_t frameBytes(const frameContainer& slot) const;
+
+	std::vector<frameContainer> slots;
+	// With a memory budget, only as many slots as fit into the budget are used.
+	// For raw and YUV frames that is fixed by the frame size, for JPEG images it follows their sizes.
+	std::size_t usableSlots;
+	std::size_t oldest;
+	std::size_t count;
+	std::size_t overwritten;
+	FrameCompression compressionFormat;
+	std::vector<int> jpegParameters;
+	std::size_t memoryBudget;
+	std::size_t heldBytes;
+	cv::Size frameDimensions;
+	// The compressed frame is made here first, then swapped with the storage of it's slot,
+	// so the buffers go around the ring instead of being allocated again.
+	frameContainer scratch;
+	mutable std::mutex mutex;
+};
+
+#endif
@@ -13,24 +13,38 @@
 
 #include "high_level_cctv_daemon_apis.h"
 #include "low_level_cctv_daemon_apis.h"
-#include "write_message.h"
+#include "control_channel.h"
 
 #include <sys/types.h>
-#include <sys/stat.h>   /* for umask(), mode permissions constants */
-#include <fcntl.h>      /* for O_* constants, open() */
-#include <signal.h>     /* for kill() */
-#include <unistd.h>     /* for fork() */
+#include <sys/socket.h> /* for send(), recv() */
+#include <unistd.h>     /* for fork(), close() */
+#include <fcntl.h>      /* for fcntl() */
 #include <errno.h>      /* for errno */
 #include <syslog.h>     /* for syslog() */
-#include <cstdlib>      /* for exit(), EXIT_SUCCESS, EXIT_FAILURE */
-#include <cstdio>       /* for fopen(), fdopen(), fclose(), fseek(), fgetc(), fscanf(), FILE */
-#include <cctype>       /* for isdigit() */
+#include <string>       /* for std::string, std::to_string() */
+#include <vector>       /* for std::vector */
+
+using std::string;
+using std::vector;
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-result"
 
 
 extern Daemon_data daemon_data;
+extern vector<string> camera_sources;
+
+Daemon_facade::Daemon_facade()
+ : connection_fd(-1)
+{
+}
+
+
+Daemon_facade::~Daemon_facade()
+{
+    close_connection();
+}
+
 
 void Daemon_facade::set_daemon_info(const char* home_directory)
 {
@@ -39,42 +53,35 @@ void Daemon_facade::set_daemon_info(const char* home_directory)
 
 
 int Daemon_facade::run_daemon(bool enable_human_detection, bool enable_motion_detection, bool enable_outlines, int cameraNumber)
+{
+    daemon_data.cameraNumber = cameraNumber;
+    return run_daemon(enable_human_detection, enable_motion_detection, enable_outlines, vector<string>{ std::to_string(cameraNumber) });
+}
+
+
+int Daemon_facade::run_daemon(bool enable_human_detection, bool enable_motion_detection, bool enable_outlines, const vector<string>& camera_sources)
 {
     // User has requested to start the SmartCCTV daemon.
     daemon_data.enable_human_detection = enable_human_detection;
     daemon_data.enable_motion_detection = enable_motion_detection;
     daemon_data.enable_outlines = enable_outlines;
-    daemon_data.cameraNumber = cameraNumber;
+    // The daemon process inherits this list when it is forked.
+    ::camera_sources = camera_sources;
 
     enum return_states { SUCCESS, DAEMON_ALREADY_RUNNING, PERMISSIONS_ERROR };
 
-    if (!checkPidFile(true)) {
-        syslog(log_facility | LOG_ERR, "Error: A SmartCCTV Daemon is already running with PID %d", daemon_data.camera_daemon_pid);
-        // Close the PID file, since it was opened in checkPidFile() function.
-        if (fclose(daemon_data.pid_file_pointer) == EOF) {
-            syslog(log_facility | LOG_ERR, "Error: Could not close PID file %s : %m", daemon_data.pid_file_name);
+    // The control socket is like a lock file. It must be bound before the daemon starts up,
+    // so that a second daemon can't start, and so the GUI knows right away if it can't start.
+    // Only one process can bind the name, and the kernel lets go of it when the daemon exits, however it exits.
+    if ( (daemon_data.control_socket_fd = bind_control_socket(daemon_control_socket, true)) == -1) {
+        if (errno == EADDRINUSE) {
+            syslog(log_facility | LOG_ERR, "Error: A SmartCCTV Daemon is already running.");
+            return DAEMON_ALREADY_RUNNING;
         }
-
-        return DAEMON_ALREADY_RUNNING;
-    }
-
-    // Reset the umask so that you have no problems creating the file with the desired permissions.
-    umask(0);
-    // The process ID file is like a lock file. It must be created before the daemon starts up.
-    // Create the process ID file and obtain a handle to it.
-    // Do that before you become a daemon, becuase if the file was failed to create,
-    // you can't write the PID of the daemon process into that file.
-    if ( (daemon_data.pid_file_descriptor = open(daemon_data.pid_file_name, O_CREAT | O_EXCL | O_WRONLY, S_IRUSR | S_IWUSR)) == -1) {
-        syslog(log_facility | LOG_ERR, "Error: Not able to create the file %s : %m", daemon_data.pid_file_name);
-
-        return PERMISSIONS_ERROR;
-    }
-    if ( (daemon_data.pid_file_pointer = fdopen(daemon_data.pid_file_descriptor, "w")) == NULL) {
-        syslog(log_facility | LOG_ERR, "Error: Not able to open the file %s : %m", daemon_data.pid_file_name);
-
+        syslog(log_facility | LOG_ERR, "Error: Not able to create the control socket : %m");
         return PERMISSIONS_ERROR;
     }
-    syslog(log_facility | LOG_NOTICE, "PID file created successfully");
+    syslog(log_facility | LOG_NOTICE, "Control socket created successfully");
 
     // At the point where you want to create a daemon, you're going to do a fork().
     // If you're the child, you're going to call this function from which you're never going to return.
@@ -82,17 +89,15 @@ int Daemon_facade::run_daemon(bool enable_human_detection, bool enable_motion_de
     // It will be inside this function for it's entire life time.
     // The parent will continue on and print a confirmation message to the user.
     if (fork() == 0) {
+        // The connection to a daemon that ran before is the GUI's, not the new daemon's.
+        close_connection();
         becomeDaemon();
     }
 
-    // After creating the PID file
-    // Close the PID file in the GUI process.
-    /*
-    if (close(daemon_data.pid_file_descriptor) == -1) {
-        syslog(log_facility | LOG_ERR, "Error: GUI process could not close PID file %s : %m", daemon_data.pid_file_name);
-    }
-    daemon_data.pid_file_pointer = nullptr;
-    */
+    // The daemon has it's own copy of the control socket.
+    // The GUI process must not keep it, or the name would stay taken after the daemon turns off.
+    close(daemon_data.control_socket_fd);
+    daemon_data.control_socket_fd = -1;
 
     syslog(log_facility | LOG_NOTICE, "Starting SmartCCTV Daemon");
     return SUCCESS;
@@ -102,126 +107,132 @@ int Daemon_facade::run_daemon(bool enable_human_detection, bool enable_motion_de
 bool Daemon_facade::kill_daemon()
 {
     // User has requested to stop the SmartCCTV daemon.
-
-    if (!checkPidFile(false)) {
+    if (!is_daemon_running()) {
         syslog(log_facility | LOG_ERR, "Error: A SmartCCTV Daemon not already running.");
 
         return false;
-    } else {
-        // Close the PID file, since it was opened in checkPidFile() function.
-        if (fclose(daemon_data.pid_file_pointer) == EOF) {
-            syslog(log_facility | LOG_ERR, "Error: Could not close PID file %s : %m", daemon_data.pid_file_name);
-        }
     }
 
     syslog(log_facility | LOG_NOTICE, "Killing SmartCCTV Daemon");
-    syslog(log_facility | LOG_NOTICE, "Removing PID file");
-    kill(daemon_data.camera_daemon_pid, SIGINT);
-    // The daemon will remove the PID file by itself.
+    string response;
+    if (!control_request(daemon_control_socket, "stop", response)) {
+        // A daemon that is still opening it's cameras reads the request as soon as it is done.
+        syslog(log_facility | LOG_WARNING, "The SmartCCTV Daemon did not answer the stop request yet.");
+    } else if (response != "ok") {
+        syslog(log_facility | LOG_ERR, "Error: The SmartCCTV Daemon refused to stop : %s", response.c_str());
+
+        return false;
+    }
 
     return true;
 }
 
 
-bool Daemon_facade::is_daemon_running()
+bool Daemon_facade::set_daemon_setting(const string& setting, int value)
 {
-    // if (A PID file created by the daemon exists) {
-    if (!checkPidFile(true)) {
-        // A SmartCCTV Daemon is already running.
-
-        // Close the PID file, since it was opened in checkPidFile() function.
-        if (fclose(daemon_data.pid_file_pointer) == EOF) {
-            syslog(log_facility | LOG_ERR, "Error: Could not close PID file %s : %m", daemon_data.pid_file_name);
+    string request = "set " + setting + " " + std::to_string(value) + "\n";
+    // A connection to a daemon that was stopped since is only noticed when the request can't be sent,
+    // then it is sent once more on a new connection.
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (!connect_to_daemon()) {
+            return false;
         }
+        if (send(connection_fd, request.data(), request.size(), MSG_NOSIGNAL) == static_cast<ssize_t>(request.size())) {
+            requested.push_back(setting);
+            syslog(log_facility | LOG_NOTICE, "Asked the SmartCCTV Daemon to set %s to %d", setting.c_str(), value);
+            return true;
+        }
+        syslog(log_facility | LOG_WARNING, "Could not send the request to the SmartCCTV Daemon : %m");
+        close_connection();
+    }
+    return false;
+}
 
-        return true;
-    } else {
-        // A SmartCCTV Daemon not already running.
+
+void Daemon_facade::set_retention_days(int days)
+{
+    // The daemon process inherits it when it is forked.
+    daemon_data.retention_days = days;
+    set_daemon_setting("retention_days", days);
+}
+
+
+int Daemon_facade::control_fd() const
+{
+    return connection_fd;
+}
+
+
+bool Daemon_facade::read_daemon_answers(vector<string>& refused)
+{
+    if (connection_fd == -1) {
         return false;
     }
+    char buffer[256];
+    ssize_t received;
+    while ( (received = recv(connection_fd, buffer, sizeof(buffer), 0)) > 0) {
+        answers.append(buffer, received);
+    }
+    bool connected = received == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+
+    // The daemon answers the requests of a connection in the order they were sent.
+    size_t end;
+    while ( (end = answers.find('\n')) != string::npos) {
+        string answer = answers.substr(0, end);
+        answers.erase(0, end + 1);
+        string setting = requested.empty() ? string() : requested.front();
+        if (!requested.empty()) {
+            requested.pop_front();
+        }
+        if (answer.compare(0, 2, "ok") != 0) {
+            syslog(log_facility | LOG_ERR, "Error: The SmartCCTV Daemon refused to set %s : %s", setting.c_str(), answer.c_str());
+            refused.push_back(setting);
+        }
+    }
+
+    if (!connected) {
+        syslog(log_facility | LOG_NOTICE, "The SmartCCTV Daemon closed the control connection.");
+        close_connection();
+    }
+    return connected;
 }
 
 
-void Daemon_facade::remove_pid_file(FILE* pid_file_pointer)
+bool Daemon_facade::connect_to_daemon()
 {
-    if (fclose(pid_file_pointer) == EOF) {
-        syslog(log_facility | LOG_ERR, "Error: Could not close PID file %s : %m", daemon_data.pid_file_name);
+    if (connection_fd != -1) {
+        return true;
     }
-    if (unlink(daemon_data.pid_file_name) == -1) {
-        syslog(log_facility | LOG_ERR, "Error: Could not unlink PID file %s : %m", daemon_data.pid_file_name);
-        syslog(log_facility | LOG_WARNING, "System Admin please take a look at this.");
+    // Connecting doesn't wait for the daemon, the connection waits in the backlog of the socket until it is accepted.
+    if ( (connection_fd = connect_control_socket(daemon_control_socket)) == -1) {
+        return false;
     }
+    fcntl(connection_fd, F_SETFL, fcntl(connection_fd, F_GETFL) | O_NONBLOCK);
+    return true;
 }
 
 
-bool Daemon_facade::checkPidFile(bool turn_on)
+void Daemon_facade::close_connection()
 {
-    //enum { ON, OFF } state = OFF;
-    bool state = false;
-    // Try to open the PID file, check if the daemon is already running.
-    // If the daemon is not already running, then set the state to OFF,
-    // we can return from the function and start up the daemon.
-    // If a PID file exists, we must check is the daemon already running
-    // or is the PID file bad.
-    // If the daemon is already running, then set the state to ON.
-    if ( (daemon_data.pid_file_pointer = fopen(daemon_data.pid_file_name, "r")) != nullptr) {
-        syslog(log_facility | LOG_NOTICE, "A PID file already exists.");
-        syslog(log_facility | LOG_NOTICE, "Checking if the SmartCCTV Daemon is running.");
-
-        char digit = '\0';
-        // Check if the PID file contains a valid process ID of the daemon process.
-        // Check if all the characters in the PID file are digits.
-        // Check if the PID file was not tampered.
-        while (true) {
-            digit = fgetc(daemon_data.pid_file_pointer);
-            if (digit == EOF)
-                break;
-
-            if (digit == '\0' || digit == '\n')
-                continue;
-
-            if (!isdigit(digit)) {
-                syslog(log_facility | LOG_ERR, "Error: Invalid PID file: text is not a process id");
-                syslog(log_facility | LOG_WARNING, "Removing Invalid PID file %s", daemon_data.pid_file_name);
-                remove_pid_file(daemon_data.pid_file_pointer);
-
-                write_message("SmartCCTV has been tampered.");
-                // Since the tampered PID file was already deleted, assume that it doesn't exist (state == false).
-                return false != turn_on;
-            }
-        }
-
-        int daemon_pid = 0;
-        fseek(daemon_data.pid_file_pointer, 0, SEEK_SET);
-        fscanf(daemon_data.pid_file_pointer, "%d", &daemon_pid);
-        daemon_data.camera_daemon_pid = daemon_pid;
-
-        // Check if the PID file contains a valid process ID of the daemon process.
-        // If the PID file is indeed all digits, we must then make sure that it represents a valid process ID.
-        // kill() with a signal of 0, doesn't send a signal to the process, but it checks if that process exists.
-        // If that process doesn't exist, then kill() will return -1 and errno will be set.
-        // This only works if you're the user owning that process, or if you are the root user.
-        if (kill(daemon_pid, 0) == -1) {
-            syslog(log_facility | LOG_ERR, "Error: Invalid PID file : %m");
-            syslog(log_facility | LOG_WARNING, "Removing PID file for defunct process %d", daemon_pid);
-            remove_pid_file(daemon_data.pid_file_pointer);
-
-            write_message("SmartCCTV has been tampered.");
-            // Since the tampered PID file was already deleted, assume that it doesn't exist (state == false).
-            return false != turn_on;
-
-        // If that process does exist, it means that the SmartCCTV daemon is already running, so we can't
-        // start a new daemon process running.
-        } else {
-            state = true;
-        }
-    } else {
-        state = false;
+    if (connection_fd != -1) {
+        close(connection_fd);
+        connection_fd = -1;
     }
+    answers.clear();
+    requested.clear();
+}
+
 
-    return state != turn_on;
+bool Daemon_facade::is_daemon_running()
+{
+    // The daemon is running if it is listening on the control socket.
+    int control_fd = connect_control_socket(daemon_control_socket);
+    if (control_fd == -1) {
+        return false;
+    }
+    close(control_fd);
+    return true;
 }
 
 
 #pragma GCC diagnostic pop
-
@@ -14,7 +14,9 @@
 #ifndef HIGH_LEVEL_CCTV_DAEMON_APIS_H
 #define HIGH_LEVEL_CCTV_DAEMON_APIS_H
 
-#include <cstdio>       /* for FILE */
+#include <deque>        /* for std::deque */
+#include <string>       /* for std::string */
+#include <vector>       /* for std::vector */
 
 // You can change this to make the syslog() output to a different file.
 #define log_facility LOG_LOCAL0
@@ -22,6 +24,16 @@
 
 class Daemon_facade {
   public:
+    Daemon_facade();
+
+    /**
+     * The destructor closes the connection to the daemon, the daemon keeps running.
+     */
+    ~Daemon_facade();
+
+    Daemon_facade(const Daemon_facade&) = delete;
+    Daemon_facade& operator=(const Daemon_facade&) = delete;
+
     /**
      * This function is used for passing some winformation from the MainWindow to the daemon.
      *
@@ -47,12 +59,35 @@ class Daemon_facade {
      * @return int - 0 if it succeeded running the daemon
      *               1 if it failed because the daemon was already running
      *               2 if it failed because you don't have permissions to run the daemon
-     *                              (it failed to create and/or open the PID file)
+     *                              (it failed to create the control socket)
      */
     int run_daemon(bool enable_human_detection, bool enable_motion_detection, bool enable_outlines, int cameraNumber);
 
+    /**
+     * This function turns on the daemon if it is not already running.
+     * The daemon opens all of the given cameras, and runs each one of them on it's own thread.
+     *
+     * This function is called only in the GUI process.
+     *
+     * @param bool enable_human_detection - whether to enable human detection
+     *
+     * @param bool enable_motion_detection - whether to enable motion detection
+     *
+     * @param bool enable_outlines - whether to draw outlines
+     *
+     * @param const std::vector<std::string>& camera_sources - The cameras to use. Each one is either
+     *                                                          a camera number or the path to a media file.
+     *
+     * @return int - 0 if it succeeded running the daemon
+     *               1 if it failed because the daemon was already running
+     *               2 if it failed because you don't have permissions to run the daemon
+     *                              (it failed to create the control socket)
+     */
+    int run_daemon(bool enable_human_detection, bool enable_motion_detection, bool enable_outlines, const std::vector<std::string>& camera_sources);
+
     /**
      * This function kills the daemon if it is already running.
+     * It sends the stop request on the control channel and waits for the daemon to accept it.
      *
      * This function is called only in the GUI process.
      *
@@ -63,48 +98,72 @@ class Daemon_facade {
     bool kill_daemon();
 
     /**
+     * This function changes one setting of the running daemon, without restarting it.
+     * The cameras use the new setting from their next frame on.
+     * The request is only sent on the connection to the daemon, this function doesn't wait for the answer,
+     * so the GUI never freezes while a daemon that is still opening it's cameras gets to it.
+     * The answer is read by read_daemon_answers() when control_fd() can be read.
+     *
      * This function is called only in the GUI process.
      *
-     * @return bool - true if the daemon is already running
-     *                false if the daemon is not already running
+     * @param const std::string& setting - human_detection, motion_detection, outlines,
+     *                                     detection_interval, motion_threshold or retention_days
+     *
+     * @param int value - 0 or 1 for the first three, the number for the others
+     *
+     * @return bool - true if the request was sent
+     *                false if the daemon is not running
      */
-    bool is_daemon_running();
+    bool set_daemon_setting(const std::string& setting, int value);
 
-  private:
     /**
-     * This function deletes the PID file.
-     * It first closes the passed in FILE* and then it unlinks the actual file.
+     * This function sets how many days the videos are kept, the older ones are deleted.
+     * A daemon that is running is sent it like set_daemon_setting(), a daemon started later starts with it.
      *
      * This function is called only in the GUI process.
      *
-     * @param FILE* pid_file_pointer - A pointer to the PID file.
+     * @param int days - The days to keep the videos, 0 keeps them forever.
      */
-    void remove_pid_file(FILE* pid_file_pointer);
+    void set_retention_days(int days);
 
     /**
-     * This function checks if the PID file exists and if it is valid.
-     * If the PID file is invalid (either it does not contain a process ID or there is no such process)
-     * then an error message is printed to the screen, and the PID file is removed, after which it is treated
-     * as if the PID file did not exist.
-     * If the PID file is invalid, then it is assumed that it has been tampererd.
+     * This function is called only in the GUI process.
      *
-     * If either the PID file does not exist, or it exists and it is valid,
-     * a bool value is returned depeding on bool turn_on.
+     * @return int - The connection to the daemon that set_daemon_setting() sends on, or -1 if there is none.
+     *               It is a different one after the daemon was restarted.
+     */
+    int control_fd() const;
+
+    /**
+     * This function reads the answers to set_daemon_setting() that arrived, without waiting.
+     * The connection is closed if the daemon closed it, control_fd() is -1 then.
      *
      * This function is called only in the GUI process.
      *
-     * @param bool turn_on - This is a command to turn the daemon on, or turn it off.
-     *             turn_on == true if the daemon is being turned on.
-     *             turn_on == false if the daemon is being turned off.
-     *        If you want to turn the daemon on, and the daemon is already on, the function returns false,
-     *        else it returns true.
-     *        If you want to turn the daemon off, and the daemon is already off (not running), the runction returns false,
-     *        else it returns true.
+     * @param std::vector<std::string>& refused - The settings the daemon refused to change are added to it.
      *
-     * @return bool - It returns false if the command specified cannot be completed.
-     *                It returns true if the command specified can be completed.
+     * @return bool - true if the connection is still open
+     *                false if it was closed
      */
-    bool checkPidFile(bool turn_on);
+    bool read_daemon_answers(std::vector<std::string>& refused);
+
+    /**
+     * This function is called only in the GUI process.
+     * The daemon is running if something is listening on it's control socket.
+     *
+     * @return bool - true if the daemon is already running
+     *                false if the daemon is not already running
+     */
+    bool is_daemon_running();
+
+  private:
+    // Connects to the daemon if there is no connection yet, returns false if the daemon is not running.
+    bool connect_to_daemon();
+    void close_connection();
+
+    int connection_fd;
+    std::string answers;                // What was read, up to the end of the answer that is not complete yet.
+    std::deque<std::string> requested;  // The settings that were sent and not answered yet, in the order they were sent.
 };
 
 
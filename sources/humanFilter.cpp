@@ -11,49 +11,53 @@
  * Each instance of this class is to correspond to a single camera or video file.
  */
 
-#include "low_level_cctv_daemon_apis.h"
 #include "humanFilter.hpp"
 #include <syslog.h>  /* for syslog() */
 #define log_facility LOG_LOCAL0
 
-extern Daemon_data daemon_data;
+const cv::HOGDescriptor& HumanFilter::sharedPeopleDetector()
+{
+	// A function local static is built exactly once, even if several camera threads get here at once.
+	// HOGDescriptor::detectMultiScale() is const, so the camera threads can use it concurrently.
+	static const cv::HOGDescriptor peopleDetector = []()
+	{
+		syslog(log_facility | LOG_NOTICE, "Build human detector");
+		cv::HOGDescriptor detector;
+		detector.setSVMDetector(cv::HOGDescriptor::getDefaultPeopleDetector());
+		return detector;
+	}();
+	return peopleDetector;
+}
 
 HumanFilter::HumanFilter()
+ : hog(sharedPeopleDetector())
 {
-	syslog(log_facility | LOG_NOTICE, "Build human detector");
-	hog.setSVMDetector(cv::HOGDescriptor::getDefaultPeopleDetector());
 }
 
-bool HumanFilter::runRecognition(cv::Mat &frame)
+void HumanFilter::detect(const cv::Mat &frame, std::vector<cv::Rect> &humans) const
 {
-	boxes.clear();
+	humans.clear();
 	//The third value is used to set detection threshold (higher = less false positives, more false negatives)
 	//Recommended value between 1.3 and 1.7
 	//syslog(log_facility | LOG_NOTICE, "Searching for humans...");
 
-	hog.detectMultiScale(frame, boxes, 1.7, cv::Size(8,8), cv::Size(), 1.05, 2, false);
+	hog.detectMultiScale(frame, humans, 1.7, cv::Size(8,8), cv::Size(), 1.05, 2, false);
 	
-	if(boxes.size() < 1)
+	if(humans.size() < 1)
 	{
 		//syslog(log_facility | LOG_NOTICE, "didn't find humans");
-		return false;
+		return;
 	}
 	
-	for (size_t i = 0; i < boxes.size(); i++)
+	for (size_t i = 0; i < humans.size(); i++)
 	{
-        cv::Rect &rect = boxes[i];
+        cv::Rect &rect = humans[i];
         
         rect.x += cvRound(rect.width*0.1);
         rect.width = cvRound(rect.width*0.8);
         rect.y += cvRound(rect.height*0.07);
         rect.height = cvRound(rect.height*0.8);
-        
-        if(daemon_data.enable_outlines)
-        {
-			rectangle(frame, rect.tl(), rect.br(), cv::Scalar(0, 255, 0), 2);
-		}
     }
-    syslog(log_facility | LOG_NOTICE, "Found humans");
-
-	return true;
+    // Every frame with humans is in the event journal, the log only has them for debugging.
+    syslog(log_facility | LOG_DEBUG, "Found humans");
 }
@@ -26,10 +26,12 @@ class HumanFilter
 {
 public:
 	HumanFilter();
-	bool runRecognition(cv::Mat &frame);
+	// Only finds the humans, the frame is not drawn on.
+	void detect(const cv::Mat &frame, std::vector<cv::Rect> &humans) const;
     
 private:
-	cv::HOGDescriptor hog;
-	std::vector<cv::Rect> boxes;
+	// The people detector is read-only once it is built, so all the cameras of the daemon share it.
+	static const cv::HOGDescriptor& sharedPeopleDetector();
+	const cv::HOGDescriptor& hog;
 };
 #endif
@@ -0,0 +1,229 @@
+/**
+ * File Name:  journalQuery.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This program prints what a camera detected between two times, from the event journal in it's recordings directory.
+ * Every record says when, which detectors found something, how much moved, where the boxes were,
+ * and which video has the frame, at how many seconds into it. The journal can be read while the daemon runs.
+ * It is built with "make journal".
+ *
+ * Usage:  journalQuery camera from [to] [motion|human|face]
+ *
+ * camera is the number of the camera, or the directory of it's journal.
+ * The times are local, as 2026-10-13, "2026-10-13 14:00" or "2026-10-13 14:00:30", or now, or -30m, -2h, -7d before now.
+ * A day on it's own as the end includes the whole day. Without the end, everything from the beginning on is printed.
+ */
+
+#include "eventJournal.hpp"
+#include <sys/stat.h>  /* for stat() */
+#include <time.h>      /* for strptime(), mktime(), localtime_r(), strftime() */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+
+
+static std::int64_t millisecondsNow()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+
+// Reads a time given on the command line, returns false if it is none of the forms in the usage.
+// endOfDay moves a day on it's own to the end of that day.
+static bool parseTime(const char* text, bool endOfDay, std::int64_t& time)
+{
+	if(std::strcmp(text, "now") == 0)
+	{
+		time = millisecondsNow();
+		return true;
+	}
+	if(text[0] == '-')
+	{
+		char* unit = nullptr;
+		long amount = std::strtol(text + 1, &unit, 10);
+		const std::map<std::string, std::int64_t> units = { { "s", 1000 }, { "m", 60000 }, { "h", 3600000 }, { "d", 86400000 } };
+		auto found = units.find(unit);
+		if(unit == text + 1 || amount < 0 || found == units.end())
+		{
+			return false;
+		}
+		time = millisecondsNow() - amount * found->second;
+		return true;
+	}
+
+	const char* formats[] = { "%Y-%m-%d %H:%M:%S", "%Y-%m-%dT%H:%M:%S", "%Y-%m-%d %H:%M", "%Y-%m-%dT%H:%M", "%Y-%m-%d" };
+	for(const char* format : formats)
+	{
+		struct tm parts;
+		std::memset(&parts, 0, sizeof(parts));
+		const char* end = strptime(text, format, &parts);
+		if(end == nullptr || *end != '\0')
+		{
+			continue;
+		}
+		bool wholeDay = std::strcmp(format, "%Y-%m-%d") == 0;
+		if(wholeDay && endOfDay)
+		{
+			parts.tm_mday++;
+		}
+		// mktime() works out whether daylight saving time was in effect on that day.
+		parts.tm_isdst = -1;
+		std::time_t seconds = mktime(&parts);
+		if(seconds == (std::time_t) -1)
+		{
+			return false;
+		}
+		time = static_cast<std::int64_t>(seconds) * 1000;
+		return true;
+	}
+	return false;
+}
+
+
+static std::string formatTime(std::int64_t time)
+{
+	std::time_t seconds = static_cast<std::time_t>(time / 1000);
+	struct tm parts;
+	localtime_r(&seconds, &parts);
+	char text[32];
+	std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &parts);
+	char milliseconds[8];
+	std::snprintf(milliseconds, sizeof(milliseconds), ".%03d", static_cast<int>(time % 1000));
+	return std::string(text) + milliseconds;
+}
+
+
+static std::string detectorNames(std::uint8_t detectors)
+{
+	std::string names;
+	if(detectors & JournalHuman)
+	{
+		names += "human ";
+	}
+	if(detectors & JournalFace)
+	{
+		names += "face ";
+	}
+	if(detectors & JournalMotion)
+	{
+		names += "motion ";
+	}
+	if(!names.empty())
+	{
+		names.pop_back();
+	}
+	return names;
+}
+
+
+// The recorder adds the extension of the codec it used to the name in the journal.
+// The videos that were deleted since are marked, the journal outlives them.
+static std::string clipFile(const std::string& name)
+{
+	struct stat fileStat;
+	for(const char* extension : { ".mp4", ".avi" })
+	{
+		if(stat((name + extension).c_str(), &fileStat) == 0)
+		{
+			return name + extension;
+		}
+	}
+	return name + " (deleted)";
+}
+
+
+int main(int argc, char* argv[])
+{
+	if(argc < 3)
+	{
+		std::fprintf(stderr, "Usage: %s camera from [to] [motion|human|face]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	std::string directory = argv[1];
+	if(directory.find_first_not_of("0123456789") == std::string::npos)
+	{
+		const char* home = std::getenv("HOME");
+		directory = std::string(home != nullptr ? home : "") + "/SmartCCTV_recordings/camera" + directory + "/";
+	}
+	else if(directory.back() != '/')
+	{
+		directory += '/';
+	}
+
+	std::int64_t begin = 0;
+	std::int64_t end = millisecondsNow() + 1;
+	std::uint8_t wanted = 0;
+	if(!parseTime(argv[2], false, begin))
+	{
+		std::fprintf(stderr, "%s is not a time\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+	for(int i = 3; i < argc; i++)
+	{
+		const std::map<std::string, std::uint8_t> detectors = { { "motion", JournalMotion }, { "human", JournalHuman }, { "face", JournalFace } };
+		auto found = detectors.find(argv[i]);
+		if(found != detectors.end())
+		{
+			wanted |= found->second;
+		}
+		else if(i != 3 || !parseTime(argv[i], true, end))
+		{
+			std::fprintf(stderr, "%s is not a time or a detector\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	auto started = std::chrono::steady_clock::now();
+	JournalReader journal;
+	std::string error;
+	if(!journal.open(directory, error))
+	{
+		std::fprintf(stderr, "%s\n", error.c_str());
+		return EXIT_FAILURE;
+	}
+	std::pair<std::uint64_t, std::uint64_t> range = journal.range(begin, end);
+
+	// The records of one detection event all point to the same video.
+	std::map<std::uint64_t, std::string> clips;
+	std::uint64_t printed = 0;
+	for(std::uint64_t i = range.first; i < range.second; i++)
+	{
+		const JournalRecord& record = journal[i];
+		if(wanted != 0 && (record.detectors & wanted) == 0)
+		{
+			continue;
+		}
+		std::printf("%s  camera %d  %-17s  moved %7d", formatTime(record.time).c_str(), record.camera,
+		            detectorNames(record.detectors).c_str(), record.motionScore);
+		for(std::uint8_t box = 0; box < record.boxCount && box < JournalMaxBoxes; box++)
+		{
+			const JournalBox& b = record.boxes[box];
+			std::printf("  %s %d,%d %dx%d", detectorNames(record.boxDetectors[box]).c_str(), b.x, b.y, b.width, b.height);
+		}
+		if(record.clip != JournalNoClip)
+		{
+			auto clip = clips.find(record.clip);
+			if(clip == clips.end())
+			{
+				clip = clips.emplace(record.clip, clipFile(journal.clipName(record.clip))).first;
+			}
+			std::printf("  %s +%.3fs", clip->second.c_str(), record.clipOffset / 1000.0);
+		}
+		std::printf("\n");
+		printed++;
+	}
+
+	double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+	std::fprintf(stderr, "%llu of %llu records, %.2f ms\n", (unsigned long long) printed,
+	             (unsigned long long) journal.size(), milliseconds);
+	return EXIT_SUCCESS;
+}
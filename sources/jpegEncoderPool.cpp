@@ -0,0 +1,168 @@
+/**
+ * File Name:  jpegEncoderPool.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class JPEG compresses frames on several threads at once. Every frame of a Motion JPEG video
+ * is an independent JPEG image, so the frames can be compressed in any order, the packets are
+ * handed back in the order the frames were submitted, ready to be written into the video.
+ */
+
+#include "jpegEncoderPool.hpp"
+#include <opencv2/imgcodecs.hpp>
+#include <algorithm>
+#include <utility>
+#include <time.h>  /* for clock_gettime() */
+
+
+static std::uint64_t threadCpuNanoseconds()
+{
+	timespec now;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+	return (std::uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+
+static std::size_t resolveThreadCount(std::size_t threadCount)
+{
+	if(threadCount > 0)
+	{
+		return threadCount;
+	}
+	// hardware_concurrency() is 0 when the number of cores is not known.
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+
+JpegEncoderPool::JpegEncoderPool(std::size_t threadCount, int jpegQuality)
+ : jpegParameters{ cv::IMWRITE_JPEG_QUALITY, jpegQuality },
+   maxInFlight(4 * resolveThreadCount(threadCount)), nextSubmitted(0), nextHandedBack(0), stopping(false),
+   cpuNanoseconds(0)
+{
+	threadCount = resolveThreadCount(threadCount);
+	for(std::size_t i = 0; i < threadCount; i++)
+	{
+		workers.emplace_back(&JpegEncoderPool::encodeFrames, this);
+	}
+}
+
+
+JpegEncoderPool::~JpegEncoderPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+	for(std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+
+void JpegEncoderPool::submit(frameContainer&& container, FrameCompression format)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	// Only the frames that nobody has started on count, the finished packets are handed back by the caller.
+	roomAvailable.wait(lock, [this] { return jobs.size() < maxInFlight; });
+
+	Job job;
+	job.sequence = nextSubmitted++;
+	job.container = std::move(container);
+	job.format = format;
+	jobs.push_back(std::move(job));
+	lock.unlock();
+	jobAvailable.notify_one();
+}
+
+
+void JpegEncoderPool::encodeFrames()
+{
+	// Reused for the frames that have to be decoded from the FrameRing first.
+	cv::Mat decoded;
+	while(true)
+	{
+		Job job;
+		std::vector<uchar> buffer;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if(jobs.empty())
+			{
+				return;
+			}
+			job = std::move(jobs.front());
+			jobs.pop_front();
+			if(!spareBuffers.empty())
+			{
+				buffer = std::move(spareBuffers.back());
+				spareBuffers.pop_back();
+			}
+		}
+		roomAvailable.notify_one();
+
+		// The slow part runs without the lock, this is what the threads do in parallel.
+		std::uint64_t cpuStart = threadCpuNanoseconds();
+		if(job.format == FrameCompression::Jpeg)
+		{
+			std::swap(buffer, job.container.jpeg);
+		}
+		else
+		{
+			decodeFrame(job.container, job.format, decoded);
+			cv::imencode(".jpg", decoded, buffer, jpegParameters);
+		}
+		cpuNanoseconds.fetch_add(threadCpuNanoseconds() - cpuStart, std::memory_order_relaxed);
+
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			packets[job.sequence] = std::move(buffer);
+		}
+		packetReady.notify_all();
+	}
+}
+
+
+bool JpegEncoderPool::takePacket(std::vector<uchar>& jpeg, bool wait)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while(nextHandedBack != nextSubmitted)
+	{
+		auto packet = packets.find(nextHandedBack);
+		if(packet != packets.end())
+		{
+			std::swap(jpeg, packet->second);
+			if(spareBuffers.size() < maxInFlight)
+			{
+				packet->second.clear();
+				spareBuffers.push_back(std::move(packet->second));
+			}
+			packets.erase(packet);
+			nextHandedBack++;
+			return true;
+		}
+		if(!wait)
+		{
+			return false;
+		}
+		packetReady.wait(lock);
+	}
+	return false;
+}
+
+
+bool JpegEncoderPool::nextPacket(std::vector<uchar>& jpeg)
+{
+	return takePacket(jpeg, true);
+}
+
+
+bool JpegEncoderPool::tryNextPacket(std::vector<uchar>& jpeg)
+{
+	return takePacket(jpeg, false);
+}
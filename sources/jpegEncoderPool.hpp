@@ -0,0 +1,84 @@
+/**
+ * File Name:  jpegEncoderPool.hpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class JPEG compresses frames on several threads at once. Every frame of a Motion JPEG video
+ * is an independent JPEG image, so the frames can be compressed in any order, the packets are
+ * handed back in the order the frames were submitted, ready to be written into the video.
+ */
+
+#ifndef JPEGENCODERPOOL_HPP
+#define JPEGENCODERPOOL_HPP
+
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "frameRing.hpp"
+
+class JpegEncoderPool
+{
+public:
+	// threadCount 0 means one thread per core.
+	JpegEncoderPool(std::size_t threadCount, int jpegQuality);
+	~JpegEncoderPool();
+	JpegEncoderPool(const JpegEncoderPool&) = delete;
+	JpegEncoderPool& operator=(const JpegEncoderPool&) = delete;
+
+	// Queues a frame, stored in the given format, to be compressed.
+	// Frames that already are JPEG images keep their place in the order, but are not compressed again.
+	// Waits if too many frames are already waiting, so the memory that is used stays bounded.
+	void submit(frameContainer&& container, FrameCompression format);
+
+	// Gives back the next packet in the order of submit(), the old storage of jpeg is reused by the pool.
+	// nextPacket() waits until that packet is compressed, tryNextPacket() never waits.
+	// Both return false if every submitted frame has already been handed back.
+	bool nextPacket(std::vector<uchar>& jpeg);
+	bool tryNextPacket(std::vector<uchar>& jpeg);
+
+	std::size_t threadCount() const { return workers.size(); }
+	// The CPU time all the threads have spent compressing frames, since the pool was created.
+	double cpuSeconds() const { return cpuNanoseconds.load(std::memory_order_relaxed) / 1e9; }
+
+private:
+	struct Job
+	{
+		std::uint64_t sequence;
+		frameContainer container;
+		FrameCompression format;
+	};
+
+	void encodeFrames();
+	bool takePacket(std::vector<uchar>& jpeg, bool wait);
+
+	std::vector<std::thread> workers;
+	std::vector<int> jpegParameters;
+	const std::size_t maxInFlight;
+
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::condition_variable packetReady;
+	std::condition_variable roomAvailable;
+	std::deque<Job> jobs;
+	// Compressed packets that are waiting for the packets before them.
+	std::map<std::uint64_t, std::vector<uchar>> packets;
+	// Empty buffers given back by the caller, for the next packets.
+	std::vector<std::vector<uchar>> spareBuffers;
+	std::uint64_t nextSubmitted;
+	std::uint64_t nextHandedBack;
+	bool stopping;
+	std::atomic<std::uint64_t> cpuNanoseconds;
+};
+
+#endif
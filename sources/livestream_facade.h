@@ -8,8 +8,8 @@
  *
  * Description:
  * This file contains the declaration of the class LiveStream_facade, as well as it's helper functions.
- * The helper functions are primarily signal handlers and other functions that are caled by the signal
- * handlers, since such functions cannot be member methods of a class.
+ * The helper functions are called by the event loop of the LiveStream_window and share the global
+ * liveStream_viewer_data with the class.
  * LiveStream_facade is an implementation of both the facade and singleton design patterns.
  */
 
@@ -46,12 +46,13 @@ class LiveStream_facade {
      * @return int - 0 if it succeeded running the livestream viewer process
      *               1 if it failed because the livestream viewer process was already running
      *               2 if it failed because you don't have permissions to run the livestream viewer process
-     *                              (it failed to create and/or open the PID file)
+     *                              (it failed to create the lock socket)
      */
     int run_livestream_viewer(const string& home_directory);
 
     /**
      * This function is called only in the GUI process.
+     * The livestream viewer process is running if the name of it's lock socket is taken.
      *
      * @return bool - true if the livestream viewer process is already running
      *                false if the livestream viewer process is not already running
@@ -59,16 +60,9 @@ class LiveStream_facade {
     bool is_livestream_running();
 
   private:
-    /**
-     * This is a utility function which removes the PID file of the livestream viewer process.
-     *
-     * This function is called only in the GUI process.
-     */
-    void remove_my_pid_file();
-
     /**
      * This function forks the LiveStream Viewer process off the GUI process and detatches it.
-     * It also writes the PID of the LiveStream process to the PID file and sets up the signal handlers.
+     * It keeps the lock socket that the GUI process bound, and blocks the signals it handles into a signalfd.
      */
     void become_livestream_process();
 
@@ -76,9 +70,8 @@ class LiveStream_facade {
      * This function holds the main functionality of the LiveStream Viewer process.
      * The functions above were just for setting everything up.
      * As the name implies, this function opens up the window of the LiveStream Viewer.
-     * Upon startup, it also detects if the camera daemon process is already running, and if so it
-     * connects to that process and lets the camera daemon know that it should start saving images to the
-     * livestream directory.
+     * The window subscribes to the live stream on the control channel of the camera daemon,
+     * whenever the camera daemon is running.
      *
      * This function is called in the LiveStream Viewer process only.
      * It never returns, and the program stays in this function for it's entire lifetiem until it gets killed.
@@ -86,16 +79,14 @@ class LiveStream_facade {
     void open_viewer_window();
 
     LiveStream_viewer_data* private_data;  // A pointer to the global private data.
-    int my_pid;                            // The PID of the LiveStream viewer.
 };
 
 
 /* Helper functions */
 
 /**
- * This helper function is a signal handler.
- * The only reason why it's not a member method of the class is because C/C++ doesn't allow signal handlers
- * to be member methods.
+ * This helper function is called by the event loop of the LiveStream_window, when the signalfd has a signal.
+ * It is also called when the LiveStream Viewer fails to start up.
  *
  * This function is called whenever LiveStream Viewer process recieves a terminate signal.
  * It first cleans up the resources of the process and lets the camera daemon process (if it's still running)
@@ -104,60 +95,24 @@ class LiveStream_facade {
 void terminate_livestream(int);
 
 /**
- * This helper function is a signal handler.
- * The only reason why it's not a member method of the class is because C/C++ doesn't allow signal handlers
- * to be member methods.
- *
- * The livestream viewer recieves SIGUSR1 when the camera daemon process starts up.
- * This function handles that signal by connecting to that proces.
- */
-void camera_daemon_starts_up(int);
-
-/**
- * This helper function is a signal handler.
- * The only reason why it's not a member method of the class is because C/C++ doesn't allow signal handlers
- * to be member methods.
- *
- * The livestream viewer recieves SIGUSR2 when the camera daemon process shuts down.
- * This function handles that signal by disconnecting from that proces.
- */
-void camera_daemon_shuts_down(int);
-
-/**
- * This function tries to find a camera? directory in the directory /tmp/SmartCCTV_livestream/
- * The ? stands for any single digit. This is because you can have camera0 or camera1, or camera2 opened
- * if you have multiple cameras to choose from.
- * This function automatically finds the camera that is currently in use by the SmartCCTV Camera Daemon,
- * and it sets that directory to be watched.
- *
- * This function modifies liveStream_viewer_data.streamDir to hold the directory of the active camera if
- * it detects one. If the directory of the active camera was already previously set, and this function is
- * called again, it doesn't to anything, and it exits without errors.
+ * This helper function is called by the event loop of the LiveStream_window, while it is not connected
+ * to the camera daemon.
  *
- * This function is called by the LiveStream Viewer process only.
- * Although originally intended to be a member method, this is not the case because it is called by
- * signal handler functions, which cannot be member methods or call other member methods.
+ * It connects to the control channel of the camera daemon and subscribes to the live stream,
+ * so the camera daemon publishes the frames of it's cameras for as long as the connection is open.
+ * The answer of the camera daemon is read by the event loop, this function doesn't wait for it.
  *
- * @return bool - true if the directory of the active camera was found
- *                false otherwise
+ * @return int - The connection to the camera daemon, for the event loop to wait on, or -1 if it is not running.
  */
-bool find_camera_directory();
+int connect_to_daemon();
 
 /**
- * This function gets and returns the PID of the SmartCCTV Camera Daemon process if it exists.
- * This function is called by the LiveStream Viewer process only.
- *
- * This function terminates the program in the PID file of the SmartCCTV Viewer process has become corrupted.
- * If the PID file of the SmartCCTV Viewer process was corrupted or tampered before the LiveStream Viewer
- * started, or during, then ther's no way to get the PID of the daemon, and no way to signal the daemon to
- * start saving images into the directory, so the LiveStream Viewer process cannot start, so it should
- * terminate.
- * In case this happens, the function pushes a custom message to the GUI.
- *
- * @return int - The PID of the SmartCCTV Camera Daemon process, or -1 if this process does not exist.
+ * This helper function is called by the event loop of the LiveStream_window, when the camera daemon closed
+ * the connection because it shut down. It is also called when the LiveStream Viewer shuts down.
  *
+ * It closes the connection, which unsubscribes from the live stream if the camera daemon is still running.
  */
-int get_daemon_pid();
+void disconnect_from_daemon();
 
 
 #endif  /* LIVESTREAM_FACADE_H */
@@ -9,42 +9,83 @@
  * Description:
  * This file contains the implementation of the LiveStream_window class's methods.
  * An instance of this class represents a single viewer window that is responsible for displaying the
- * live stream from a single camera.
+ * live streams of all of the cameras, as a mosaic of tiles drawn by a single renderer.
  */
 
 #include "livestream_window.h"
-#include "write_message.h"
+#include "event_channel.h"
 
 //#include <sys/types.h>
 //#include <sys/stat.h>
 #include <syslog.h>       /* for syslog() */
-#include <errno.h>        /* for errno() */
-#include <sys/inotify.h>  /* for inotify_init(), inotify_add_watch() */
-#include <unistd.h>       /* for pause(), sleep(), read() */
 #include <dirent.h>       /* for opendir(), readdir(), closedir() */
-#include <cstring>        /* for strerror() */
+#include <errno.h>        /* for errno */
+#include <signal.h>       /* for signal constants */
+#include <unistd.h>       /* for read(), close() */
+#include <sys/epoll.h>    /* for epoll_create1(), epoll_ctl(), epoll_wait() */
+#include <sys/signalfd.h> /* for struct signalfd_siginfo */
+#include <sys/timerfd.h>  /* for timerfd_create(), timerfd_settime() */
+#include <cstdint>        /* for uint64_t */
+#include <cstring>        /* for strncmp(), memcpy() */
 #include <string>         /* for std::string */
+#include <algorithm>      /* for std::sort(), std::min() */
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
 using std::string;
 
-#define MAX_EVENT_MONITOR 2048
-// file name length
-#define NAME_LEN 32
-// size of one event
-#define MONITOR_EVENT_SIZE (sizeof(struct inotify_event))
-// buffer length
-#define BUFFER_LEN (MAX_EVENT_MONITOR * (MONITOR_EVENT_SIZE + NAME_LEN))
-
 
 extern int exit_code;
 
 extern void terminate_livestream(int);
+extern int connect_to_daemon();
+extern void disconnect_from_daemon();
 
 
-LiveStream_window::LiveStream_window(const string& streamDir, const string& default_images_directory, const bool& SmartCCTV_daemon_is_running)
- : streamDir(streamDir), default_images_directory(default_images_directory), event(), window(nullptr), renderer(nullptr), surface(nullptr), texture(nullptr), is_camera_daemon_running(SmartCCTV_daemon_is_running)
+/**
+ * Returns a timerfd that can be read every milliseconds, or -1 on an error.
+ */
+static int create_timer(int milliseconds)
+{
+    int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd == -1) {
+        return -1;
+    }
+    struct itimerspec interval;
+    interval.it_interval.tv_sec = milliseconds / 1000;
+    interval.it_interval.tv_nsec = static_cast<long>(milliseconds % 1000) * 1000000;
+    interval.it_value = interval.it_interval;
+    if (timerfd_settime(timer_fd, 0, &interval, nullptr) == -1) {
+        close(timer_fd);
+        return -1;
+    }
+    return timer_fd;
+}
+
+
+/**
+ * Returns the biggest rectangle with the shape of a width x height frame that fits in the middle of cell.
+ */
+static SDL_Rect fit_picture(const SDL_Rect& cell, int width, int height)
+{
+    SDL_Rect picture = cell;
+    if (static_cast<long>(cell.w) * height > static_cast<long>(cell.h) * width) {
+        picture.w = std::max(1, static_cast<int>(static_cast<long>(cell.h) * width / height));
+        picture.x += (cell.w - picture.w) / 2;
+    } else {
+        picture.h = std::max(1, static_cast<int>(static_cast<long>(cell.w) * height / width));
+        picture.y += (cell.h - picture.h) / 2;
+    }
+    return picture;
+}
+
+
+LiveStream_window::LiveStream_window(const string& streamDir, const string& default_images_directory, const bool& SmartCCTV_daemon_is_running,
+                                     int signal_fd)
+ : streamDir(streamDir), default_images_directory(default_images_directory), signal_fd(signal_fd), control_fd(-1), epoll_fd(-1), tick_fd(-1), no_signal_fd(-1),
+   event(), window(nullptr), renderer(nullptr), not_running_texture(nullptr), no_signal_texture(nullptr),
+   focused_tile(-1), layout_changed(true), redraw_needed(false), showing_default_image(false),
+   render_ticks(0), longest_render_ticks(0), rendered_frames(0), is_camera_daemon_running(SmartCCTV_daemon_is_running)
 {
     // Attempt to initialize graphics and timer system
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0) {
@@ -57,119 +98,227 @@ LiveStream_window::LiveStream_window(const string& streamDir, const string& defa
 
 void LiveStream_window::open()
 {
-    string not_running = default_images_directory + "not_running.bmp";
-    string no_signal   = default_images_directory + "no_signal.bmp";
-
-    if (!is_camera_daemon_running) {
-        draw_image(not_running);
+    not_running_texture = load_image(default_images_directory + "not_running.bmp");
+    no_signal_texture   = load_image(default_images_directory + "no_signal.bmp");
+
+    // The SDL events have no file descriptor, they are processed 60 times a second.
+    // If the camera daemon is not running, or not producing images, the timer of once a second shows the default images.
+    if ( (epoll_fd = epoll_create1(EPOLL_CLOEXEC)) == -1 || (tick_fd = create_timer(1000 / 60)) == -1 ||
+         (no_signal_fd = create_timer(1000)) == -1) {
+        syslog(log_facility | LOG_ERR, "Error creating the event loop : %m");
+        exit_code = EXIT_FAILURE;
+        terminate_livestream(0);
     }
-    while (!is_camera_daemon_running) {
-        // draw the image to the window
-        SDL_RenderCopy(renderer, texture, nullptr, nullptr);
-        SDL_RenderPresent(renderer);
-        SDL_Delay(1000);
-        process_events();
-        // pause();  // prevents the window from appearing
+    // Each file descriptor is told apart by the address of where it is kept, and the doorbells by their tile.
+    for (int* fd : { &signal_fd, &tick_fd, &no_signal_fd }) {
+        struct epoll_event watch = {};
+        watch.events = EPOLLIN;
+        watch.data.ptr = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, *fd, &watch) == -1) {
+            syslog(log_facility | LOG_ERR, "Error adding to the event loop : %m");
+            exit_code = EXIT_FAILURE;
+            terminate_livestream(0);
+        }
     }
 
-    // If the camera daemon is not running, the above code will continue to sit the while loop until
-    // the camera daemon finally starts up, and sends a singal to this LiveStream Viewer process.
-    // Then the variable is_camera_daemon_running is set to true and streamDir becomes set to the directory
-    // that should be watched for camera images.
+    // If the camera daemon is not running, "SmartCCTV is not running" is shown until it starts up
+    // and check_cameras() connects to it. Then the variable is_camera_daemon_running is set to true.
+    check_cameras();
 
-    // Get rid of any residue or glichy images.
-    // Sometimes there may be left images from the last run in the directory that were not removed.
-    if (auto dir = opendir(streamDir.c_str())) {
-        while (auto f = readdir(dir)) {
-            if (!f->d_name || f->d_name[0] == '.') {
-                continue;  // Skip everything that starts with a dot
-            } else if (f->d_name != nullptr) {
-                if (unlink(f->d_name) == -1) {
-                    const char* const error_message = strerror(errno);
-                    syslog(log_facility | LOG_ERR, "Error cannot delete %s : %s", f->d_name, error_message);
+    struct epoll_event ready[16];
+    while (true)
+    {
+        int count = epoll_wait(epoll_fd, ready, 16, -1);
+        if (count == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            syslog(log_facility | LOG_ERR, "Error waiting for events : %m");
+            exit_code = EXIT_FAILURE;
+            terminate_livestream(0);
+        }
+
+        for (int i = 0; i < count; i++) {
+            void* source = ready[i].data.ptr;
+            uint64_t expirations = 0;
+            if (source == &signal_fd) {
+                handle_signals();
+            } else if (source == &control_fd) {
+                read_control();
+            } else if (source == &tick_fd) {
+                read(tick_fd, &expirations, sizeof(expirations));
+                process_events();
+            } else if (source == &no_signal_fd) {
+                read(no_signal_fd, &expirations, sizeof(expirations));
+                check_cameras();
+            } else {
+                // The tiles are never removed, so the pointer is good even if the reader was closed in the meantime.
+                Stream_tile* tile = static_cast<Stream_tile*>(source);
+                if ( (ready[i].events & (EPOLLHUP | EPOLLERR)) && tile->reader.isOpen()) {
+                    // The camera daemon closed the doorbell, check_cameras() connects again when it comes back.
+                    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, tile->reader.doorbell(), nullptr);
+                    tile->reader.close();
+                    continue;
                 }
+                tile->reader.clearDoorbell();
+                tile->doorbell_rang = true;
             }
         }
-        closedir(dir);
+
+        // Each tile takes the newest frame of it's camera, the frames published in between are skipped.
+        draw_frames();
     }
 
-    int inotify_fd = 0;
-    char buffer[BUFFER_LEN];
+}
+
 
-    if ( (inotify_fd = inotify_init()) == -1) {
-        syslog(log_facility | LOG_ERR, "Error initializing inotify: %m");
-        exit_code = EXIT_FAILURE;
-        terminate_livestream(0);
+void LiveStream_window::handle_signals()
+{
+    struct signalfd_siginfo signal_info;
+    if (read(signal_fd, &signal_info, sizeof(signal_info)) == sizeof(signal_info)) {
+        exit_code = EXIT_SUCCESS;
+        terminate_livestream(signal_info.ssi_signo);
     }
+}
 
-    int watch_desc = inotify_add_watch(inotify_fd, streamDir.c_str(), IN_CREATE);
-    if (watch_desc == -1) {
-        const char* const error_message = strerror(errno);
-        syslog(log_facility | LOG_ERR, "Could not add watch to folder %s : %s", streamDir.c_str(), error_message);
-        exit_code = EXIT_FAILURE;
-        terminate_livestream(0);
+
+void LiveStream_window::read_control()
+{
+    char buffer[256];
+    ssize_t received;
+    while ( (received = read(control_fd, buffer, sizeof(buffer))) > 0) {
+        // The camera daemon only answers "ok" to the subscription, there is nothing else to do with it.
     }
+    if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        // The camera daemon shut down. Closing the socket also takes it out of the event loop.
+        disconnect_from_daemon();
+        control_fd = -1;
+        check_cameras();
+    }
+}
 
-    int i = 0;
-    while (true)
-    {
-        i = 0;
-        // read() blocks if there is no more data to read.
-        // This is the reason why the LiveStream Viewer window is blocking and it appears unresponsive
-        // if the camera daemon is not adding new image files to the directory of if it is not running at all.
-        int total_read = read(inotify_fd, buffer, BUFFER_LEN);
-        if (total_read < 0) {
-            // this could be due to interrupted system call
-            // if a signal is sent at the time, it prevents read() from completing
-            // so try to read() again after the signal handler returns
-            syslog(log_facility | LOG_ERR, "inotify read() error : %m");
-            if (is_camera_daemon_running) {
-                draw_image(no_signal);
-            } else {
-                draw_image(not_running);
-            }
-            process_events();
-            continue;
-        } else if (total_read == 0) {
-            if (is_camera_daemon_running) {
-                draw_image(no_signal);
-            } else {
-                draw_image(not_running);
-            }
-            process_events();
+
+void LiveStream_window::check_cameras()
+{
+    if (control_fd == -1 && (control_fd = connect_to_daemon()) != -1) {
+        struct epoll_event watch = {};
+        watch.events = EPOLLIN;
+        watch.data.ptr = &control_fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, control_fd, &watch) == -1) {
+            syslog(log_facility | LOG_ERR, "Error adding the camera daemon to the event loop : %m");
+            disconnect_from_daemon();
+            control_fd = -1;
         }
+    }
+    if (!is_camera_daemon_running) {
+        draw_image(not_running_texture);
+        showing_default_image = true;
+        return;
+    }
 
-        while (i < total_read) {
-            struct inotify_event* event = (struct inotify_event*) &buffer[i];
-            if (event->len > 0) {
-                // if ( file is created) && (it is not a directory) )
-                if ( (event->mask & IN_CREATE) && !(event->mask & IN_ISDIR) ) {
-                    string image_file = streamDir + "/";
-                    image_file += event->name;
-                    //syslog(log_facility | LOG_NOTICE, "file %s appeared", event->name);
-                    draw_image(image_file);
-                    // delete the image file from the directory as soon as it is displayed to the screen
-                    if (unlink(image_file.c_str()) == -1) {
-                        const char* const error_message = strerror(errno);
-                        syslog(log_facility | LOG_ERR, "Error cannot delete %s : %s", image_file.c_str(), error_message);
-                    }
-                    process_events();
-                }
-                 // move onto the next event
-                i += event->len + MONITOR_EVENT_SIZE;
-            }
+    // The camera daemon can start cameras after the viewer.
+    if (find_cameras()) {
+        layout_changed = true;
+    }
+    if (tiles.empty()) {
+        draw_image(no_signal_texture);
+        showing_default_image = true;
+        return;
+    }
+    if (showing_default_image) {
+        showing_default_image = false;
+        redraw_needed = true;
+    }
+
+    Uint32 now = SDL_GetTicks();
+    for (auto& tile : tiles) {
+        if (!tile->reader.isOpen() || tile->reader.writerClosed()) {
+            tile->doorbell_rang = connect_tile(*tile);
+        }
+        // The camera daemon is running but this camera is not producing frames.
+        if (tile->has_frame && now - tile->last_frame_ticks > 1000) {
+            tile->has_frame = false;
+            redraw_needed = true;
         }
+    }
+    draw_frames();
+}
+
 
-        process_events();
+bool LiveStream_window::connect_tile(Stream_tile& tile)
+{
+    if (tile.reader.isOpen()) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, tile.reader.doorbell(), nullptr);
+        tile.reader.close();
     }
 
+    // The camera daemon makes the shared memory with the first frame of the live stream,
+    // and makes a new one when the size of the frames changes.
+    if (!tile.reader.open(sharedFrameName(tile.camera_name), sharedFrameDoorbell(streamDir + tile.camera_name))) {
+        return false;
+    }
+    struct epoll_event watch = {};
+    watch.events = EPOLLIN;
+    watch.data.ptr = &tile;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, tile.reader.doorbell(), &watch) == -1) {
+        syslog(log_facility | LOG_ERR, "Error adding %s to the event loop : %m", tile.camera_name.c_str());
+        tile.reader.close();
+        return false;
+    }
+    return true;
+}
+
+
+void LiveStream_window::draw_frames()
+{
+    if (!is_camera_daemon_running || tiles.empty()) {
+        return;
+    }
+
+    // Nothing can be seen in a minimized or hidden window, so no camera is read.
+    // The doorbells stay rung, the newest frames are read when the window comes back.
+    if (SDL_GetWindowFlags(window) & (SDL_WINDOW_MINIMIZED | SDL_WINDOW_HIDDEN)) {
+        return;
+    }
+
+    if (layout_changed) {
+        layout_tiles();
+        layout_changed = false;
+        redraw_needed = true;
+        // The tiles that couldn't be seen before have to catch up.
+        for (auto& tile : tiles) {
+            tile->doorbell_rang = true;
+        }
+    }
+
+    Uint64 render_start = SDL_GetPerformanceCounter();
+    for (auto& tile : tiles) {
+        if (tile->doorbell_rang && update_tile(*tile)) {
+            redraw_needed = true;
+        }
+    }
+
+    if (redraw_needed) {
+        draw_tiles();
+        // SDL_RenderPresent() waits for the vsync, so it is not part of the render time.
+        log_render_time(SDL_GetPerformanceCounter() - render_start);
+        SDL_RenderPresent(renderer);
+        redraw_needed = false;
+    }
 }
 
 
 void LiveStream_window::finalize()
 {
-    if (surface != nullptr)   SDL_FreeSurface(surface);
-    if (texture != nullptr)   SDL_DestroyTexture(texture);
+    if (tick_fd != -1)       close(tick_fd);
+    if (no_signal_fd != -1)  close(no_signal_fd);
+    if (epoll_fd != -1)      close(epoll_fd);
+    for (auto& tile : tiles) {
+        if (tile->texture != nullptr)  SDL_DestroyTexture(tile->texture);
+        tile->texture = nullptr;
+    }
+    if (not_running_texture != nullptr)  SDL_DestroyTexture(not_running_texture);
+    if (no_signal_texture != nullptr)    SDL_DestroyTexture(no_signal_texture);
     if (renderer != nullptr)  SDL_DestroyRenderer(renderer);
     if (window != nullptr)    SDL_DestroyWindow(window);
     SDL_Quit();
@@ -187,90 +336,301 @@ void LiveStream_window::process_events()
     while (SDL_PollEvent(&event))
     {
         if (event.type == SDL_QUIT) {
-            write_message("LiveStream Viewer window was closed.");
+            send_gui_event(EVENT_VIEWER_STOPPED, -1, "LiveStream Viewer window was closed.");
             exit_code = EXIT_SUCCESS;
             terminate_livestream(0);
+        } else if (event.type == SDL_WINDOWEVENT) {
+            if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED || event.window.event == SDL_WINDOWEVENT_EXPOSED ||
+                event.window.event == SDL_WINDOWEVENT_RESTORED) {
+                layout_changed = true;
+            }
+        } else if (event.type == SDL_MOUSEBUTTONDOWN) {
+            // Clicking on a tile shows only that camera, clicking again goes back to the grid.
+            if (focused_tile >= 0) {
+                focused_tile = -1;
+            } else {
+                // The mouse is in window coordinates, the tiles are in pixels, which differ on a high DPI screen.
+                int window_width = 1, window_height = 1, output_width = 1, output_height = 1;
+                SDL_GetWindowSize(window, &window_width, &window_height);
+                SDL_GetRendererOutputSize(renderer, &output_width, &output_height);
+                int x = event.button.x * output_width / std::max(1, window_width);
+                int y = event.button.y * output_height / std::max(1, window_height);
+                for (size_t i = 0; i < tiles.size(); i++) {
+                    const SDL_Rect& cell = tiles[i]->cell;
+                    if (x >= cell.x && x < cell.x + cell.w && y >= cell.y && y < cell.y + cell.h) {
+                        focused_tile = static_cast<int>(i);
+                        break;
+                    }
+                }
+            }
+            layout_changed = true;
         }
     }
 }
 
 
-void LiveStream_window::draw_image(const string& image_name)
+SDL_Texture* LiveStream_window::load_image(const string& image_name)
 {
-    static bool window_initialized = false;
+    SDL_Surface* surface = IMG_Load(image_name.c_str());
+    if (surface == nullptr) {
+        syslog(log_facility | LOG_ERR, "Error opening image %s : %s", image_name.c_str(), SDL_GetError());
+        exit_code = EXIT_FAILURE;
+        terminate_livestream(0);
+    }
 
-    int window_width = 0, window_height = 0;
+    initialize_window(surface->w, surface->h);
 
-    if (surface != nullptr) {
-        SDL_FreeSurface(surface);
-        surface = nullptr;
+    SDL_Texture* image = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_FreeSurface(surface);
+    if (image == nullptr) {
+        syslog(log_facility | LOG_CRIT, "Error creating texture: %s", SDL_GetError());
+        exit_code = EXIT_FAILURE;
+        terminate_livestream(0);
     }
+    return image;
+}
 
-    // while (true) is needed because it might fail to open the image file the first time
-    while (true) {
-        surface = IMG_Load(image_name.c_str());
-        if (surface != nullptr)  // success
-            break;
-        const char* const error_message = SDL_GetError();
-        // Trying to open the image file while SmartCCTV is writing it.
-        if (strcmp("Error reading from datastream", error_message) == 0) {
-            SDL_Delay(5);
-            continue;
-        // This is a bug that sometimes happens.
-        // It just failed to open the image for some reason.
-        } else if (strcmp("Unsupported image format", error_message) == 0) {
-            SDL_Delay(5);
-            continue;
-        } else {
-            syslog(log_facility | LOG_ERR, "Error opening image %s : %s", image_name.c_str(), error_message);
-            exit_code = EXIT_FAILURE;
-            terminate_livestream(0);
+
+void LiveStream_window::draw_image(SDL_Texture* image)
+{
+    // clear the window
+    SDL_RenderClear(renderer);
+
+    // draw the image to the window
+    SDL_RenderCopy(renderer, image, nullptr, nullptr);
+    SDL_RenderPresent(renderer);
+}
+
+
+bool LiveStream_window::find_cameras()
+{
+    bool camera_added = false;
+
+    if (auto dir = opendir(streamDir.c_str())) {
+        while (auto f = readdir(dir)) {
+            if (f->d_name[0] == '.' || strncmp("camera", f->d_name, 6) != 0) {
+                continue;  // Skip everything that starts with a dot, and what isn't a camera.
+            }
+            bool known = false;
+            for (auto& tile : tiles) {
+                known = known || tile->camera_name == f->d_name;
+            }
+            if (known) {
+                continue;
+            }
+
+            std::unique_ptr<Stream_tile> tile(new Stream_tile());
+            tile->camera_name = f->d_name;
+            tile->texture = nullptr;
+            tile->texture_width = 0;
+            tile->texture_height = 0;
+            tile->frame_width = 0;
+            tile->frame_height = 0;
+            tile->cell = SDL_Rect{ 0, 0, 0, 0 };
+            tile->picture = tile->cell;
+            tile->has_frame = false;
+            tile->last_frame_ticks = 0;
+            tiles.push_back(std::move(tile));
+            camera_added = true;
         }
+        closedir(dir);
     }
-    window_width = surface->w;
-    window_height = surface->h;
 
-    // Initialize the SDL window (this is only run once).
-    if (!window_initialized) {
-        window = SDL_CreateWindow("SmartCCTV LiveStream Viewer", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, window_width, window_height, 0);
-        if (window == nullptr) {
-            syslog(log_facility | LOG_CRIT, "Error creating window: %s", SDL_GetError());
-            exit_code = EXIT_FAILURE;
-            terminate_livestream(0);
+    if (camera_added) {
+        // camera2 comes before camera10.
+        std::sort(tiles.begin(), tiles.end(), [](const std::unique_ptr<Stream_tile>& a, const std::unique_ptr<Stream_tile>& b) {
+            return a->camera_name.length() != b->camera_name.length() ? a->camera_name.length() < b->camera_name.length()
+                                                                      : a->camera_name < b->camera_name;
+        });
+        // The tiles moved, the focused one might be another camera now.
+        focused_tile = -1;
+        syslog(log_facility | LOG_NOTICE, "LiveStream Viewer shows %zu cameras", tiles.size());
+    }
+    return camera_added;
+}
+
+
+void LiveStream_window::layout_tiles()
+{
+    int output_width = 0, output_height = 0;
+    SDL_GetRendererOutputSize(renderer, &output_width, &output_height);
+
+    // The smallest square grid that has room for all of the cameras, without empty rows.
+    int count = static_cast<int>(tiles.size());
+    int columns = 1;
+    while (columns * columns < count) {
+        columns++;
+    }
+    int rows = (count + columns - 1) / columns;
+
+    for (int i = 0; i < count; i++) {
+        Stream_tile& tile = *tiles[i];
+        if (focused_tile >= 0) {
+            tile.cell = (i == focused_tile) ? SDL_Rect{ 0, 0, output_width, output_height } : SDL_Rect{ 0, 0, 0, 0 };
+        } else {
+            int column = i % columns, row = i / columns;
+            tile.cell.x = column * output_width / columns;
+            tile.cell.y = row * output_height / rows;
+            tile.cell.w = (column + 1) * output_width / columns - tile.cell.x;
+            tile.cell.h = (row + 1) * output_height / rows - tile.cell.y;
+        }
+        if (tile.frame_width > 0) {
+            tile.picture = fit_picture(tile.cell, tile.frame_width, tile.frame_height);
         }
+    }
+}
+
+
+bool LiveStream_window::update_tile(Stream_tile& tile)
+{
+    // A tile that can't be seen costs nothing, it's camera isn't even read.
+    if (tile.cell.w <= 0 || tile.cell.h <= 0) {
+        return false;
+    }
 
-        Uint32 render_flags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC;
-        renderer = SDL_CreateRenderer(window, -1, render_flags);
-        if (renderer == nullptr) {
-            syslog(log_facility | LOG_CRIT, "Error creating renderer: %s", SDL_GetError());
+    tile.doorbell_rang = false;
+    // The camera daemon made a new shared memory for frames of another size.
+    if (tile.reader.writerClosed() && !connect_tile(tile)) {
+        return false;
+    }
+    SharedFrameView frame;
+    if (!tile.reader.hasNewFrame() || !tile.reader.latestFrame(frame)) {
+        return false;
+    }
+
+    // The texture is the size of the picture on the screen, or of the frame if that is smaller.
+    // A frame much bigger than it's tile is scaled down here, while it is copied anyway.
+    bool frame_size_changed = frame.width != tile.frame_width || frame.height != tile.frame_height;
+    tile.frame_width = frame.width;
+    tile.frame_height = frame.height;
+    tile.picture = fit_picture(tile.cell, frame.width, frame.height);
+    int texture_width = std::min(tile.picture.w, frame.width);
+    int texture_height = std::min(tile.picture.h, frame.height);
+
+    // OpenCV keeps the bytes of a pixel in blue, green, red order.
+    if (tile.texture == nullptr || frame_size_changed || tile.texture_width != texture_width || tile.texture_height != texture_height) {
+        if (tile.texture != nullptr) {
+            SDL_DestroyTexture(tile.texture);
+        }
+        tile.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_BGR24, SDL_TEXTUREACCESS_STREAMING, texture_width, texture_height);
+        if (tile.texture == nullptr) {
+            syslog(log_facility | LOG_CRIT, "Error creating texture: %s", SDL_GetError());
             exit_code = EXIT_FAILURE;
             terminate_livestream(0);
         }
-
-        window_initialized = true;
+        tile.texture_width = texture_width;
+        tile.texture_height = texture_height;
+        tile.source_columns.resize(texture_width);
+        for (int x = 0; x < texture_width; x++) {
+            tile.source_columns[x] = (x * frame.width / texture_width) * 3;
+        }
+        syslog(log_facility | LOG_NOTICE, "%s is %dx%d, shown at %dx%d", tile.camera_name.c_str(), frame.width, frame.height,
+               texture_width, texture_height);
     }
 
-    // Create a new texture for each surface (image).
-    if (texture != nullptr) {
-        SDL_DestroyTexture(texture);
-        texture = nullptr;
+    // The pixels are copied from the shared memory into the staging buffer first, and the texture is only updated
+    // once the frame is known not to be torn, so the screen never shows half of two frames.
+    tile.staging.resize(static_cast<size_t>(texture_width) * texture_height * 3);
+    for (int attempt = 0; ; attempt++) {
+        for (int y = 0; y < texture_height; y++) {
+            unsigned char* destination = tile.staging.data() + static_cast<size_t>(y) * texture_width * 3;
+            const unsigned char* source = frame.pixels + static_cast<size_t>(y * frame.height / texture_height) * frame.stride;
+            if (texture_width == frame.width) {
+                memcpy(destination, source, texture_width * 3);
+            } else {
+                for (int x = 0; x < texture_width; x++) {
+                    const unsigned char* pixel = source + tile.source_columns[x];
+                    destination[3 * x]     = pixel[0];
+                    destination[3 * x + 1] = pixel[1];
+                    destination[3 * x + 2] = pixel[2];
+                }
+            }
+        }
+        if (tile.reader.finishFrame(frame)) {
+            break;
+        }
+        // The camera daemon wrote over the slot while the pixels were copied, so there is a newer frame, it is copied instead.
+        // If that one is torn too, the screen keeps the last frame until the next one.
+        if (attempt == 1 || !tile.reader.latestFrame(frame)) {
+            return false;
+        }
+        if (frame.width != tile.frame_width || frame.height != tile.frame_height) {
+            // Every frame that was taken is handed back, the size of the tile changes with the next frame.
+            tile.reader.finishFrame(frame, false);
+            return false;
+        }
     }
-
-    texture = SDL_CreateTextureFromSurface(renderer, surface);
-    SDL_FreeSurface(surface);
-    surface = nullptr;
-    if (texture == nullptr) {
-        syslog(log_facility | LOG_CRIT, "Error creating texture: %s", SDL_GetError());
+    if (SDL_UpdateTexture(tile.texture, nullptr, tile.staging.data(), texture_width * 3) != 0) {
+        syslog(log_facility | LOG_CRIT, "Error updating texture: %s", SDL_GetError());
         exit_code = EXIT_FAILURE;
         terminate_livestream(0);
     }
+    tile.has_frame = true;
+    tile.last_frame_ticks = SDL_GetTicks();
+    return true;
+}
 
+
+void LiveStream_window::draw_tiles()
+{
     // clear the window
     SDL_RenderClear(renderer);
 
-    // draw the image to the window
-    SDL_RenderCopy(renderer, texture, nullptr, nullptr);
-    SDL_RenderPresent(renderer);
+    // draw the tiles to the window
+    for (auto& tile : tiles) {
+        if (tile->cell.w <= 0 || tile->cell.h <= 0) {
+            continue;
+        }
+        if (tile->has_frame) {
+            SDL_RenderCopy(renderer, tile->texture, nullptr, &tile->picture);
+        } else {
+            SDL_RenderCopy(renderer, no_signal_texture, nullptr, &tile->cell);
+        }
+    }
+}
+
+
+void LiveStream_window::log_render_time(Uint64 ticks)
+{
+    render_ticks += ticks;
+    if (ticks > longest_render_ticks) {
+        longest_render_ticks = ticks;
+    }
+    rendered_frames++;
+
+    // One line every 300 frames, about 10 seconds of a camera.
+    if (rendered_frames == 300) {
+        double milliseconds_per_tick = 1000.0 / SDL_GetPerformanceFrequency();
+        syslog(log_facility | LOG_NOTICE, "Live stream render time per frame: %.3f ms average, %.3f ms longest",
+               render_ticks * milliseconds_per_tick / rendered_frames, longest_render_ticks * milliseconds_per_tick);
+        render_ticks = 0;
+        longest_render_ticks = 0;
+        rendered_frames = 0;
+    }
+}
+
+
+void LiveStream_window::initialize_window(int width, int height)
+{
+    // Initialize the SDL window (this is only run once).
+    if (window != nullptr) {
+        return;
+    }
+
+    window = SDL_CreateWindow("SmartCCTV LiveStream Viewer", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, SDL_WINDOW_RESIZABLE);
+    if (window == nullptr) {
+        syslog(log_facility | LOG_CRIT, "Error creating window: %s", SDL_GetError());
+        exit_code = EXIT_FAILURE;
+        terminate_livestream(0);
+    }
+
+    Uint32 render_flags = SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC;
+    renderer = SDL_CreateRenderer(window, -1, render_flags);
+    if (renderer == nullptr) {
+        syslog(log_facility | LOG_CRIT, "Error creating renderer: %s", SDL_GetError());
+        exit_code = EXIT_FAILURE;
+        terminate_livestream(0);
+    }
 }
 
 
@@ -278,4 +638,3 @@ LiveStream_window::~LiveStream_window()
 {
     finalize();
 }
-
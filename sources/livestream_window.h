@@ -9,14 +9,17 @@
  * Description:
  * This file contains the declaration of the LiveStream_window class.
  * An instance of this class represents a single viewer window that is responsible for displaying the
- * live stream from a single camera.
+ * live streams of all of the cameras, as a mosaic of tiles drawn by a single renderer.
  */
 
 #ifndef LIVESTREAM_WINDOW_H
 #define LIVESTREAM_WINDOW_H
 
 #include <string>      /* for std::string */
+#include <vector>      /* for std::vector */
+#include <memory>      /* for std::unique_ptr */
 #include <SDL2/SDL.h>  /* for SDL_Window */
+#include "sharedFrameRing.hpp"
 
 using std::string;
 
@@ -28,8 +31,12 @@ class LiveStream_window {
   public:
     /**
      * The consturctor initializes all the private variables to their initial values.
+     *
+     * @param int signal_fd - A signalfd for the signals that the LiveStream Viewer process blocked,
+     *                        they are handled by the event loop in open().
      */
-    LiveStream_window(const string& streamDir, const string& default_images_directory, const bool& SmartCCTV_daemon_is_running);
+    LiveStream_window(const string& streamDir, const string& default_images_directory, const bool& SmartCCTV_daemon_is_running,
+                      int signal_fd);
 
     /**
      * The destructor calls LiveStream_window::finalize().
@@ -42,12 +49,22 @@ class LiveStream_window {
      * Short for "open window of the livestream viewer"
      * this function contains the main functionality of the LiveStream Viewer Window.
      * If the camera daemon is not running, it displays a default image.
-     * otherwise is uses inotify to watch the directory streamDir and display images on the screen as they
-     * are created by the the camera daemon, and after it displays the images it immediatley deletes them
-     * to keep from overloading the file system with frames of images.
+     * otherwise it finds the camera directories in streamDir and shows every camera as a tile of a grid.
+     * Each tile maps the shared memory that the camera daemon writes the frames of that camera in,
+     * and shows it's newest frame every time there is a new one.
+     * The frames are never saved to a file.
+     *
+     * Clicking on a tile shows only that camera, clicking again goes back to the grid.
+     * The cameras that can't be seen, and all of them while the window is minimized, are not read at all.
+     *
+     * Everything happens in a single epoll loop, that never blocks on anything else. It waits on the doorbells
+     * of the cameras, on the signalfd, on the connection to the camera daemon, on a timer that processes the SDL
+     * events many times a second, and on a timer that connects to the camera daemon, and looks for new cameras
+     * and cameras that stopped sending frames, once a second.
+     * So the window stays responsive, and a frame is shown as soon as it arrives, whether the cameras send frames or not.
      *
      * If the camera daemon is not running, "SmartCCTV is not running" is displayed.
-     * If the camera daemon is running but is not producing images, "NO SIGNAL" is displayed.
+     * If the camera daemon is running but a camera is not producing images, "NO SIGNAL" is displayed in it's tile.
      */
     void open();
 
@@ -64,36 +81,154 @@ class LiveStream_window {
     void set_streamDir(const string& streamDir);
 
   private:
+    /**
+     * The live stream of one camera, a tile of the mosaic.
+     */
+    struct Stream_tile {
+        string camera_name;          // The name of the camera's directory, like camera0.
+        SharedFrameReader reader;
+        SDL_Texture* texture;        // Updated in place, at the size of the tile and not of the camera.
+        int texture_width;
+        int texture_height;
+        std::vector<int> source_columns;  // For every column of the texture, the byte of the frame's row it comes from.
+        std::vector<unsigned char> staging;  // The pixels of the texture, uploaded only once they are known not to be torn.
+        int frame_width;             // The size of the frames the texture was made for.
+        int frame_height;
+        SDL_Rect cell;               // Where the tile is in the window, empty if it can't be seen.
+        SDL_Rect picture;            // Where the frame is in the cell, keeping the shape of the frame.
+        bool has_frame;              // false until the first frame, and again when there is no signal.
+        Uint32 last_frame_ticks;     // SDL_GetTicks() of the last frame.
+        bool doorbell_rang;          // The camera daemon published a frame that wasn't read yet.
+    };
+
+    /**
+     * This function handles the signals that arrived on the signalfd, they all terminate the LiveStream Viewer.
+     */
+    void handle_signals();
+
+    /**
+     * This function reads what the camera daemon sent on the control channel.
+     * When the camera daemon shuts down it closes the connection, then the default image is shown.
+     */
+    void read_control();
+
+    /**
+     * This function is run by the timer once a second.
+     * It connects to the camera daemon if it is not connected yet,
+     * shows the default image when the camera daemon is not running or there are no cameras,
+     * looks for new cameras, connects to the cameras that are not connected yet,
+     * and shows "NO SIGNAL" in the tiles of cameras that sent no frame for a second.
+     */
+    void check_cameras();
+
+    /**
+     * This function maps the shared memory of a camera, and adds it's doorbell to the epoll loop.
+     *
+     * @param Stream_tile& tile - The tile of the camera.
+     *
+     * @return bool - true if it is connected, false if the camera daemon didn't make the shared memory yet.
+     */
+    bool connect_tile(Stream_tile& tile);
+
+    /**
+     * This function reads the tiles whose doorbells rang, and draws the window if anything changed.
+     */
+    void draw_frames();
+
     /**
      * This helper function is used to process events.
      * It is used for user interactions, such as allowing the user to terminate the program by clicking
-     * the [X] in the corner.
+     * the [X] in the corner, resizing the window, or clicking on a tile.
      */
     void process_events();
 
     /**
-     * This function draws an image on the screen.
-     * The first time this function is called, it initializes the window and the renderer to match the
-     * dimentions of the passed in image.
-     * Any subsequent times the window and the renderer and re-used.
+     * This function loads a default image into a texture.
+     * The first time an image is loaded, it initializes the window and the renderer to match the
+     * dimentions of the image.
      *
      * This function terminates the program if it runs into an unrecoverable error.
      *
-     * @param const string& image_name - The full name of the image file to be displayed on the screen,
-     *                                   including the absolute path to it.
+     * @param const string& image_name - The full name of the image file, including the absolute path to it.
+     *
+     * @return SDL_Texture* - The texture of the image.
+     */
+    SDL_Texture* load_image(const string& image_name);
+
+    /**
+     * This function draws a default image over the whole window.
+     *
+     * @param SDL_Texture* image - The texture from load_image().
+     */
+    void draw_image(SDL_Texture* image);
+
+    /**
+     * This function adds a tile for every camera directory in streamDir that doesn't have one yet.
+     *
+     * @return bool - true if a tile was added.
+     */
+    bool find_cameras();
+
+    /**
+     * This function divides the window between the tiles.
+     * If a tile is focused it gets the whole window, and the other tiles get nothing.
+     */
+    void layout_tiles();
+
+    /**
+     * This function copies the newest frame of a camera from the shared memory straight into the
+     * streaming texture of it's tile, scaled down to the size of the tile.
+     * The texture is only made again when the size of the frames or of the tile changes.
+     * A tile that can't be seen is not read at all.
+     *
+     * @param Stream_tile& tile - The tile.
+     *
+     * @return bool - true if the tile changed and has to be drawn again.
+     */
+    bool update_tile(Stream_tile& tile);
+
+    /**
+     * This function draws all of the tiles that can be seen on the screen.
      */
-    void draw_image(const string& image_name);
+    void draw_tiles();
+
+    /**
+     * This function adds up the time it took to render a frame, and logs the average and the longest
+     * render time every 300 frames.
+     *
+     * @param Uint64 ticks - The time, in SDL_GetPerformanceCounter() ticks.
+     */
+    void log_render_time(Uint64 ticks);
+
+    /**
+     * This function creates the window and the renderer the first time an image is drawn.
+     *
+     * @param int width, int height - The size of the first image.
+     */
+    void initialize_window(int width, int height);
 
     string streamDir;
     string default_images_directory;
+    int signal_fd;
+    int control_fd;               // The subscription to the live stream, -1 while the camera daemon is not running.
+    int epoll_fd;
+    int tick_fd;                  // Runs process_events().
+    int no_signal_fd;             // Runs check_cameras().
     SDL_Event event;
     SDL_Window* window;
     SDL_Renderer* renderer;
-    SDL_Surface* surface;
-    SDL_Texture* texture;
+    SDL_Texture* not_running_texture;
+    SDL_Texture* no_signal_texture;
+    std::vector<std::unique_ptr<Stream_tile>> tiles;
+    int focused_tile;             // The index of the tile that has the whole window, -1 for the grid.
+    bool layout_changed;          // The window was resized or a tile was clicked on.
+    bool redraw_needed;           // A tile changed without a new frame, like to "NO SIGNAL".
+    bool showing_default_image;   // The whole window shows a default image, not the tiles.
+    Uint64 render_ticks;          // The render time of the frames since the last log_render_time() line.
+    Uint64 longest_render_ticks;
+    int rendered_frames;
     const bool& is_camera_daemon_running;
 };
 
 
 #endif  /* LIVESTREAM_WINDOW_H */
-
@@ -13,22 +13,24 @@
 
 #include "low_level_cctv_daemon_apis.h"
 #include "camera_daemon.h"
-#include "write_message.h"
+#include "event_channel.h"
 #include "camera.hpp"
+#include "retentionManager.hpp"
 
 #include <sys/types.h>
 #include <sys/stat.h>   /* for umask(), mode permissions constants */
 #include <fcntl.h>      /* for O_* constants, open() */
-#include <unistd.h>     /* for close(), unlink(), fork(), setsid(), sysconf(), chdir(), getpid() */
-#include <signal.h>     /* for sigemptyset(), kill(), signal constants */
+#include <unistd.h>     /* for close(), fork(), setsid(), sysconf(), chdir(), getpid() */
+#include <signal.h>     /* for sigemptyset(), sigaction(), signal constants */
 #include <errno.h>      /* for errno */
 #include <syslog.h>     /* for openlog(), syslog(), closelog() */
 #include <cstdlib>      /* for exit(), atexit(), EXIT_SUCCESS, EXIT_FAILURE */
-#include <cstdio>       /* for fclose(), fprintf() */
 #include <cstring>      /* for strerror() */
 #include <vector>       /* for std::vector */
+#include <string>       /* for std::string */
 
 using std::vector;
+using std::string;
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-result"
@@ -43,18 +45,16 @@ using std::vector;
  */
 volatile Daemon_data daemon_data = {
     // Set the default values for the data members.
-    .pid_file_name = "/tmp/SmartCCTV_daemon_pid",  // The path to the PID file.
-    .pid_file_descriptor = 0,                      // A descriptor to this file.
-    .pid_file_pointer = nullptr,                   // A pointer to this file.
+    .control_socket_fd = -1,                       // The socket of the control channel.
     .camera_daemon_pid = 0,                        // The PID of the daemon.
     .home_directory = nullptr,                     // The path to the home directory, $HOME.
     .enable_human_detection = true,                // whether to enable human detection
     .enable_motion_detection = true,               // whether to enable motion detection
     .enable_outlines = true,                       // whether to draw outlines
-    .is_live_stream_running = false,               // is live stream viewer process currently running
-    .live_stream_viewer_pid = 0,                   // The PID of the LiveStreamViewer
+    .is_live_stream_running = false,               // is a LiveStream Viewer subscribed to the live stream
     .cameraNumber = 0,                             // An integer identifying which camera to use
-    .daemon_exit_status = EXIT_SUCCESS  // The exit status of the daemon, to use in terminate_daemon(), assumed EXIT_SUCCESS.
+    .daemon_exit_status = EXIT_SUCCESS, // The exit status of the daemon, to use in terminate_daemon(), assumed EXIT_SUCCESS.
+    .retention_days = 0                 // Videos older than this many days are deleted, 0 keeps them forever.
 };
 
 
@@ -62,6 +62,11 @@ volatile Daemon_data daemon_data = {
 // When the daemon is terminated, it calls all the finalize() method of all the Cameras.
 vector<Camera*> cameras;
 
+// The cameras that the daemon should open, in the order the user gave them.
+// Each entry is either a camera number ("0", "1", ...) or the path to a media file.
+// It is filled in by the GUI process before the fork, so the daemon process inherits it.
+vector<string> camera_sources;
+
 
 void becomeDaemon()
 {
@@ -94,7 +99,7 @@ void becomeDaemon()
     if (setsid() == -1) {
         syslog(log_facility | LOG_ERR, "Error: Could not change the session ID and process group ID : %m");
         syslog(log_facility | LOG_CRIT, "SmartCCTV Daemon unexpected failure.");
-        write_message("SmartCCTV unexpected failure.");
+        send_gui_event(EVENT_DAEMON_FAILED, -1, "SmartCCTV unexpected failure.");
         // This time, it is actually the daemon process which gets killed,
         // if it can't change the session ID and process group ID.
         daemon_data.daemon_exit_status = EXIT_FAILURE;
@@ -106,7 +111,7 @@ void becomeDaemon()
     /*
     long max_open_file_descriptors = sysconf(_SC_OPEN_MAX);
     for (long i = 0; i < max_open_file_descriptors; ++i) {
-        if (i != daemon_data.pid_file_descriptor) {
+        if (i != daemon_data.control_socket_fd) {
             close(i);
         }
     }
@@ -137,11 +142,8 @@ void becomeDaemon()
     // it would compromize the daemon's ability to do so.
     umask(0);
 
-    // Write the PID of the daemon process to the PID file.
+    // The control socket was inherited from the GUI process, it is what tells everyone that the daemon is running.
     daemon_data.camera_daemon_pid = getpid();
-    fprintf(daemon_data.pid_file_pointer, "%d", daemon_data.camera_daemon_pid);
-    fclose(daemon_data.pid_file_pointer);
-    close(daemon_data.pid_file_descriptor);
 
     // This sets up the signal handler for when the process is terminated.
     struct sigaction action1;
@@ -170,23 +172,11 @@ void terminate_daemon(int)
     for (Camera* camera : cameras) {
         camera->finalize();
     }
+    // The videos the cameras saved while finalizing are counted by the next daemon.
+    RetentionManager::instance().stop();
 
-    // The LiveStream process recieves SIGUSR2 when the daemon shuts down.
-    if (daemon_data.live_stream_viewer_pid) {
-        syslog(log_facility | LOG_WARNING, "sending signal to %d", daemon_data.live_stream_viewer_pid);
-        kill(daemon_data.live_stream_viewer_pid, SIGUSR2);
-    }
-
-    if (close(daemon_data.pid_file_descriptor) == -1) {
-        syslog(log_facility | LOG_ERR, "Error: could not close the PID file.");
-    }
-
-    if (unlink(daemon_data.pid_file_name) == -1) {
-        syslog(log_facility | LOG_ERR, "Error: could not remove the PID file.");
-    } else {
-        syslog(log_facility | LOG_NOTICE, "Removed the PID file successfully.");
-    }
-
+    // The LiveStream Viewer sees it's connection to the control socket close when the daemon exits,
+    // there is no PID file to remove and no signal to send.
     syslog(log_facility | LOG_NOTICE, "The camera daemon is turning off.");
 
     exit(daemon_data.daemon_exit_status);
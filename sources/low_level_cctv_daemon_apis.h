@@ -13,7 +13,7 @@
 #ifndef LOW_LEVEL_CCTV_DAEMON_APIS_H
 #define LOW_LEVEL_CCTV_DAEMON_APIS_H
 
-#include <cstdio>       /* for FILE */
+#include <atomic>  /* for std::atomic */
 
 // You can change this to make the syslog() output to a different file.
 #define log_facility LOG_LOCAL0
@@ -25,18 +25,20 @@
  * custom parameters.
  */
 struct Daemon_data {
-    const char* pid_file_name;     // The path to the PID file.
-    int pid_file_descriptor;       // A descriptor to this file.
-    FILE* pid_file_pointer;        // A pointer to this file.
+    int control_socket_fd;         // The socket of the control channel, bound before the fork, see control_channel.h
     int camera_daemon_pid;         // The PID of the daemon.
     const char* home_directory;    // The path to the home directory, $HOME.
+    // The detection settings the daemon starts with. The cameras use the snapshot in detectionConfig.hpp,
+    // which starts out with these and then follows the set requests of the control channel.
     bool enable_human_detection;   // whether to enable human detection
     bool enable_motion_detection;  // whether to enable motion detection
     bool enable_outlines;          // whether to draw outlines
-    bool is_live_stream_running;   // is live stream viewer process currently running
-    int live_stream_viewer_pid;    // The PID of the LiveStreamViewer
+    bool is_live_stream_running;   // is a LiveStream Viewer subscribed to the live stream on the control channel
     int cameraNumber;              // An integer identifying which camera to use
-    int daemon_exit_status;        // The exit status of the daemon, to use in terminate_daemon(), assumed EXIT_SUCCESS.
+    // The exit status of the daemon, to use in terminate_daemon(), assumed EXIT_SUCCESS.
+    // Every camera thread may set it when it fails, volatile alone would not make that safe.
+    std::atomic<int> daemon_exit_status;
+    int retention_days;            // Videos older than this many days are deleted, 0 keeps them forever, see retentionManager.hpp.
 };
 
 
@@ -52,7 +54,6 @@ struct Daemon_data {
  * - move the daemon process into the root directory.
  * - reset the umask to a known value.
  * - reset the environmental variables to a known value.
- * - write the PID of the daemon process into the PID file.
  * - setup the logging for communication with the outside world.
  * - setup the signal handler for when the process is terminated.
  * - call camera_daemon() function inside of which the daemon will be in it's entire lifetime.
@@ -66,8 +67,8 @@ void becomeDaemon();
  * - SIGTERM
  * - SIGQUIT
  *
- * This function closes and removes the PID file.
- * Then it terminates the camera daemon.
+ * This function finalizes the cameras and terminates the camera daemon.
+ * The control socket is closed by the kernel, which also tells the LiveStream Viewer that the daemon is gone.
  *
  * This function is called only in the daemon process.
  */
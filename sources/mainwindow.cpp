@@ -17,12 +17,9 @@
 #include "ui_mainwindow.h"
 
 #include <string>       /* for std::string */
+#include <vector>       /* for std::vector */
 #include <syslog.h>     /* for openlog(), syslog(), closelog() */
 #include <cstdlib>      /* for getenv(), atexit(), exit(), EXIT_FAILURE */
-#include <cstring>      /* for memset(), strcmp(), strncmp() */
-#include <signal.h>     /* for sigaction(), sigemptyset(), SIGCONT */
-#include <mqueue.h>     /* for mq_notify(), mq_receive(), mq_open(), mq_close(), mq_unlink() */
-#include <unistd.h>     /* for sleep() */
 #include <stdio.h>      /* for sprintf() */
 #include<iostream>      /* for is_open(), close(), ifstream */
 #include <fstream>      /* for is_open(), close(), ifstream */
@@ -30,133 +27,11 @@
 #include <QtDebug>
 #include <QLabel>
 #include <QCheckBox>
+#include <QSocketNotifier>
+#include <QStatusBar>
 
 using namespace std;
 
-mqd_t message_handler;  // message queue file descriptor
-string message_handler_name = "/SmartCCTV_Message_handler";
-QLabel* message_label = nullptr;
-QLabel* daemon_label = nullptr;
-QCheckBox* checkBox_1 = nullptr;
-QCheckBox* checkBox_2 = nullptr;
-QCheckBox* checkBox_3 = nullptr;
-Daemon_facade* daemon_facade_ptr = nullptr;
-
-
-void close_message_handler()
-{
-    syslog(log_facility | LOG_NOTICE, "Closing %s", message_handler_name.c_str());
-    mq_close(message_handler);
-    mq_unlink(message_handler_name.c_str());
-}
-
-
-void read_message(int)
-{
-    // Set up the message handler to recieve signal whenever a message comes in.
-    // This is being done inside of the handler function because it has to be "reset" each time it is used.
-    struct sigevent message_recieved;
-    message_recieved.sigev_notify = SIGEV_SIGNAL;
-    message_recieved.sigev_signo  = SIGCONT;
-    mq_notify(message_handler, &message_recieved);
-
-    // read a message
-    int err;
-    char message[151];
-    memset(message, 0, 151);  // zero out the buffer
-    // This is a while loop to handle when there are multiple messages queued up,
-    // waiting to be read.
-    while ( (err = mq_receive(message_handler, message, 150, nullptr)) != -1) {
-        syslog(log_facility | LOG_NOTICE, "%s", message);
-        // set the message into the label.
-        if (message_label != nullptr) {
-            message_label->setText(message);
-        }
-
-        if (strcmp("SmartCCTV encountered an error.", message) == 0) {
-            if (daemon_label != nullptr) {
-                daemon_label->setText("SmartCCTV have stopped running.");
-            }
-            //outline checkbox
-            checkBox_1->setEnabled(true);
-            //human detection checkbox
-            checkBox_2->setEnabled(true);
-            //motion detection checkbox
-            checkBox_3->setEnabled(true);
-        } else if (strcmp("SmartCCTV unexpected failure.", message) == 0) {
-            if (daemon_label != nullptr) {
-                daemon_label->setText("SmartCCTV have stopped running.");
-            }
-            //outline checkbox
-            checkBox_1->setEnabled(true);
-            //human detection checkbox
-            checkBox_2->setEnabled(true);
-            //motion detection checkbox
-            checkBox_3->setEnabled(true);
-        } else if (strncmp("SmartCCTV failed to open ", message, 25) == 0) {
-            if (daemon_label != nullptr) {
-                daemon_label->setText("SmartCCTV have stopped running.");
-            }
-            //outline checkbox
-            checkBox_1->setEnabled(true);
-            //human detection checkbox
-            checkBox_2->setEnabled(true);
-            //motion detection checkbox
-            checkBox_3->setEnabled(true);
-        } else if (strncmp("SmartCCTV could not create ", message, 27) == 0) {
-            if (daemon_label != nullptr) {
-                daemon_label->setText("Can not run SmartCCTV due to permission error.");
-            }
-            //outline checkbox
-            checkBox_1->setEnabled(true);
-            //human detection checkbox
-            checkBox_2->setEnabled(true);
-            //motion detection checkbox
-            checkBox_3->setEnabled(true);
-        } else if (strcmp("LiveStream Viewer unexpected failure.", message) == 0) {
-            if (daemon_label != nullptr) {
-                daemon_label->setText("LiveStream Viewer have stopped running.");
-            }
-        } else if (strcmp("Can't open LiveStream Viewer: SmartCCTV has been tampered.", message) == 0) {
-            if (daemon_facade_ptr != nullptr) {
-                bool daemon = daemon_facade_ptr->kill_daemon();
-                if(daemon == false){
-                    if (daemon_label != nullptr) {
-                        daemon_label->setText("SmartCCTV is currently not running.");
-                    }
-                } else {
-                    if (daemon_label != nullptr) {
-                        daemon_label->setText("SmartCCTV have stopped running.");
-                    }
-                }
-
-                //outline checkbox
-                checkBox_1->setEnabled(true);
-                //human detection checkbox
-                checkBox_2->setEnabled(true);
-                //motion detection checkbox
-                checkBox_3->setEnabled(true);
-            }
-        } else if (strcmp("LiveStream Viewer window was closed.", message) == 0) {
-            if (daemon_label != nullptr) {
-                daemon_label->setText("LiveStream Viewer have stopped running.");
-            }
-        } else if (strcmp("Cannot find project configuration files.", message) == 0) {
-            if (daemon_label != nullptr) {
-                daemon_label->setText("SmartCCTV have stopped running.");
-            }
-            //outline checkbox
-            checkBox_1->setEnabled(true);
-            //human detection checkbox
-            checkBox_2->setEnabled(true);
-            //motion detection checkbox
-            checkBox_3->setEnabled(true);
-        }
-
-        memset(message, 0, 151);  // zero out the buffer
-    }
-}
-
 
 bool chkList(string str, int dayAmt) 
 {
@@ -188,7 +63,7 @@ bool chkList(string str, int dayAmt)
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
-    , ui(new Ui::MainWindow), home_directory(nullptr)
+    , ui(new Ui::MainWindow), home_directory(nullptr), event_queue(-1), event_notifier(nullptr), control_notifier(nullptr)
 {
     ui->setupUi(this);
     // The SmartCCTv GUI also writes messages to the syslog, so we need to open that as well.
@@ -202,48 +77,16 @@ MainWindow::MainWindow(QWidget *parent)
         exit(EXIT_FAILURE);
     }
 
-    // Set the QLabel to display the message that the daemon sends it.
-    message_label = ui->label_3;
-    daemon_label = ui->daemon_label;
-
-    // Set the QCheckBox pointers.
-    checkBox_1 = ui->checkBox;
-    checkBox_2 = ui->checkBox_2;
-    checkBox_3 = ui->checkBox_3;
-
-    // Set the daemon_facade_ptr.
-    daemon_facade_ptr = &daemon_facade;
-
-    // Setup the message handler to recieve error messages from the daemon and dispaly them onto the GUI.
-    // Make sure we can handle the SIGCONT message when the message queue notification sens the signal.
-    struct sigaction action_to_take;
-    // handle with this function
-    action_to_take.sa_handler = read_message;
-    // zero out the mask (allow any signal to interrupt)
-    sigemptyset(&action_to_take.sa_mask);
-    action_to_take.sa_flags = 0;
-    // Setup the handler for SIGCONT.
-    sigaction(SIGCONT, &action_to_take, nullptr);
-
-    struct mq_attr mq_attributes;
-    mq_attributes.mq_flags = 0;
-    mq_attributes.mq_maxmsg = 5;
-    mq_attributes.mq_msgsize = 120;
-
-    if ( (message_handler = mq_open(message_handler_name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_NONBLOCK, S_IRUSR | S_IWUSR, &mq_attributes)) == -1)
-    {
-        syslog(log_facility | LOG_ERR, "Error: Could not create the message handler %s %m", message_handler_name.c_str());
+    // The daemon and the LiveStream Viewer send their events to the queue of the event channel.
+    // The queue is a file descriptor, so it is watched by the event loop of the GUI like any other socket,
+    // and the events are handled between two repaints instead of interrupting the GUI in a signal handler.
+    if ( (event_queue = open_gui_event_queue()) == -1) {
+        syslog(log_facility | LOG_ERR, "Error: Could not create the event channel : %m");
         syslog(log_facility | LOG_CRIT, "Failure starting the SmartCCTV application.");
         exit(EXIT_FAILURE);
     }
-
-    // Set up the message handler to recieve signal whenever a message comes in.
-    struct sigevent message_recieved;
-    message_recieved.sigev_notify = SIGEV_SIGNAL;
-    message_recieved.sigev_signo  = SIGCONT;
-    mq_notify(message_handler, &message_recieved);
-
-    syslog(log_facility | LOG_NOTICE, "Creating %s", message_handler_name.c_str());
+    event_notifier = new QSocketNotifier(event_queue, QSocketNotifier::Read, this);
+    connect(event_notifier, &QSocketNotifier::activated, this, &MainWindow::read_events);
 
     daemon_facade.set_daemon_info(home_directory);
     QDate date = QDate::currentDate();
@@ -258,7 +101,11 @@ MainWindow::MainWindow(QWidget *parent)
 MainWindow::~MainWindow()
 {
     syslog(log_facility | LOG_NOTICE, "The GUI window was closed.");
-    close_message_handler();
+    event_notifier->setEnabled(false);
+    close_gui_event_queue(event_queue);
+    if (control_notifier != nullptr) {
+        control_notifier->setEnabled(false);
+    }
 
     delete ui;
 }
@@ -283,30 +130,54 @@ void MainWindow::on_pushButton_clicked()
 }
 
 
+/**
+ * The cameras are numbered from 1 in the GUI and from 0 in the daemon, the paths of video files are kept as they are.
+ *
+ * @param const QString& text - The camera numbers and video files, separated by commas.
+ *
+ * @return vector<string> - The sources for Daemon_facade::run_daemon(), without the empty entries.
+ */
+static vector<string> parse_camera_sources(const QString& text)
+{
+    vector<string> camera_sources;
+    for (const QString& entry : text.split(',')) {
+        QString source = entry.trimmed();
+        if (source.isEmpty()) {
+            continue;
+        }
+        bool is_number = false;
+        int cameraNumber = source.toInt(&is_number);
+        if (is_number && cameraNumber >= 1) {
+            camera_sources.push_back(std::to_string(cameraNumber - 1));
+        } else {
+            camera_sources.push_back(source.toStdString());
+        }
+    }
+    return camera_sources;
+}
+
+
 void MainWindow::on_pushButton_Run_clicked()
 {
     // Making a command to run or kill the daemon should reset the dispalyed error message.
-    if (message_label != nullptr) {
-        message_label->setText("");
-    }
+    ui->label_3->setText("");
 
-    //This returns the value of the selected camera.
-    int cameraNumber = ui->cameraSpinBox->value() - 1;
+    // Every camera of the list runs on it's own thread of the daemon.
+    vector<string> camera_sources = parse_camera_sources(ui->cameraSourcesEdit->text());
+    if (camera_sources.empty()) {
+        ui->daemon_label->setText("Enter a camera number or a video file.");
+        return;
+    }
 
     //This will return boolean value which option is selected.
     bool outline = ui->checkBox->isChecked();
     bool human_det = ui->checkBox_2->isChecked();
     bool motion_det = ui->checkBox_3->isChecked();
 
-    int daemon = daemon_facade.run_daemon(human_det, motion_det, outline, cameraNumber);
+    // The checkboxes stay enabled, changing them changes the settings of the running daemon.
+    int daemon = daemon_facade.run_daemon(human_det, motion_det, outline, camera_sources);
     if(daemon == 0){
         ui->daemon_label->setText("SmartCCTV is now running.");
-        //outline checkbox
-        ui->checkBox->setEnabled(false);
-        //human detection checkbox
-        ui->checkBox_2->setEnabled(false);
-        //motion detection checkbox
-        ui->checkBox_3->setEnabled(false);
     }
     else if(daemon == 1){
         ui->daemon_label->setText("SmartCCTV is already running.");
@@ -320,9 +191,7 @@ void MainWindow::on_pushButton_Run_clicked()
 void MainWindow::on_pushButton_Kill_clicked()
 {
     // Making a command to run or kill the daemon should reset the dispalyed error message.
-    if (message_label != nullptr) {
-        message_label->setText("");
-    }
+    ui->label_3->setText("");
 
     bool daemon = daemon_facade.kill_daemon();
     if(daemon == false){
@@ -331,13 +200,8 @@ void MainWindow::on_pushButton_Kill_clicked()
     else{
         ui->daemon_label->setText("SmartCCTV have stopped running.");
     }
-
-    //outline checkbox
-    ui->checkBox->setEnabled(true);
-    //human detection checkbox
-    ui->checkBox_2->setEnabled(true);
-    //motion detection checkbox
-    ui->checkBox_3->setEnabled(true);
+    camera_status.clear();
+    show_camera_status();
 }
 
 
@@ -367,3 +231,149 @@ void MainWindow::on_pushButton_2_clicked()
     }
 }
 
+
+// The videos are kept forever until the user picks a number of days, then the older ones are deleted.
+// It is only sent when the user changes it, so opening the GUI never deletes anything.
+void MainWindow::on_retentionSpinBox_valueChanged(int days)
+{
+    daemon_facade.set_retention_days(days);
+    watch_control_connection();
+}
+
+
+// The detection settings of a running daemon are changed right away, the cameras use them from their next frame.
+// While the daemon is not running, the checkboxes are only read when it is started.
+void MainWindow::on_checkBox_toggled(bool checked)
+{
+    send_daemon_setting("outlines", checked);
+}
+
+
+void MainWindow::on_checkBox_2_toggled(bool checked)
+{
+    send_daemon_setting("human_detection", checked);
+}
+
+
+void MainWindow::on_checkBox_3_toggled(bool checked)
+{
+    send_daemon_setting("motion_detection", checked);
+}
+
+
+void MainWindow::send_daemon_setting(const char* setting, int value)
+{
+    // The answer is read by read_control_answers() when it comes, a daemon that is starting up answers once it's cameras are open.
+    daemon_facade.set_daemon_setting(setting, value);
+    watch_control_connection();
+}
+
+
+void MainWindow::watch_control_connection()
+{
+    int control_fd = daemon_facade.control_fd();
+    if (control_notifier != nullptr && control_notifier->socket() == control_fd) {
+        return;
+    }
+    if (control_notifier != nullptr) {
+        // This can be called from the notifier's own signal, so it is deleted once the signal returns.
+        control_notifier->setEnabled(false);
+        control_notifier->deleteLater();
+        control_notifier = nullptr;
+    }
+    if (control_fd != -1) {
+        control_notifier = new QSocketNotifier(control_fd, QSocketNotifier::Read, this);
+        connect(control_notifier, &QSocketNotifier::activated, this, &MainWindow::read_control_answers);
+    }
+}
+
+
+void MainWindow::read_control_answers()
+{
+    vector<string> refused;
+    daemon_facade.read_daemon_answers(refused);
+    for (const string& setting : refused) {
+        ui->daemon_label->setText(QString("SmartCCTV refused to change ") + setting.c_str() + ".");
+    }
+    // The notifier goes away with the connection when the daemon stopped.
+    watch_control_connection();
+}
+
+
+void MainWindow::read_events()
+{
+    // All of the events that are waiting are handled at once, and the status bar is only updated once for all of them.
+    bool status_changed = false;
+    Gui_event event;
+    while (receive_gui_event(event_queue, event)) {
+        switch (event.type) {
+        case EVENT_DAEMON_FAILED:
+            syslog(log_facility | LOG_NOTICE, "%s", event.text);
+            ui->label_3->setText(event.text);
+            ui->daemon_label->setText("SmartCCTV have stopped running.");
+            break;
+        case EVENT_PERMISSION_ERROR:
+            syslog(log_facility | LOG_NOTICE, "SmartCCTV could not create %s", event.text);
+            ui->label_3->setText(QString("SmartCCTV could not create ") + event.text);
+            ui->daemon_label->setText("Can not run SmartCCTV due to permission error.");
+            break;
+        case EVENT_CAMERA_ERROR:
+            syslog(log_facility | LOG_NOTICE, "camera%d: %s", event.camera, event.text);
+            ui->label_3->setText(event.text);
+            ui->daemon_label->setText("SmartCCTV have stopped running.");
+            camera_status.erase(event.camera);
+            status_changed = true;
+            break;
+        case EVENT_VIEWER_STOPPED:
+            syslog(log_facility | LOG_NOTICE, "%s", event.text);
+            ui->label_3->setText(event.text);
+            ui->daemon_label->setText("LiveStream Viewer have stopped running.");
+            break;
+        case EVENT_DETECTION_STARTED:
+        case EVENT_DETECTION_ENDED:
+            camera_status[event.camera].recording = event.type == EVENT_DETECTION_STARTED;
+            status_changed = true;
+            break;
+        case EVENT_DISK_FULL:
+            syslog(log_facility | LOG_NOTICE, "%s", event.text);
+            ui->label_3->setText(event.text);
+            break;
+        case EVENT_CLIP_SAVED:
+            ui->label_3->setText(QString("Saved ") + event.text);
+            break;
+        case EVENT_CAMERA_STATS: {
+            Camera_status& status = camera_status[event.camera];
+            status.fps = event.fps;
+            status.events = event.events;
+            status.dropped = event.dropped;
+            status_changed = true;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    if (status_changed) {
+        show_camera_status();
+    }
+}
+
+
+void MainWindow::show_camera_status()
+{
+    QString text;
+    for (const auto& camera : camera_status) {
+        if (!text.isEmpty()) {
+            text += "   ";
+        }
+        text += QString("camera%1: %2 fps, %3 events").arg(camera.first).arg(camera.second.fps, 0, 'f', 1).arg(camera.second.events);
+        if (camera.second.dropped > 0) {
+            text += QString(", %1 dropped").arg(camera.second.dropped);
+        }
+        if (camera.second.recording) {
+            text += ", recording";
+        }
+    }
+    statusBar()->showMessage(text);
+}
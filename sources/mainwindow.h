@@ -16,7 +16,12 @@
 
 #include "high_level_cctv_daemon_apis.h"
 #include "livestream_facade.h"
+#include "event_channel.h"
 #include <QMainWindow>
+#include <cstdint>
+#include <map>
+
+class QSocketNotifier;
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -41,11 +46,44 @@ private slots:
 
     void on_pushButton_2_clicked();
 
+    void on_retentionSpinBox_valueChanged(int days);
+
+    void on_checkBox_toggled(bool checked);
+
+    void on_checkBox_2_toggled(bool checked);
+
+    void on_checkBox_3_toggled(bool checked);
+
+    void read_events();
+
+    void read_control_answers();
+
 private:
+    // What the GUI knows about one camera of the daemon, from the events of the event channel.
+    struct Camera_status {
+        float fps = 0;
+        std::uint64_t events = 0;
+        std::uint64_t dropped = 0;
+        bool recording = false;
+    };
+
+    // Shows the frame rate and the events of every camera in the status bar.
+    void show_camera_status();
+
+    // Sends a setting to a running daemon without waiting for it, a daemon that is not running reads the checkboxes when it starts.
+    void send_daemon_setting(const char* setting, int value);
+
+    // Watches the connection the settings are sent on, for as long as it is open.
+    void watch_control_connection();
+
     Ui::MainWindow *ui;
     Daemon_facade daemon_facade;
     LiveStream_facade liveStream_facade;
     const char* home_directory;
+    int event_queue;
+    QSocketNotifier* event_notifier;
+    QSocketNotifier* control_notifier;
+    std::map<int, Camera_status> camera_status;
 };
 
 #endif // MAINWINDOW_H
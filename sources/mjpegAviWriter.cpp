@@ -0,0 +1,271 @@
+/**
+ * File Name:  mjpegAviWriter.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class writes an AVI file with a single Motion JPEG video stream out of frames that are already
+ * JPEG compressed. cv::VideoWriter always wants raw frames and compresses them again, this class just
+ * copies the JPEG payloads into the container, so a frame is never encoded twice.
+ *
+ * The layout of the file is the classic AVI 1.0 one:
+ * RIFF "AVI " { LIST "hdrl" { avih, LIST "strl" { strh, strf } }, LIST "movi" { 00dc ... }, idx1 }
+ */
+
+#include "mjpegAviWriter.hpp"
+#include <syslog.h>  /* for syslog() */
+#include <cmath>     /* for std::lround() */
+
+#define log_facility LOG_LOCAL0
+
+namespace
+{
+	const std::uint32_t AVIF_HASINDEX = 0x10;
+	const std::uint32_t AVIIF_KEYFRAME = 0x10;
+	// The frame rate is stored as rate / scale, this keeps fractional rates like 29.97
+	const std::uint32_t RATE_SCALE = 1000;
+}
+
+
+MjpegAviWriter::MjpegAviWriter()
+ : file(nullptr), fileSize(0), largestFrame(0), frameRate(0), riffSizePosition(0),
+   microSecondsPerFramePosition(0), ratePosition(0), totalFramesPosition(0),
+   suggestedBufferPosition(0), streamLengthPosition(0), streamBufferPosition(0), moviSizePosition(0), moviStartPosition(0)
+{
+}
+
+
+MjpegAviWriter::~MjpegAviWriter()
+{
+	close();
+}
+
+
+void MjpegAviWriter::writeFourcc(const char* fourcc)
+{
+	std::fwrite(fourcc, 1, 4, file);
+	fileSize += 4;
+}
+
+
+void MjpegAviWriter::writeUint32(std::uint32_t value)
+{
+	// AVI is little endian no matter what machine writes it.
+	unsigned char bytes[4] = { (unsigned char) value, (unsigned char) (value >> 8),
+	                           (unsigned char) (value >> 16), (unsigned char) (value >> 24) };
+	std::fwrite(bytes, 1, 4, file);
+	fileSize += 4;
+}
+
+
+void MjpegAviWriter::writeUint16(std::uint16_t value)
+{
+	unsigned char bytes[2] = { (unsigned char) value, (unsigned char) (value >> 8) };
+	std::fwrite(bytes, 1, 2, file);
+	fileSize += 2;
+}
+
+
+bool MjpegAviWriter::patchUint32(long position, std::uint32_t value)
+{
+	unsigned char bytes[4] = { (unsigned char) value, (unsigned char) (value >> 8),
+	                           (unsigned char) (value >> 16), (unsigned char) (value >> 24) };
+	return std::fseek(file, position, SEEK_SET) == 0 && std::fwrite(bytes, 1, 4, file) == 4;
+}
+
+
+bool MjpegAviWriter::open(const std::string& fileName, int width, int height, double fps)
+{
+	close();
+
+	file = std::fopen(fileName.c_str(), "wb");
+	if(file == nullptr)
+	{
+		syslog(log_facility | LOG_ERR, "Could not create the video %s : %m", fileName.c_str());
+		return false;
+	}
+	this->fileName = fileName;
+	index.clear();
+	fileSize = 0;
+	largestFrame = 0;
+	frameRate = 0;
+
+	if(fps <= 0)
+	{
+		fps = 10;
+	}
+	std::uint32_t microSecondsPerFrame = (std::uint32_t) std::lround(1000000.0 / fps);
+	std::uint32_t rate = (std::uint32_t) std::lround(fps * RATE_SCALE);
+
+	writeFourcc("RIFF");
+	riffSizePosition = (long) fileSize;
+	writeUint32(0);
+	writeFourcc("AVI ");
+
+	writeFourcc("LIST");
+	// hdrl = "hdrl" + avih chunk (8 + 56) + strl list (12 + strh chunk (8 + 56) + strf chunk (8 + 40))
+	writeUint32(4 + 64 + 12 + 64 + 48);
+	writeFourcc("hdrl");
+
+	writeFourcc("avih");
+	writeUint32(56);
+	microSecondsPerFramePosition = (long) fileSize;
+	writeUint32(microSecondsPerFrame);
+	writeUint32(0);                  // max bytes per second
+	writeUint32(0);                  // padding granularity
+	writeUint32(AVIF_HASINDEX);
+	totalFramesPosition = (long) fileSize;
+	writeUint32(0);                  // total frames
+	writeUint32(0);                  // initial frames
+	writeUint32(1);                  // streams
+	suggestedBufferPosition = (long) fileSize;
+	writeUint32(0);                  // suggested buffer size
+	writeUint32((std::uint32_t) width);
+	writeUint32((std::uint32_t) height);
+	for(int i = 0; i < 4; i++)
+	{
+		writeUint32(0);              // reserved
+	}
+
+	writeFourcc("LIST");
+	writeUint32(4 + 64 + 48);
+	writeFourcc("strl");
+
+	writeFourcc("strh");
+	writeUint32(56);
+	writeFourcc("vids");
+	writeFourcc("MJPG");
+	writeUint32(0);                  // flags
+	writeUint16(0);                  // priority
+	writeUint16(0);                  // language
+	writeUint32(0);                  // initial frames
+	writeUint32(RATE_SCALE);
+	ratePosition = (long) fileSize;
+	writeUint32(rate);
+	writeUint32(0);                  // start
+	streamLengthPosition = (long) fileSize;
+	writeUint32(0);                  // length in frames
+	streamBufferPosition = (long) fileSize;
+	writeUint32(0);                  // suggested buffer size
+	writeUint32(0xFFFFFFFF);         // quality, -1 is the default
+	writeUint32(0);                  // sample size, 0 means it varies
+	writeUint16(0);                  // frame rectangle
+	writeUint16(0);
+	writeUint16((std::uint16_t) width);
+	writeUint16((std::uint16_t) height);
+
+	writeFourcc("strf");
+	writeUint32(40);
+	writeUint32(40);                 // BITMAPINFOHEADER size
+	writeUint32((std::uint32_t) width);
+	writeUint32((std::uint32_t) height);
+	writeUint16(1);                  // planes
+	writeUint16(24);                 // bits per pixel
+	writeFourcc("MJPG");
+	writeUint32((std::uint32_t) (width * height * 3));
+	for(int i = 0; i < 4; i++)
+	{
+		writeUint32(0);              // resolution and palette
+	}
+
+	writeFourcc("LIST");
+	moviSizePosition = (long) fileSize;
+	writeUint32(0);
+	moviStartPosition = (long) fileSize;
+	writeFourcc("movi");
+
+	return !std::ferror(file);
+}
+
+
+bool MjpegAviWriter::writeJpeg(const unsigned char* data, std::size_t size)
+{
+	if(file == nullptr)
+	{
+		return false;
+	}
+
+	IndexEntry entry;
+	entry.offset = (std::uint32_t) (fileSize - moviStartPosition);
+	entry.size = (std::uint32_t) size;
+	index.push_back(entry);
+	if(entry.size > largestFrame)
+	{
+		largestFrame = entry.size;
+	}
+
+	writeFourcc("00dc");
+	writeUint32(entry.size);
+	std::fwrite(data, 1, size, file);
+	fileSize += size;
+	// Chunks always start on an even offset.
+	if(size % 2 == 1)
+	{
+		std::fputc(0, file);
+		fileSize++;
+	}
+
+	return !std::ferror(file);
+}
+
+
+void MjpegAviWriter::setFrameRate(double fps)
+{
+	frameRate = fps;
+}
+
+
+bool MjpegAviWriter::close()
+{
+	if(file == nullptr)
+	{
+		return true;
+	}
+
+	std::uint32_t moviSize = (std::uint32_t) (fileSize - moviStartPosition);
+
+	writeFourcc("idx1");
+	writeUint32((std::uint32_t) (index.size() * 16));
+	for(const IndexEntry& entry : index)
+	{
+		writeFourcc("00dc");
+		writeUint32(AVIIF_KEYFRAME);  // every Motion JPEG frame is a key frame
+		writeUint32(entry.offset);
+		writeUint32(entry.size);
+	}
+
+	bool indexWritten = !std::ferror(file);
+	if(!indexWritten)
+	{
+		syslog(log_facility | LOG_ERR, "Could not write the index of the video %s", fileName.c_str());
+	}
+
+	// Without these the players don't know how many frames there are or how big they are.
+	std::uint32_t riffSize = (std::uint32_t) (fileSize - 8);
+	bool patched = patchUint32(riffSizePosition, riffSize) &&
+	               patchUint32(totalFramesPosition, (std::uint32_t) index.size()) &&
+	               patchUint32(suggestedBufferPosition, largestFrame + 8) &&
+	               patchUint32(streamLengthPosition, (std::uint32_t) index.size()) &&
+	               patchUint32(streamBufferPosition, largestFrame + 8) &&
+	               patchUint32(moviSizePosition, moviSize);
+	if(patched && frameRate > 0)
+	{
+		patched = patchUint32(microSecondsPerFramePosition, (std::uint32_t) std::lround(1000000.0 / frameRate)) &&
+		          patchUint32(ratePosition, (std::uint32_t) std::lround(frameRate * RATE_SCALE));
+	}
+	if(!patched)
+	{
+		syslog(log_facility | LOG_ERR, "Could not fill in the headers of the video %s : %m", fileName.c_str());
+	}
+
+	bool closed = std::fclose(file) == 0;
+	if(!closed)
+	{
+		syslog(log_facility | LOG_ERR, "Could not finish writing the video %s : %m", fileName.c_str());
+	}
+	file = nullptr;
+	return indexWritten && patched && closed;
+}
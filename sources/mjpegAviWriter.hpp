@@ -0,0 +1,82 @@
+/**
+ * File Name:  mjpegAviWriter.hpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class writes an AVI file with a single Motion JPEG video stream out of frames that are already
+ * JPEG compressed. cv::VideoWriter always wants raw frames and compresses them again, this class just
+ * copies the JPEG payloads into the container, so a frame is never encoded twice.
+ */
+
+#ifndef MJPEGAVIWRITER_HPP
+#define MJPEGAVIWRITER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class MjpegAviWriter
+{
+public:
+	MjpegAviWriter();
+	~MjpegAviWriter();
+	MjpegAviWriter(const MjpegAviWriter&) = delete;
+	MjpegAviWriter& operator=(const MjpegAviWriter&) = delete;
+
+	// Creates the file and writes the headers, they are completed by close().
+	bool open(const std::string& fileName, int width, int height, double fps);
+	bool isOpened() const { return file != nullptr; }
+
+	// Appends one JPEG image as the next frame.
+	bool writeJpeg(const unsigned char* data, std::size_t size);
+
+	// Replaces the frame rate given to open(), for when the real rate is only known once the frames are written.
+	void setFrameRate(double fps);
+
+	// Writes the index, fills in the frame count and the sizes of the headers, and closes the file.
+	// Returns false if the file could not be completed, the error is logged.
+	bool close();
+
+	std::size_t frameCount() const { return index.size(); }
+	// The number of bytes written into the file so far.
+	std::uint64_t bytesWritten() const { return fileSize; }
+
+private:
+	struct IndexEntry
+	{
+		std::uint32_t offset;  // from the "movi" fourcc
+		std::uint32_t size;
+	};
+
+	void writeFourcc(const char* fourcc);
+	void writeUint32(std::uint32_t value);
+	void writeUint16(std::uint16_t value);
+	bool patchUint32(long position, std::uint32_t value);
+
+	std::FILE* file;
+	// Only for the log messages.
+	std::string fileName;
+	std::vector<IndexEntry> index;
+	std::uint64_t fileSize;
+	std::uint32_t largestFrame;
+	// 0 keeps the frame rate that was given to open()
+	double frameRate;
+	// Positions of the fields that are only known once all the frames are written.
+	long riffSizePosition;
+	long microSecondsPerFramePosition;
+	long ratePosition;
+	long totalFramesPosition;
+	long suggestedBufferPosition;
+	long streamLengthPosition;
+	long streamBufferPosition;
+	long moviSizePosition;
+	long moviStartPosition;
+};
+
+#endif
@@ -0,0 +1,522 @@
+/**
+ * File Name:  mjpegServer.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class serves the live stream of a camera over HTTP, as multipart/x-mixed-replace MJPEG
+ * that a browser, VLC or curl can show. It runs on it's own thread with an epoll loop.
+ * Every frame is encoded once and the same JPEG is sent to all of the clients. Each client has a short
+ * queue of frames, a client that can't keep up loses frames instead of slowing down the camera.
+ * GET /metrics gives the number of clients, the bytes sent and how many frames each client lost.
+ */
+
+#include "mjpegServer.hpp"
+#include <opencv2/imgcodecs.hpp>
+#include <sys/epoll.h>    /* for epoll_create1(), epoll_ctl(), epoll_wait() */
+#include <sys/eventfd.h>  /* for eventfd() */
+#include <sys/socket.h>   /* for socket(), bind(), listen(), accept4(), send(), recv() */
+#include <netinet/in.h>   /* for sockaddr_in */
+#include <arpa/inet.h>    /* for inet_pton(), inet_ntop() */
+#include <unistd.h>       /* for close(), read(), write() */
+#include <syslog.h>       /* for syslog() */
+#include <errno.h>        /* for errno */
+#include <cstdio>         /* for snprintf() */
+#include <sstream>
+#include <utility>        /* for std::swap() */
+
+#define log_facility LOG_LOCAL0
+
+// The longest request that is read, the rest of a longer one is ignored.
+static const std::size_t MaxRequest = 8192;
+static const char Boundary[] = "frame";
+// The socket buffer of a client, about a frame or two.
+static const int SendBuffer = 256 * 1024;
+
+
+MjpegServer::MjpegServer(int cameraNumber, const std::string& address, int port, int jpegQuality, std::size_t clientQueue)
+ : cameraNumber(cameraNumber), address(address), port(port), clientQueue(clientQueue > 0 ? clientQueue : 1),
+   jpegParameters{ cv::IMWRITE_JPEG_QUALITY, jpegQuality }, listenFd(-1), wakeFd(-1), epollFd(-1), stopping(false),
+   framePending(false), framesEncoded(0), bytesSent(0), clientsServed(0), streamingClients(0)
+{
+}
+
+
+MjpegServer::~MjpegServer()
+{
+	stop();
+}
+
+
+bool MjpegServer::start()
+{
+	sockaddr_in socketAddress = {};
+	socketAddress.sin_family = AF_INET;
+	socketAddress.sin_port = htons(port);
+	if(inet_pton(AF_INET, address.c_str(), &socketAddress.sin_addr) != 1)
+	{
+		syslog(log_facility | LOG_ERR, "Camera %d: %s is not an IP address, the HTTP live stream is off",
+		       cameraNumber, address.c_str());
+		return false;
+	}
+
+	listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	int reuse = 1;
+	if(listenFd == -1 || setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == -1 ||
+	   bind(listenFd, (sockaddr*) &socketAddress, sizeof(socketAddress)) == -1 || listen(listenFd, 16) == -1)
+	{
+		syslog(log_facility | LOG_ERR, "Camera %d could not listen on %s:%d, the HTTP live stream is off: %m",
+		       cameraNumber, address.c_str(), port);
+		stop();
+		return false;
+	}
+
+	wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	epollFd = epoll_create1(EPOLL_CLOEXEC);
+	epoll_event listenEvent = {};
+	listenEvent.events = EPOLLIN;
+	listenEvent.data.fd = listenFd;
+	epoll_event wakeEvent = {};
+	wakeEvent.events = EPOLLIN;
+	wakeEvent.data.fd = wakeFd;
+	if(wakeFd == -1 || epollFd == -1 || epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &listenEvent) == -1 ||
+	   epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &wakeEvent) == -1)
+	{
+		syslog(log_facility | LOG_ERR, "Camera %d could not start the HTTP live stream: %m", cameraNumber);
+		stop();
+		return false;
+	}
+
+	stopping = false;
+	serverThread = std::thread(&MjpegServer::serve, this);
+	syslog(log_facility | LOG_NOTICE, "Camera %d streams MJPEG on http://%s:%d/", cameraNumber, address.c_str(), port);
+	return true;
+}
+
+
+void MjpegServer::stop()
+{
+	if(serverThread.joinable())
+	{
+		stopping = true;
+		std::uint64_t one = 1;
+		if(write(wakeFd, &one, sizeof(one)) == -1)
+		{
+			// It can only fail if the counter is full, then the server thread is woken up anyway.
+		}
+		serverThread.join();
+	}
+	for(auto& client : clients)
+	{
+		close(client.first);
+	}
+	clients.clear();
+	streamingClients = 0;
+	for(int* fd : { &listenFd, &wakeFd, &epollFd })
+	{
+		if(*fd != -1)
+		{
+			close(*fd);
+			*fd = -1;
+		}
+	}
+}
+
+
+void MjpegServer::publish(const cv::Mat& frame)
+{
+	if(streamingClients.load(std::memory_order_relaxed) == 0 || frame.empty())
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> guard(frameMutex);
+		// copyTo() reuses the buffer of the frame the server thread didn't take yet.
+		frame.copyTo(pendingFrame);
+		framePending = true;
+	}
+	std::uint64_t one = 1;
+	if(write(wakeFd, &one, sizeof(one)) == -1)
+	{
+		// The counter is full, the server thread is woken up anyway.
+	}
+}
+
+
+void MjpegServer::serve()
+{
+	epoll_event events[32];
+	while(!stopping)
+	{
+		int count = epoll_wait(epollFd, events, 32, -1);
+		if(count == -1)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			syslog(log_facility | LOG_ERR, "Camera %d: the HTTP live stream stopped: %m", cameraNumber);
+			return;
+		}
+
+		for(int i = 0; i < count; i++)
+		{
+			int fd = events[i].data.fd;
+			if(fd == listenFd)
+			{
+				acceptClients();
+			}
+			else if(fd == wakeFd)
+			{
+				std::uint64_t wakeups;
+				if(read(wakeFd, &wakeups, sizeof(wakeups)) == sizeof(wakeups) && !stopping)
+				{
+					encodeFrame();
+				}
+			}
+			else
+			{
+				auto client = clients.find(fd);
+				if(client == clients.end())
+				{
+					continue;
+				}
+				bool keep = true;
+				if(events[i].events & (EPOLLHUP | EPOLLERR))
+				{
+					keep = false;
+				}
+				else
+				{
+					if(keep && (events[i].events & EPOLLIN))
+					{
+						keep = readRequest(fd, client->second);
+					}
+					if(keep && (events[i].events & EPOLLOUT))
+					{
+						keep = sendQueued(fd, client->second);
+					}
+				}
+				if(!keep)
+				{
+					closeClient(fd);
+				}
+			}
+		}
+	}
+}
+
+
+void MjpegServer::acceptClients()
+{
+	while(true)
+	{
+		sockaddr_in clientAddress = {};
+		socklen_t addressLength = sizeof(clientAddress);
+		int fd = accept4(listenFd, (sockaddr*) &clientAddress, &addressLength, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if(fd == -1)
+		{
+			if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			{
+				syslog(log_facility | LOG_WARNING, "Camera %d could not accept an HTTP client: %m", cameraNumber);
+			}
+			return;
+		}
+
+		// The kernel would otherwise buffer megabytes for a slow client, seconds behind the camera,
+		// before the frames are dropped here.
+		int sendBuffer = SendBuffer;
+		setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+
+		epoll_event event = {};
+		event.events = EPOLLIN;
+		event.data.fd = fd;
+		if(epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == -1)
+		{
+			close(fd);
+			continue;
+		}
+
+		char ip[INET_ADDRSTRLEN] = "?";
+		inet_ntop(AF_INET, &clientAddress.sin_addr, ip, sizeof(ip));
+		Client& client = clients[fd];
+		client = Client();
+		client.address = std::string(ip) + ":" + std::to_string(ntohs(clientAddress.sin_port));
+		client.streaming = false;
+		client.closeWhenSent = false;
+		client.waitingToSend = false;
+		client.offset = 0;
+		client.framesSent = 0;
+		client.framesDropped = 0;
+		client.bytesSent = 0;
+	}
+}
+
+
+bool MjpegServer::readRequest(int fd, Client& client)
+{
+	char buffer[1024];
+	while(true)
+	{
+		ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+		if(received == 0)
+		{
+			return false;
+		}
+		if(received == -1)
+		{
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+		}
+		// Once the request is answered, whatever else the client sends is ignored.
+		if(!client.streaming && !client.closeWhenSent && client.request.size() < MaxRequest)
+		{
+			client.request.append(buffer, received);
+		}
+		else
+		{
+			continue;
+		}
+
+		if(client.request.find("\r\n\r\n") == std::string::npos)
+		{
+			if(client.request.size() >= MaxRequest)
+			{
+				respond(client, "431 Request Header Fields Too Large", "", "");
+				return sendQueued(fd, client);
+			}
+			continue;
+		}
+
+		// Only the request line matters, like "GET /metrics HTTP/1.1".
+		std::istringstream requestLine(client.request.substr(0, client.request.find("\r\n")));
+		std::string method, path;
+		requestLine >> method >> path;
+		path = path.substr(0, path.find('?'));
+		if(method != "GET")
+		{
+			respond(client, "405 Method Not Allowed", "Allow: GET\r\n", "");
+		}
+		else if(path == "/" || path == "/stream")
+		{
+			respond(client, "200 OK",
+			        std::string("Content-Type: multipart/x-mixed-replace; boundary=") + Boundary + "\r\n"
+			        "Cache-Control: no-cache, no-store\r\nPragma: no-cache\r\n", "");
+			client.closeWhenSent = false;
+			client.streaming = true;
+			clientsServed++;
+			streamingClients++;
+			syslog(log_facility | LOG_NOTICE, "Camera %d: HTTP client %s is watching the live stream",
+			       cameraNumber, client.address.c_str());
+		}
+		else if(path == "/metrics")
+		{
+			respond(client, "200 OK", "Content-Type: text/plain; version=0.0.4\r\n", metricsText());
+		}
+		else
+		{
+			respond(client, "404 Not Found", "", "");
+		}
+		return sendQueued(fd, client);
+	}
+}
+
+
+void MjpegServer::respond(Client& client, const std::string& status, const std::string& headers,
+                          const std::string& body)
+{
+	std::string response = "HTTP/1.0 " + status + "\r\n" + headers + "Connection: close\r\n";
+	// The stream goes on until the client leaves, everything else has a length.
+	if(headers.find("multipart") == std::string::npos)
+	{
+		response += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+	}
+	response += "\r\n" + body;
+
+	client.closeWhenSent = true;
+	Chunk chunk;
+	chunk.data = std::make_shared<const std::vector<uchar>>(response.begin(), response.end());
+	chunk.frame = false;
+	client.queue.push_back(std::move(chunk));
+}
+
+
+void MjpegServer::encodeFrame()
+{
+	{
+		std::lock_guard<std::mutex> guard(frameMutex);
+		if(!framePending)
+		{
+			return;
+		}
+		// Both of them keep their buffers, so there is nothing to allocate from frame to frame.
+		std::swap(pendingFrame, encodingFrame);
+		framePending = false;
+	}
+	if(streamingClients == 0)
+	{
+		return;
+	}
+
+	if(!cv::imencode(".jpg", encodingFrame, jpeg, jpegParameters))
+	{
+		syslog(log_facility | LOG_WARNING, "Camera %d could not encode a frame for the HTTP live stream", cameraNumber);
+		return;
+	}
+	framesEncoded++;
+
+	// A part of the multipart response, the boundary, the headers of the part and the JPEG.
+	char partHeader[128];
+	int headerLength = snprintf(partHeader, sizeof(partHeader),
+	                            "--%s\r\nContent-Type: image/jpeg\r\nContent-Length: %zu\r\n\r\n", Boundary, jpeg.size());
+	auto part = std::make_shared<std::vector<uchar>>();
+	part->reserve(headerLength + jpeg.size() + 2);
+	part->insert(part->end(), partHeader, partHeader + headerLength);
+	part->insert(part->end(), jpeg.begin(), jpeg.end());
+	part->push_back('\r');
+	part->push_back('\n');
+	std::shared_ptr<const std::vector<uchar>> frame = std::move(part);
+
+	std::vector<int> gone;
+	for(auto& client : clients)
+	{
+		if(!client.second.streaming)
+		{
+			continue;
+		}
+		queueFrame(client.second, frame);
+		if(!sendQueued(client.first, client.second))
+		{
+			gone.push_back(client.first);
+		}
+	}
+	for(int fd : gone)
+	{
+		closeClient(fd);
+	}
+}
+
+
+void MjpegServer::queueFrame(Client& client, const std::shared_ptr<const std::vector<uchar>>& frame)
+{
+	if(client.queue.size() < clientQueue)
+	{
+		client.queue.push_back({ frame, true });
+		return;
+	}
+	// The client is too slow, the newest waiting frame is replaced so it catches up to the camera.
+	// The front of the queue may already be partly sent, it has to stay.
+	client.framesDropped++;
+	if(client.queue.size() > 1 && client.queue.back().frame)
+	{
+		client.queue.back().data = frame;
+	}
+}
+
+
+bool MjpegServer::sendQueued(int fd, Client& client)
+{
+	while(!client.queue.empty())
+	{
+		const std::vector<uchar>& data = *client.queue.front().data;
+		ssize_t sent = send(fd, data.data() + client.offset, data.size() - client.offset, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if(sent == -1)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			if(errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				return false;
+			}
+			// The socket is full, it is sent when epoll says there is room.
+			if(!client.waitingToSend)
+			{
+				epoll_event event = {};
+				event.events = EPOLLIN | EPOLLOUT;
+				event.data.fd = fd;
+				epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+				client.waitingToSend = true;
+			}
+			return true;
+		}
+
+		client.offset += sent;
+		client.bytesSent += sent;
+		bytesSent += sent;
+		if(client.offset == data.size())
+		{
+			if(client.queue.front().frame)
+			{
+				client.framesSent++;
+			}
+			client.queue.pop_front();
+			client.offset = 0;
+		}
+	}
+
+	if(client.waitingToSend)
+	{
+		epoll_event event = {};
+		event.events = EPOLLIN;
+		event.data.fd = fd;
+		epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event);
+		client.waitingToSend = false;
+	}
+	return !(client.closeWhenSent && !client.streaming);
+}
+
+
+void MjpegServer::closeClient(int fd)
+{
+	auto found = clients.find(fd);
+	if(found == clients.end())
+	{
+		return;
+	}
+	const Client& client = found->second;
+	if(client.streaming)
+	{
+		std::uint64_t total = client.framesSent + client.framesDropped;
+		syslog(log_facility | LOG_NOTICE,
+		       "Camera %d: HTTP client %s left after %llu frames (%llu bytes), it dropped %llu of them (%.1f%%)",
+		       cameraNumber, client.address.c_str(), (unsigned long long) client.framesSent,
+		       (unsigned long long) client.bytesSent, (unsigned long long) client.framesDropped,
+		       total > 0 ? 100.0 * client.framesDropped / total : 0.0);
+		streamingClients--;
+	}
+	epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+	close(fd);
+	clients.erase(found);
+}
+
+
+std::string MjpegServer::metricsText() const
+{
+	// The Prometheus text format, it reads fine with curl too.
+	std::ostringstream text;
+	std::string camera = "camera=\"" + std::to_string(cameraNumber) + "\"";
+	text << "smartcctv_http_clients{" << camera << "} " << streamingClients.load() << "\n"
+	     << "smartcctv_http_clients_served_total{" << camera << "} " << clientsServed << "\n"
+	     << "smartcctv_http_frames_encoded_total{" << camera << "} " << framesEncoded << "\n"
+	     << "smartcctv_http_bytes_sent_total{" << camera << "} " << bytesSent << "\n";
+	for(const auto& entry : clients)
+	{
+		const Client& client = entry.second;
+		if(!client.streaming)
+		{
+			continue;
+		}
+		std::string labels = camera + ",client=\"" + client.address + "\"";
+		std::uint64_t total = client.framesSent + client.framesDropped;
+		text << "smartcctv_http_client_bytes_sent_total{" << labels << "} " << client.bytesSent << "\n"
+		     << "smartcctv_http_client_frames_sent_total{" << labels << "} " << client.framesSent << "\n"
+		     << "smartcctv_http_client_frames_dropped_total{" << labels << "} " << client.framesDropped << "\n"
+		     << "smartcctv_http_client_drop_ratio{" << labels << "} "
+		     << (total > 0 ? (double) client.framesDropped / total : 0.0) << "\n";
+	}
+	return text.str();
+}
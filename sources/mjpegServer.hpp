@@ -0,0 +1,121 @@
+/**
+ * File Name:  mjpegServer.hpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class serves the live stream of a camera over HTTP, as multipart/x-mixed-replace MJPEG
+ * that a browser, VLC or curl can show. It runs on it's own thread with an epoll loop.
+ * Every frame is encoded once and the same JPEG is sent to all of the clients. Each client has a short
+ * queue of frames, a client that can't keep up loses frames instead of slowing down the camera.
+ * GET /metrics gives the number of clients, the bytes sent and how many frames each client lost.
+ * Each instance of this class is to correspond to a single camera or video file.
+ */
+
+#ifndef MJPEGSERVER_HPP
+#define MJPEGSERVER_HPP
+
+#include <opencv2/core.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class MjpegServer
+{
+public:
+	// address is the IP address to listen on, 127.0.0.1 for this computer only or 0.0.0.0 for the LAN.
+	// clientQueue is how many frames may wait for a client before it's frames are dropped.
+	MjpegServer(int cameraNumber, const std::string& address, int port, int jpegQuality, std::size_t clientQueue);
+	~MjpegServer();
+	MjpegServer(const MjpegServer&) = delete;
+	MjpegServer& operator=(const MjpegServer&) = delete;
+
+	// Starts listening and the server thread, returns false if the port can't be used.
+	bool start();
+	// Disconnects the clients and stops the server thread.
+	void stop();
+
+	// Hands a BGR frame to the server thread, which encodes it once for all of the clients.
+	// This costs nothing while there are no clients. If the server thread didn't get to the last frame yet,
+	// it gets this one instead, the camera never waits for it.
+	void publish(const cv::Mat& frame);
+
+private:
+	// A piece of what is sent to a client, shared by all of the clients it is sent to.
+	struct Chunk
+	{
+		std::shared_ptr<const std::vector<uchar>> data;
+		bool frame;
+	};
+
+	struct Client
+	{
+		std::string address;
+		// The request, until the empty line at the end of it.
+		std::string request;
+		bool streaming;
+		// The metrics and the errors are one response, the connection is closed after it is sent.
+		bool closeWhenSent;
+		// Waiting for EPOLLOUT.
+		bool waitingToSend;
+		std::deque<Chunk> queue;
+		// How much of queue.front() is already sent.
+		std::size_t offset;
+		std::uint64_t framesSent;
+		std::uint64_t framesDropped;
+		std::uint64_t bytesSent;
+	};
+
+	void serve();
+	void acceptClients();
+	// Returns false if the client went away.
+	bool readRequest(int fd, Client& client);
+	void respond(Client& client, const std::string& status, const std::string& headers, const std::string& body);
+	void encodeFrame();
+	void queueFrame(Client& client, const std::shared_ptr<const std::vector<uchar>>& frame);
+	// Sends as much as the socket takes without waiting, returns false if the client went away or is done.
+	bool sendQueued(int fd, Client& client);
+	void closeClient(int fd);
+	std::string metricsText() const;
+
+	const int cameraNumber;
+	const std::string address;
+	const int port;
+	const std::size_t clientQueue;
+	std::vector<int> jpegParameters;
+
+	int listenFd;
+	// Written by publish() and stop() to wake up the server thread.
+	int wakeFd;
+	int epollFd;
+	std::thread serverThread;
+	std::atomic<bool> stopping;
+
+	// The newest frame from publish(), waiting for the server thread.
+	std::mutex frameMutex;
+	cv::Mat pendingFrame;
+	bool framePending;
+
+	// Only touched by the server thread.
+	std::map<int, Client> clients;
+	cv::Mat encodingFrame;
+	std::vector<uchar> jpeg;
+	std::uint64_t framesEncoded;
+	std::uint64_t bytesSent;
+	std::uint64_t clientsServed;
+
+	// The clients that are watching the stream, publish() skips the copy when there are none.
+	std::atomic<std::size_t> streamingClients;
+};
+
+#endif
@@ -0,0 +1,112 @@
+/**
+ * File Name:  motionBenchmark.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This program compares the motion_algorithm settings on the frames of a video. It prints the time
+ * each one takes per frame, including making the blurred frame it compares, on how many frames it saw motion,
+ * and on how many frames it agrees with the contours algorithm about whether something moved.
+ * The background models (average and mog2) should see motion on fewer frames of a scene with flickering light.
+ * It is built with "make benchmark" and is not part of SmartCCTV itself.
+ *
+ * Usage:  motionBenchmark video [frames]
+ */
+
+#include "motionFilter.hpp"
+#include "motionKernel.hpp"
+#include "frameContext.hpp"
+#include <opencv2/videoio.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+
+
+// Runs the motion detection over all of the frames, returns the seconds it took and whether each frame moved.
+static double runMotion(MotionAlgorithm algorithm, std::vector<cv::Mat>& frames, std::vector<bool>& moved)
+{
+	// With the human detection on, every algorithm has to find all of the moving areas and not just the first one.
+	const DetectionConfig config = { 0, true, true, false, 0, 25 };
+	MotionFilter motionFilter(algorithm);
+	FrameContext context;
+	moved.clear();
+	auto begin = std::chrono::steady_clock::now();
+	for(cv::Mat& frame : frames)
+	{
+		context.reset(frame);
+		moved.push_back(motionFilter.runDetection(context, config));
+	}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+
+int main(int argc, char* argv[])
+{
+	if(argc < 2)
+	{
+		std::fprintf(stderr, "Usage: %s video [frames]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	int maxFrames = argc > 2 ? std::atoi(argv[2]) : 300;
+
+	std::vector<cv::Mat> frames;
+	cv::VideoCapture video(argv[1]);
+	cv::Mat frame;
+	while((int) frames.size() < maxFrames && video.read(frame))
+	{
+		frames.push_back(frame.clone());
+	}
+	if(frames.size() < 2)
+	{
+		std::fprintf(stderr, "Could not read at least 2 frames from %s\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	struct Algorithm
+	{
+		const char* name;
+		MotionAlgorithm algorithm;
+	};
+	const Algorithm algorithms[] = {
+		{ "contours", MotionAlgorithm::Contours },
+		{ "fused", MotionAlgorithm::Fused },
+		{ "average", MotionAlgorithm::RunningAverage },
+		{ "mog2", MotionAlgorithm::Mog2 }
+	};
+
+	std::printf("%zu frames of %dx%d, the fused algorithm uses %s\n", frames.size(), frames[0].cols, frames[0].rows,
+	            MotionKernel::instructionSet());
+	// The daemon falls back to the scalar code by itself, but a wrong SIMD kernel is a bug worth seeing here.
+	if(!MotionKernel::simdMatchesScalar())
+	{
+		std::printf("The SIMD code of this processor does not count like the scalar code, the scalar code is used\n");
+	}
+	std::printf("%10s %12s %8s %14s %10s\n", "algorithm", "ms/frame", "speedup", "motion frames", "agreement");
+	std::vector<bool> reference, moved;
+	double referenceSeconds = 0;
+	for(const Algorithm& algorithm : algorithms)
+	{
+		double seconds = runMotion(algorithm.algorithm, frames, moved);
+		if(algorithm.algorithm == MotionAlgorithm::Contours)
+		{
+			reference = moved;
+			referenceSeconds = seconds;
+		}
+
+		std::size_t agreed = 0, motionFrames = 0;
+		for(std::size_t i = 0; i < frames.size(); i++)
+		{
+			agreed += reference[i] == moved[i] ? 1 : 0;
+			motionFrames += moved[i] ? 1 : 0;
+		}
+		std::printf("%10s %12.3f %7.2fx %14zu %9.1f%%\n", algorithm.name, 1000 * seconds / frames.size(),
+		            referenceSeconds / seconds, motionFrames, 100.0 * agreed / frames.size());
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -10,7 +10,6 @@
  * This class is used to run motion detection on a Mat object, searching for differences between consecutive frames. 
  * Each instance of this class is to correspond to a single camera or video file.
  */
-#include "low_level_cctv_daemon_apis.h"
 #include <opencv2/opencv.hpp>
 #include <opencv2/tracking.hpp>
 #include <opencv2/core/ocl.hpp>
@@ -19,21 +18,20 @@
 #include <syslog.h>  /* for syslog() */
 #define log_facility LOG_LOCAL0
 
-extern Daemon_data daemon_data;
-
-MotionFilter::MotionFilter()
+// A pixel moved if it changed by more than 25, the threshold the contours have always used, until the detection settings change it.
+// 2 changed pixels of the half size frame are 8 pixels of the full frame, a single noisy pixel is not motion.
+MotionFilter::MotionFilter(MotionAlgorithm algorithm, double learningRate, ZoneMask* zones)
+ : algorithm(algorithm), learningRate(learningRate), zones(zones), kernel(25, 2), score(0), lastMoved(false)
 {
 	initialized = false;
+	if(algorithm == MotionAlgorithm::Mog2)
+	{
+		// Without shadow detection the mask only has 0 and 255, a shadow moves with a person anyway.
+		subtractor = cv::createBackgroundSubtractorMOG2(500, 16, false);
+	}
 }
 
-//Prepares the frame for motion detection analysis
-void MotionFilter::convertFrame(cv::Mat &frame)
-{
-	cv::cvtColor(frame, frame, cv::COLOR_BGR2GRAY);
-    cv::GaussianBlur(frame, frame, cv::Size(21, 21), 0);
-}
-
-bool MotionFilter::differentFrames(cv::Mat oldFrame, cv::Mat newFrame)
+bool MotionFilter::differentFrames(const cv::Mat &oldFrame, const cv::Mat &newFrame, int pixelThreshold)
 {
 	cv::Mat frameDifference, frameThreshold;
     std::vector<std::vector<cv::Point>> contours;
@@ -44,19 +42,75 @@ bool MotionFilter::differentFrames(cv::Mat oldFrame, cv::Mat newFrame)
 	* a contour's area is used to determine the scale of the motion
 	**/
 	cv::absdiff(oldFrame, newFrame, frameDifference);
-	cv::threshold(frameDifference, frameThreshold, 25.0, 255.0, cv::THRESH_BINARY);
+	cv::threshold(frameDifference, frameThreshold, pixelThreshold, 255.0, cv::THRESH_BINARY);
+	if(zones != nullptr && !zones->empty())
+	{
+		cv::bitwise_and(frameThreshold, zones->pixels(frameThreshold.size()), frameThreshold);
+	}
+	score = cv::countNonZero(frameThreshold);
 	cv::dilate(frameThreshold, frameThreshold, cv::Mat(), cv::Point(-1,-1), 2);
 	cv::findContours(frameThreshold, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
 
+	// Every area that moved is kept, so the detectors can look at just those areas.
+	motionAreas.clear();
 	for(size_t i = 0; i< contours.size(); i++) 
 	{
 		if(cv::contourArea(contours[i]) > 10)
 		{
-			return true;
+			motionAreas.push_back(cv::boundingRect(contours[i]));
 		}
 	}
 			
-	return false;
+	return !motionAreas.empty();
+}
+
+const unsigned short* MotionFilter::kernelMask(cv::Size size)
+{
+	if(zones == nullptr || zones->empty())
+	{
+		return nullptr;
+	}
+	return zones->packed(size).data();
+}
+
+bool MotionFilter::kernelMotion()
+{
+	kernel.changedRegions(motionAreas);
+	// Back from the half size frame to the full frame. The half size of an odd width or height is rounded up,
+	// so a region at the right or bottom edge can end one pixel past the frame.
+	for(cv::Rect &area : motionAreas)
+	{
+		area = cv::Rect(area.x * 2, area.y * 2, area.width * 2, area.height * 2) & frameArea;
+	}
+	return kernel.motion();
+}
+
+bool MotionFilter::fusedDifferentFrames(const cv::Mat &oldFrame, const cv::Mat &newFrame, bool stopAtMotion)
+{
+	score = kernel.compare(oldFrame, newFrame, stopAtMotion, kernelMask(newFrame.size()));
+	return kernelMotion();
+}
+
+bool MotionFilter::differentFromBackground(const cv::Mat &newFrame, bool stopAtMotion)
+{
+	if(algorithm == MotionAlgorithm::RunningAverage)
+	{
+		// The frame is compared before it is blended in, or a moving person would partly be background already.
+		background.convertTo(backgroundImage, CV_8U);
+		score = kernel.compare(backgroundImage, newFrame, stopAtMotion, kernelMask(newFrame.size()));
+		cv::accumulateWeighted(newFrame, background, learningRate);
+		return kernelMotion();
+	}
+
+	subtractor->apply(newFrame, foreground, learningRate);
+	// The mask is 255 where the background model doesn't explain the pixel and 0 elsewhere,
+	// so comparing it to an empty mask counts the foreground pixels of every tile.
+	if(emptyMask.size() != foreground.size())
+	{
+		emptyMask = cv::Mat::zeros(foreground.size(), CV_8UC1);
+	}
+	score = kernel.compare(emptyMask, foreground, stopAtMotion, kernelMask(foreground.size()));
+	return kernelMotion();
 }
 
 std::string MotionFilter::putFrameInfo(cv::Mat frame, std::string outPut)
@@ -73,34 +127,70 @@ std::string MotionFilter::putFrameInfo(cv::Mat frame, std::string outPut)
 	return outPut;
 }
 
-bool MotionFilter::runDetection(cv::Mat &frame)
+bool MotionFilter::runDetection(FrameContext &context, const DetectionConfig &config)
 {
-	cv::Mat newFrame = frame.clone();
-	convertFrame(newFrame);
+	// The blurred grayscale frame is shared with the other filters, the frame itself is not copied.
+	const cv::Mat &newFrame = algorithm == MotionAlgorithm::Contours ? context.blurred() : context.halfBlurred();
+	frameArea = cv::Rect(0, 0, context.frame().cols, context.frame().rows);
+	// A camera or media file that changes it's resolution starts the model over, like the first frame.
+	if(initialized && newFrame.size() != modelSize)
+	{
+		initialized = false;
+	}
 	//Algorithm skips the first frame
 	if(!initialized)
 	{
-		oldFrame = newFrame;
+		if(algorithm == MotionAlgorithm::RunningAverage)
+		{
+			newFrame.convertTo(background, CV_32F);
+		}
+		else if(algorithm == MotionAlgorithm::Mog2)
+		{
+			// A learning rate of 1 starts the model over from this frame.
+			subtractor->apply(newFrame, foreground, 1);
+		}
+		else
+		{
+			// The context reuses it's images on the next frame, so the old frame has to be a copy.
+			newFrame.copyTo(oldFrame);
+		}
 		initialized = true;
+		modelSize = newFrame.size();
+		motionAreas.clear();
 		return false;
 	}
 	
 	//putText(frame, putFrameInfo(frame, "Rcv Frame: "), cv::Point(10, 20), cv::FONT_HERSHEY_SIMPLEX, 0.75, cv::Scalar(0,0,255),2);
 	//putText(frame, putFrameInfo(newFrame, "New Frame: "), cv::Point(10, 40), cv::FONT_HERSHEY_SIMPLEX, 0.75, cv::Scalar(0,0,255),2);
 	//putText(frame, putFrameInfo(oldFrame, "Old Frame: "), cv::Point(10, 60), cv::FONT_HERSHEY_SIMPLEX, 0.75, cv::Scalar(0,0,255),2);
-	if(differentFrames(oldFrame, newFrame))
+	// The threshold can change between two frames, a changed threshold is used from this frame on.
+	if(kernel.threshold() != config.motionThreshold)
 	{
-		oldFrame = newFrame;
-		if(daemon_data.enable_outlines)
-		{
-			putText(frame, "+", cv::Point(12, 24), cv::FONT_HERSHEY_SIMPLEX, 0.75, cv::Scalar(0,0,255),2);
-		}
-		return true;
+		kernel.setPixelThreshold(config.motionThreshold);
 	}
-	oldFrame = newFrame;
-	if(daemon_data.enable_outlines)
+	// Only the detectors need to know where the motion is, without them the first moving tile is enough.
+	bool stopAtMotion = !config.humanDetection;
+	bool moved;
+	switch(algorithm)
 	{
-		putText(frame, "-", cv::Point(12, 24), cv::FONT_HERSHEY_SIMPLEX, 0.75, cv::Scalar(0,0,255),2);
+		case MotionAlgorithm::Contours:
+			moved = differentFrames(oldFrame, newFrame, config.motionThreshold);
+			newFrame.copyTo(oldFrame);
+			break;
+		case MotionAlgorithm::Fused:
+			moved = fusedDifferentFrames(oldFrame, newFrame, stopAtMotion);
+			newFrame.copyTo(oldFrame);
+			break;
+		default:
+			moved = differentFromBackground(newFrame, stopAtMotion);
+			break;
 	}
-	return false;
+
+	lastMoved = moved;
+	return moved;
+}
+
+void MotionFilter::drawOverlay(cv::Mat &frame) const
+{
+	putText(frame, lastMoved ? "+" : "-", cv::Point(12, 24), cv::FONT_HERSHEY_SIMPLEX, 0.75, cv::Scalar(0,0,255),2);
 }
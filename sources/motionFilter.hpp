@@ -18,17 +18,58 @@
 #include <opencv2/tracking.hpp>
 #include <opencv2/core/ocl.hpp>
 #include <unistd.h>
+#include "frameContext.hpp"
+#include "motionKernel.hpp"
+#include "cameraSettings.hpp"
+#include "detectionConfig.hpp"
+#include "zoneMask.hpp"
 
 class MotionFilter
 {
 private:
 	cv::Mat oldFrame;
 	bool initialized;
-	void convertFrame(cv::Mat &frame);
-	bool differentFrames(cv::Mat oldFrame, cv::Mat newFrame);
+	// The size of the frames the model was made from, the model can't be compared with frames of another size.
+	cv::Size modelSize;
+	const MotionAlgorithm algorithm;
+	const double learningRate;
+	// The parts of the frame that are watched, nullptr watches all of it.
+	ZoneMask* const zones;
+	MotionKernel kernel;
+	int score;
+	bool lastMoved;
+	// The background models of RunningAverage and Mog2.
+	cv::Mat background;
+	cv::Mat backgroundImage;
+	cv::Ptr<cv::BackgroundSubtractorMOG2> subtractor;
+	cv::Mat foreground;
+	cv::Mat emptyMask;
+	std::vector<cv::Rect> motionAreas;
+	// The whole full size frame, the scaled back regions are cut to it.
+	cv::Rect frameArea;
+	// MotionAlgorithm::Contours, the reference for fusedDifferentFrames().
+	bool differentFrames(const cv::Mat &oldFrame, const cv::Mat &newFrame, int pixelThreshold);
+	// MotionAlgorithm::Fused, on the half size frames.
+	// With stopAtMotion only the first moving tile is looked for, not all of the areas that moved.
+	bool fusedDifferentFrames(const cv::Mat &oldFrame, const cv::Mat &newFrame, bool stopAtMotion);
+	// MotionAlgorithm::RunningAverage and Mog2, compares the frame to the background and then updates the background.
+	bool differentFromBackground(const cv::Mat &newFrame, bool stopAtMotion);
+	// The regions of the tiles the kernel found, scaled back to the full frame and cut to it.
+	bool kernelMotion();
+	// The packed zone mask for the kernel, or nullptr if every pixel is watched.
+	const unsigned short* kernelMask(cv::Size size);
 	std::string putFrameInfo(cv::Mat frame, std::string outPut);
 public:
-	MotionFilter();
-	bool runDetection(cv::Mat &frame);
+	explicit MotionFilter(MotionAlgorithm algorithm = MotionAlgorithm::Fused, double learningRate = 0.01, ZoneMask* zones = nullptr);
+	// Compares the blurred grayscale of this frame to the last frame or to the background model,
+	// with the threshold and the outlines of config.
+	// The frame is not drawn on, drawOverlay() marks it once the detectors are done with it.
+	bool runDetection(FrameContext &context, const DetectionConfig &config);
+	// Puts a "+" on the frame if the last frame given to runDetection() moved, and a "-" if it didn't.
+	void drawOverlay(cv::Mat &frame) const;
+	// The bounding rectangles of the areas that moved in the last frame given to runDetection().
+	const std::vector<cv::Rect>& motionRegions() const { return motionAreas; }
+	// How many pixels changed in the last frame, in the pixels of the frame the algorithm compares.
+	int motionScore() const { return score; }
 };
 #endif
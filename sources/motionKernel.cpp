@@ -0,0 +1,308 @@
+/**
+ * File Name:  motionKernel.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class compares two blurred grayscale frames in a single pass. For every pixel it takes the difference,
+ * compares it to the threshold and counts the changed pixels per 16x16 tile, 16 or 32 pixels at a time with SSE2 or AVX2,
+ * or one pixel at a time on other processors. It replaces the absdiff, threshold, dilate and findContours passes
+ * of MotionFilter, which the filter still has as the reference to compare against.
+ * Each instance of this class is to correspond to a single camera or video file.
+ */
+
+#include "motionKernel.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+// SSE2 is always there on x86-64. AVX2 is not, so it is compiled for that one function and only used
+// if the processor has it, the daemon itself is still built for any x86-64 processor.
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define MOTION_KERNEL_SSE2
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MOTION_KERNEL_AVX2
+#endif
+#endif
+
+
+// The pixels from..width of a row, one at a time. Also the pixels at the end of a row that don't fill a register.
+static int countChangedPixels(const uchar* oldRow, const uchar* newRow, const unsigned short* maskRow, int from, int width,
+                              uchar threshold, unsigned short* counts)
+{
+	int changed = 0;
+	for(int x = from; x < width; x++)
+	{
+		if(std::abs(oldRow[x] - newRow[x]) > threshold && (maskRow[x / 16] >> (x % 16) & 1))
+		{
+			counts[x / MotionKernel::TileSize]++;
+			changed++;
+		}
+	}
+	return changed;
+}
+
+
+// Also the reference the SIMD kernels are checked against.
+static int scalarRow(const uchar* oldRow, const uchar* newRow, const unsigned short* maskRow, int width,
+                     uchar threshold, unsigned short* counts)
+{
+	return countChangedPixels(oldRow, newRow, maskRow, 0, width, threshold, counts);
+}
+
+
+#ifdef MOTION_KERNEL_SSE2
+// One tile wide, 16 pixels per register.
+static int sse2Row(const uchar* oldRow, const uchar* newRow, const unsigned short* maskRow, int width,
+                   uchar threshold, unsigned short* counts)
+{
+	const __m128i thresholds = _mm_set1_epi8((char) threshold);
+	const __m128i zero = _mm_setzero_si128();
+	int tiles = width / MotionKernel::TileSize;
+	int changed = 0;
+	for(int tile = 0; tile < tiles; tile++)
+	{
+		__m128i oldPixels = _mm_loadu_si128((const __m128i*) (oldRow + tile * MotionKernel::TileSize));
+		__m128i newPixels = _mm_loadu_si128((const __m128i*) (newRow + tile * MotionKernel::TileSize));
+		// |old - new| from the two saturated differences, one of them is always 0.
+		__m128i difference = _mm_or_si128(_mm_subs_epu8(oldPixels, newPixels), _mm_subs_epu8(newPixels, oldPixels));
+		// difference > threshold exactly when difference - threshold doesn't saturate to 0.
+		__m128i unchanged = _mm_cmpeq_epi8(_mm_subs_epu8(difference, thresholds), zero);
+		// One bit per pixel, the same as the words of the mask.
+		int count = __builtin_popcount(~_mm_movemask_epi8(unchanged) & maskRow[tile]);
+		counts[tile] += count;
+		changed += count;
+	}
+	return changed + countChangedPixels(oldRow, newRow, maskRow, tiles * MotionKernel::TileSize, width, threshold, counts);
+}
+#endif
+
+
+#ifdef MOTION_KERNEL_AVX2
+// Two tiles at once, 32 pixels per register, the mask has the first tile in it's low 16 bits.
+__attribute__((target("avx2")))
+static int avx2Row(const uchar* oldRow, const uchar* newRow, const unsigned short* maskRow, int width,
+                   uchar threshold, unsigned short* counts)
+{
+	const __m256i thresholds = _mm256_set1_epi8((char) threshold);
+	const __m256i zero = _mm256_setzero_si256();
+	int pairs = width / (2 * MotionKernel::TileSize);
+	int changed = 0;
+	for(int pair = 0; pair < pairs; pair++)
+	{
+		__m256i oldPixels = _mm256_loadu_si256((const __m256i*) (oldRow + pair * 2 * MotionKernel::TileSize));
+		__m256i newPixels = _mm256_loadu_si256((const __m256i*) (newRow + pair * 2 * MotionKernel::TileSize));
+		__m256i difference = _mm256_or_si256(_mm256_subs_epu8(oldPixels, newPixels), _mm256_subs_epu8(newPixels, oldPixels));
+		__m256i unchanged = _mm256_cmpeq_epi8(_mm256_subs_epu8(difference, thresholds), zero);
+		unsigned int mask = ~(unsigned int) _mm256_movemask_epi8(unchanged);
+		int first = __builtin_popcount(mask & maskRow[2 * pair]);
+		int second = __builtin_popcount((mask >> 16) & maskRow[2 * pair + 1]);
+		counts[2 * pair] += first;
+		counts[2 * pair + 1] += second;
+		changed += first + second;
+	}
+	// At most one more whole tile, and the pixels after it.
+	int done = pairs * 2 * MotionKernel::TileSize;
+	return changed + sse2Row(oldRow + done, newRow + done, maskRow + 2 * pairs, width - done, threshold, counts + 2 * pairs);
+}
+#endif
+
+
+MotionKernel::RowKernel MotionKernel::fastestRowKernel()
+{
+#ifdef MOTION_KERNEL_AVX2
+	if(__builtin_cpu_supports("avx2"))
+	{
+		return avx2Row;
+	}
+#endif
+#ifdef MOTION_KERNEL_SSE2
+	return sse2Row;
+#else
+	return scalarRow;
+#endif
+}
+
+
+bool MotionKernel::matchesScalar(RowKernel kernel)
+{
+	// Every width up to two AVX2 registers, one more tile and a few pixels, so the whole registers,
+	// the single tile after them and the pixels at the end of a row are all covered.
+	const int maxWidth = 5 * TileSize + 7;
+	const int maxTiles = (maxWidth + TileSize - 1) / TileSize;
+	const uchar thresholds[] = { 0, 1, 25, 128, 254, 255 };
+	std::vector<uchar> oldRow(maxWidth), newRow(maxWidth);
+	std::vector<unsigned short> maskRow(maxTiles), expected(maxTiles), counts(maxTiles);
+	// A fixed sequence, so a failure is the same on every run.
+	unsigned int seed = 12345;
+	auto next = [&seed]() { seed = seed * 1103515245 + 12345; return seed >> 16; };
+	for(int width = 1; width <= maxWidth; width++)
+	{
+		for(uchar threshold : thresholds)
+		{
+			for(int x = 0; x < maxWidth; x++)
+			{
+				oldRow[x] = (uchar) next();
+				// Differences right at the threshold are the ones a wrong comparison gets wrong.
+				newRow[x] = next() % 2 ? (uchar) std::min(255, oldRow[x] + threshold + (int) (next() % 3) - 1) : (uchar) next();
+			}
+			for(unsigned short& word : maskRow)
+			{
+				word = next() % 4 == 0 ? (unsigned short) next() : 0xFFFF;
+			}
+			std::fill(expected.begin(), expected.end(), 0);
+			std::fill(counts.begin(), counts.end(), 0);
+			int expectedChanged = scalarRow(oldRow.data(), newRow.data(), maskRow.data(), width, threshold, expected.data());
+			int changed = kernel(oldRow.data(), newRow.data(), maskRow.data(), width, threshold, counts.data());
+			if(changed != expectedChanged || counts != expected)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+
+bool MotionKernel::simdMatchesScalar()
+{
+	return matchesScalar(fastestRowKernel());
+}
+
+
+MotionKernel::RowKernel MotionKernel::selectRowKernel()
+{
+	// Checked once for the whole process. A kernel that doesn't count exactly like the scalar loop is never used.
+	static const RowKernel selected = simdMatchesScalar() ? fastestRowKernel() : scalarRow;
+	return selected;
+}
+
+
+const char* MotionKernel::instructionSet()
+{
+	RowKernel kernel = selectRowKernel();
+#ifdef MOTION_KERNEL_AVX2
+	if(kernel == avx2Row)
+	{
+		return "AVX2";
+	}
+#endif
+#ifdef MOTION_KERNEL_SSE2
+	if(kernel == sse2Row)
+	{
+		return "SSE2";
+	}
+#endif
+	return "scalar";
+}
+
+
+MotionKernel::MotionKernel(int pixelThreshold, int tileMinPixels)
+ : pixelThreshold((uchar) std::max(0, std::min(pixelThreshold, 255))), tileMinPixels(std::max(1, tileMinPixels)),
+   rowKernel(selectRowKernel()), tilesX(0), tilesY(0), changedTiles(0)
+{
+}
+
+
+void MotionKernel::setPixelThreshold(int pixelThreshold)
+{
+	this->pixelThreshold = (uchar) std::max(0, std::min(pixelThreshold, 255));
+}
+
+
+int MotionKernel::markTileRow(int tileRow)
+{
+	int changed = 0;
+	for(int i = tileRow * tilesX; i < (tileRow + 1) * tilesX; i++)
+	{
+		if(tileCounts[i] >= tileMinPixels)
+		{
+			tileMap[i] = 1;
+			changed++;
+		}
+	}
+	return changed;
+}
+
+
+int MotionKernel::compare(const cv::Mat& oldFrame, const cv::Mat& newFrame, bool stopAtMotion, const unsigned short* mask)
+{
+	frameSize = newFrame.size();
+	tilesX = (frameSize.width + TileSize - 1) / TileSize;
+	tilesY = (frameSize.height + TileSize - 1) / TileSize;
+	tileCounts.assign(tilesX * tilesY, 0);
+	tileMap.assign(tilesX * tilesY, 0);
+	changedTiles = 0;
+	if(oldFrame.size() != newFrame.size() || oldFrame.type() != CV_8UC1 || newFrame.type() != CV_8UC1)
+	{
+		// Nothing to compare, like after the resolution of the camera changed.
+		return 0;
+	}
+
+	// A mask row has a word for every tile of a row, so without a mask the same full row is used for every row.
+	fullMaskRow.assign(tilesX, 0xFFFF);
+	int score = 0;
+	for(int y = 0; y < frameSize.height; y++)
+	{
+		const unsigned short* maskRow = mask != nullptr ? mask + y * tilesX : fullMaskRow.data();
+		score += rowKernel(oldFrame.ptr(y), newFrame.ptr(y), maskRow, frameSize.width, pixelThreshold, &tileCounts[(y / TileSize) * tilesX]);
+		if((y + 1) % TileSize == 0 || y + 1 == frameSize.height)
+		{
+			changedTiles += markTileRow(y / TileSize);
+			if(stopAtMotion && changedTiles > 0)
+			{
+				break;
+			}
+		}
+	}
+	return score;
+}
+
+
+void MotionKernel::changedRegions(std::vector<cv::Rect>& regions) const
+{
+	regions.clear();
+	visitedTiles.assign(tileMap.size(), 0);
+	cv::Rect frameArea(0, 0, frameSize.width, frameSize.height);
+	for(std::size_t start = 0; start < tileMap.size(); start++)
+	{
+		if(!tileMap[start] || visitedTiles[start])
+		{
+			continue;
+		}
+
+		// Walks over every changed tile that touches this one, also across the corners.
+		int minX = tilesX, minY = tilesY, maxX = 0, maxY = 0;
+		visitedTiles[start] = 1;
+		pendingTiles.assign(1, (int) start);
+		while(!pendingTiles.empty())
+		{
+			int tile = pendingTiles.back();
+			pendingTiles.pop_back();
+			int tileX = tile % tilesX;
+			int tileY = tile / tilesX;
+			minX = std::min(minX, tileX);
+			minY = std::min(minY, tileY);
+			maxX = std::max(maxX, tileX);
+			maxY = std::max(maxY, tileY);
+			for(int y = std::max(0, tileY - 1); y <= std::min(tilesY - 1, tileY + 1); y++)
+			{
+				for(int x = std::max(0, tileX - 1); x <= std::min(tilesX - 1, tileX + 1); x++)
+				{
+					int next = y * tilesX + x;
+					if(tileMap[next] && !visitedTiles[next])
+					{
+						visitedTiles[next] = 1;
+						pendingTiles.push_back(next);
+					}
+				}
+			}
+		}
+		// The tiles at the right and bottom edges may stick out of the frame.
+		regions.push_back(cv::Rect(minX * TileSize, minY * TileSize, (maxX - minX + 1) * TileSize, (maxY - minY + 1) * TileSize) & frameArea);
+	}
+}
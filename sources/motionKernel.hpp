@@ -0,0 +1,84 @@
+/**
+ * File Name:  motionKernel.hpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class compares two blurred grayscale frames in a single pass. For every pixel it takes the difference,
+ * compares it to the threshold and counts the changed pixels per 16x16 tile, 16 or 32 pixels at a time with SSE2 or AVX2,
+ * or one pixel at a time on other processors. It replaces the absdiff, threshold, dilate and findContours passes
+ * of MotionFilter, which the filter still has as the reference to compare against.
+ * Each instance of this class is to correspond to a single camera or video file.
+ */
+
+#ifndef MOTIONKERNEL_HPP
+#define MOTIONKERNEL_HPP
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+class MotionKernel
+{
+public:
+	// The tiles are TileSize x TileSize pixels, one SSE2 register wide.
+	static const int TileSize = 16;
+
+	// A pixel changed if it's difference is more than pixelThreshold,
+	// a tile changed if at least tileMinPixels of it's pixels changed.
+	MotionKernel(int pixelThreshold, int tileMinPixels);
+
+	// Changes pixelThreshold, from the next compare() on.
+	void setPixelThreshold(int pixelThreshold);
+	int threshold() const { return pixelThreshold; }
+
+	// Compares the frames and returns the motion score, the number of changed pixels.
+	// With stopAtMotion it returns as soon as a whole row of tiles has a changed tile,
+	// then the score and the tiles only cover the frame up to that row.
+	// Only the pixels set in mask are compared, it is packed like ZoneMask::packed(), nullptr compares all of them.
+	int compare(const cv::Mat& oldFrame, const cv::Mat& newFrame, bool stopAtMotion, const unsigned short* mask = nullptr);
+
+	// true if at least one tile changed in the last compare().
+	bool motion() const { return changedTiles > 0; }
+	// One byte per tile, row by row, 1 if the tile changed.
+	const std::vector<uchar>& tiles() const { return tileMap; }
+	int tilesPerRow() const { return tilesX; }
+	int tileRows() const { return tilesY; }
+	// The bounding rectangles of the groups of changed tiles that touch each other, in the pixels of the frame.
+	void changedRegions(std::vector<cv::Rect>& regions) const;
+
+	// Which code compare() runs on this processor: "AVX2", "SSE2" or "scalar".
+	// It is "scalar" on a processor whose SIMD code doesn't give the same counts as the scalar code.
+	static const char* instructionSet();
+	// Runs the SIMD code of this processor and the scalar code on the same rows and compares the counts.
+	static bool simdMatchesScalar();
+
+private:
+	// Counts the changed pixels of one row that are set in maskRow into the counts of it's tiles, returns how many changed.
+	typedef int (*RowKernel)(const uchar* oldRow, const uchar* newRow, const unsigned short* maskRow, int width,
+	                         uchar threshold, unsigned short* counts);
+	static RowKernel fastestRowKernel();
+	static bool matchesScalar(RowKernel kernel);
+	static RowKernel selectRowKernel();
+	// Marks the tiles of a row of tiles that changed, returns how many did.
+	int markTileRow(int tileRow);
+
+	uchar pixelThreshold;
+	const int tileMinPixels;
+	const RowKernel rowKernel;
+	cv::Size frameSize;
+	int tilesX;
+	int tilesY;
+	int changedTiles;
+	std::vector<unsigned short> tileCounts;
+	std::vector<uchar> tileMap;
+	// A row of mask with every pixel set, for compare() without a mask.
+	std::vector<unsigned short> fullMaskRow;
+	// The tiles waiting to be visited by changedRegions().
+	mutable std::vector<int> pendingTiles;
+	mutable std::vector<uchar> visitedTiles;
+};
+
+#endif
@@ -0,0 +1,359 @@
+/**
+ * File Name:  retentionManager.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class deletes the oldest videos in ~/SmartCCTV_recordings/ before the disk fills up, see retentionManager.hpp.
+ */
+
+#include "retentionManager.hpp"
+#include "event_channel.h"
+#include <sys/stat.h>     /* for fstatat(), struct stat */
+#include <sys/statvfs.h>  /* for statvfs() */
+#include <dirent.h>       /* for opendir(), readdir(), closedir() */
+#include <fcntl.h>        /* for AT_SYMLINK_NOFOLLOW */
+#include <unistd.h>       /* for unlink() */
+#include <syslog.h>       /* for syslog() */
+#include <cerrno>         /* for errno */
+#include <chrono>
+#include <cstdlib>        /* for strtoll() */
+#include <cstring>        /* for strncmp() */
+
+// How many videos are deleted at once, before the limits are looked at again.
+static const std::size_t MaxBatch = 64;
+static const std::uint64_t Megabyte = 1024 * 1024;
+
+
+RetentionManager& RetentionManager::instance()
+{
+	static RetentionManager manager;
+	return manager;
+}
+
+
+RetentionManager::RetentionManager()
+ : startTime(0), running(false), stopRequested(false), limitsChanged(false),
+   maxAgeDays(0), quotaBytes(0), minFreeBytes(1024 * Megabyte), totalBytes(0), diskFullReported(false)
+{
+}
+
+
+RetentionManager::~RetentionManager()
+{
+	// The daemon stops the manager before it exits, unless it exits because of an error.
+	// Then the thread is stopped here, a detached thread would still use the members while they are destroyed.
+	stop();
+}
+
+
+void RetentionManager::start(const std::string& recordingsDirectory, int maxAgeDays)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if(running)
+	{
+		return;
+	}
+	this->recordingsDirectory = recordingsDirectory;
+	this->maxAgeDays = maxAgeDays;
+	startTime = std::time(nullptr);
+	running = true;
+	stopRequested = false;
+	thread = std::thread(&RetentionManager::run, this);
+}
+
+
+void RetentionManager::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(!running)
+		{
+			return;
+		}
+		stopRequested = true;
+	}
+	wakeUp.notify_all();
+	thread.join();
+
+	std::lock_guard<std::mutex> lock(mutex);
+	running = false;
+	savedClips.clear();
+	clips.clear();
+	bytesPerCamera.clear();
+	totalBytes = 0;
+}
+
+
+void RetentionManager::clipSaved(int camera, const std::string& path, std::uint64_t size)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(!running)
+		{
+			return;
+		}
+		// The age of a video counts from when the event ended, like the modification time of the file.
+		savedClips.emplace_back(std::time(nullptr), Clip{ camera, path, size });
+	}
+	wakeUp.notify_one();
+}
+
+
+void RetentionManager::run()
+{
+	syslog(log_facility | LOG_NOTICE, "The retention manager is looking after %s", recordingsDirectory.c_str());
+	scanRecordings();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while(!stopRequested)
+	{
+		for(const std::pair<std::time_t, Clip>& saved : savedClips)
+		{
+			addClip(saved.first, saved.second);
+		}
+		savedClips.clear();
+		limitsChanged = false;
+
+		lock.unlock();
+		bool moreToDelete = enforceLimits();
+		lock.lock();
+
+		if(!moreToDelete)
+		{
+			// Everything else on the disk takes up space too, so the free space is looked at every minute even without new videos.
+			wakeUp.wait_for(lock, std::chrono::seconds(60), [this]() { return stopRequested || limitsChanged || !savedClips.empty(); });
+		}
+	}
+}
+
+
+void RetentionManager::scanRecordings()
+{
+	DIR* recordings = opendir(recordingsDirectory.c_str());
+	if(recordings == nullptr)
+	{
+		syslog(log_facility | LOG_NOTICE, "There are no videos in %s yet", recordingsDirectory.c_str());
+		return;
+	}
+
+	std::vector<std::pair<std::time_t, Clip>> found;
+	while(struct dirent* cameraEntry = readdir(recordings))
+	{
+		const char* name = cameraEntry->d_name;
+		char* end = nullptr;
+		if(std::strncmp(name, "camera", 6) != 0 || name[6] == '\0')
+		{
+			continue;
+		}
+		long camera = std::strtol(name + 6, &end, 10);
+		if(*end != '\0')
+		{
+			continue;
+		}
+		std::string cameraDirectory = recordingsDirectory + name + "/";
+		DIR* videos = opendir(cameraDirectory.c_str());
+		if(videos == nullptr)
+		{
+			continue;
+		}
+		while(struct dirent* videoEntry = readdir(videos))
+		{
+			std::string fileName = videoEntry->d_name;
+			bool isVideo = fileName.size() > 4 &&
+			               (fileName.compare(fileName.size() - 4, 4, ".avi") == 0 || fileName.compare(fileName.size() - 4, 4, ".mp4") == 0);
+			struct stat status;
+			if(!isVideo || fstatat(dirfd(videos), fileName.c_str(), &status, AT_SYMLINK_NOFOLLOW) == -1 || !S_ISREG(status.st_mode))
+			{
+				continue;
+			}
+			// A video that changed since the daemon started is being recorded, it is counted when it is saved.
+			if(status.st_mtime >= startTime)
+			{
+				continue;
+			}
+			found.emplace_back(status.st_mtime, Clip{ static_cast<int>(camera), cameraDirectory + fileName,
+			                                          static_cast<std::uint64_t>(status.st_size) });
+		}
+		closedir(videos);
+	}
+	closedir(recordings);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for(const std::pair<std::time_t, Clip>& clip : found)
+	{
+		addClip(clip.first, clip.second);
+	}
+	syslog(log_facility | LOG_NOTICE, "Found %zu videos taking up %.1f MB in %s", found.size(),
+	       totalBytes / (double) Megabyte, recordingsDirectory.c_str());
+}
+
+
+void RetentionManager::addClip(std::time_t time, const Clip& clip)
+{
+	clips.emplace(time, clip);
+	bytesPerCamera[clip.camera] += clip.size;
+	totalBytes += clip.size;
+}
+
+
+bool RetentionManager::enforceLimits()
+{
+	std::uint64_t available = UINT64_MAX;
+	struct statvfs disk;
+	if(statvfs(recordingsDirectory.c_str(), &disk) == 0)
+	{
+		available = static_cast<std::uint64_t>(disk.f_bavail) * disk.f_frsize;
+	}
+	std::time_t now = std::time(nullptr);
+
+	// The videos are taken out of the inventory under the lock, and deleted after it is let go.
+	std::vector<Clip> tooOld;
+	std::vector<Clip> overQuota;
+	std::vector<Clip> forSpace;
+	bool moreToDelete = false;
+	bool diskFull = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::uint64_t freed = 0;
+		std::size_t taken = 0;
+		auto takeOldest = [&](std::vector<Clip>& batch)
+		{
+			std::multimap<std::time_t, Clip>::iterator oldest = clips.begin();
+			freed += oldest->second.size;
+			bytesPerCamera[oldest->second.camera] -= oldest->second.size;
+			totalBytes -= oldest->second.size;
+			batch.push_back(oldest->second);
+			clips.erase(oldest);
+			taken++;
+		};
+		std::time_t oldestKept = now - static_cast<std::time_t>(maxAgeDays) * 24 * 60 * 60;
+		while(maxAgeDays > 0 && !clips.empty() && taken < MaxBatch && clips.begin()->first < oldestKept)
+		{
+			takeOldest(tooOld);
+		}
+		while(quotaBytes > 0 && !clips.empty() && taken < MaxBatch && totalBytes > quotaBytes)
+		{
+			takeOldest(overQuota);
+		}
+		// statvfs() doesn't see the space of this batch yet, it is counted in freed.
+		while(!clips.empty() && taken < MaxBatch && available + freed < minFreeBytes)
+		{
+			takeOldest(forSpace);
+		}
+		moreToDelete = taken == MaxBatch;
+		diskFull = clips.empty() && available != UINT64_MAX && available + freed < minFreeBytes;
+	}
+
+	deleteClips(tooOld, "older than retention_days");
+	deleteClips(overQuota, "over retention_quota_mb");
+	deleteClips(forSpace, "to keep retention_min_free_mb free");
+
+	// Nothing is left to delete, the videos being recorded fail once the disk is full.
+	if(diskFull && !diskFullReported)
+	{
+		std::string message = "The disk of " + recordingsDirectory + " has only " + std::to_string(available / Megabyte) +
+		                      " MB free, and there are no more videos to delete.";
+		syslog(log_facility | LOG_WARNING, "%s", message.c_str());
+		send_gui_event(EVENT_DISK_FULL, -1, message);
+	}
+	diskFullReported = diskFull;
+	return moreToDelete;
+}
+
+
+void RetentionManager::deleteClips(const std::vector<Clip>& batch, const char* reason)
+{
+	if(batch.empty())
+	{
+		return;
+	}
+	std::size_t deleted = 0;
+	std::uint64_t bytes = 0;
+	for(const Clip& clip : batch)
+	{
+		if(unlink(clip.path.c_str()) == 0)
+		{
+			deleted++;
+			bytes += clip.size;
+		}
+		else if(errno != ENOENT)
+		{
+			// It is left alone from now on, instead of being tried again and again.
+			syslog(log_facility | LOG_ERR, "Failed to delete %s : %m", clip.path.c_str());
+		}
+	}
+	syslog(log_facility | LOG_NOTICE, "Deleted %zu videos (%.1f MB) %s", deleted, bytes / (double) Megabyte, reason);
+}
+
+
+// Reads a whole decimal number from 0 to maximum, returns false if value is anything else.
+static bool parseLimit(const std::string& value, long long maximum, long long& number)
+{
+	if(value.empty())
+	{
+		return false;
+	}
+	char* end = nullptr;
+	errno = 0;
+	number = std::strtoll(value.c_str(), &end, 10);
+	return errno == 0 && *end == '\0' && number >= 0 && number <= maximum;
+}
+
+
+bool RetentionManager::setSetting(const std::string& name, const std::string& value, std::string& error)
+{
+	long long number = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(name == "retention_days")
+		{
+			if(!parseLimit(value, 36500, number))
+			{
+				error = value + " is not a number of days from 0 to 36500";
+				return false;
+			}
+			maxAgeDays = static_cast<int>(number);
+		}
+		else if(name == "retention_quota_mb" || name == "retention_min_free_mb")
+		{
+			if(!parseLimit(value, 1LL << 30, number))
+			{
+				error = value + " is not a number of megabytes from 0 to 1073741824";
+				return false;
+			}
+			(name == "retention_quota_mb" ? quotaBytes : minFreeBytes) = static_cast<std::uint64_t>(number) * Megabyte;
+		}
+		else
+		{
+			error = "unknown setting " + name;
+			return false;
+		}
+		limitsChanged = true;
+	}
+	syslog(log_facility | LOG_NOTICE, "Set %s to %lld", name.c_str(), number);
+	wakeUp.notify_one();
+	return true;
+}
+
+
+std::string RetentionManager::describe() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return "retention_days=" + std::to_string(maxAgeDays) +
+	       " retention_quota_mb=" + std::to_string(quotaBytes / Megabyte) +
+	       " retention_min_free_mb=" + std::to_string(minFreeBytes / Megabyte) +
+	       " recordings_mb=" + std::to_string(totalBytes / Megabyte) +
+	       " videos=" + std::to_string(clips.size());
+}
+
+
+std::uint64_t RetentionManager::cameraBytes(int camera) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::map<int, std::uint64_t>::const_iterator bytes = bytesPerCamera.find(camera);
+	return bytes != bytesPerCamera.end() ? bytes->second : 0;
+}
@@ -0,0 +1,101 @@
+/**
+ * File Name:  retentionManager.hpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class deletes the oldest videos in ~/SmartCCTV_recordings/ before the disk fills up.
+ * It runs on it's own thread in the daemon, so no camera ever waits for a video to be deleted.
+ *
+ * The videos are counted once when the daemon starts, by walking the camera directories. From then on
+ * every EventRecorder tells it about each video it saves, with the size it wrote, and the directories
+ * are never walked again. There are three limits, all of them are kept at once:
+ *
+ *   retention_days        - videos older than this many days are deleted, 0 keeps them forever
+ *   retention_quota_mb    - all of the videos together may take up at most this much, 0 for no quota
+ *   retention_min_free_mb - at least this much of the disk is kept free, as statvfs() says
+ *
+ * The oldest video of any camera is deleted first, in batches, until every limit is kept.
+ * The videos the cameras are recording right now are not counted until they are saved, so they are never deleted.
+ */
+
+#ifndef RETENTIONMANAGER_HPP
+#define RETENTIONMANAGER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class RetentionManager
+{
+public:
+	// The one retention manager of the daemon, it looks after the videos of all of the cameras.
+	static RetentionManager& instance();
+	~RetentionManager();
+
+	// Starts the thread, recordingsDirectory holds the cameraN directories and ends with a '/'.
+	void start(const std::string& recordingsDirectory, int maxAgeDays);
+	// Stops the thread, the batch it is deleting is finished first.
+	void stop();
+
+	// Called by the EventRecorder of a camera after it saved a video. Does nothing if the manager is not running.
+	void clipSaved(int camera, const std::string& path, std::uint64_t size);
+
+	// Changes retention_days, retention_quota_mb or retention_min_free_mb, error says why if it returns false.
+	bool setSetting(const std::string& name, const std::string& value, std::string& error);
+
+	// The limits and the space the videos take up, for the status request of the control channel.
+	std::string describe() const;
+	// The bytes of the saved videos of one camera.
+	std::uint64_t cameraBytes(int camera) const;
+
+private:
+	RetentionManager();
+	RetentionManager(const RetentionManager&) = delete;
+	RetentionManager& operator=(const RetentionManager&) = delete;
+
+	struct Clip
+	{
+		int camera;
+		std::string path;
+		std::uint64_t size;
+	};
+
+	void run();
+	void scanRecordings();
+	void addClip(std::time_t time, const Clip& clip);
+	bool enforceLimits();
+	void deleteClips(const std::vector<Clip>& batch, const char* reason);
+
+	std::string recordingsDirectory;
+	std::time_t startTime;
+	std::thread thread;
+
+	// The clips that were saved and the limits, handed to the thread under the mutex.
+	mutable std::mutex mutex;
+	std::condition_variable wakeUp;
+	bool running;
+	bool stopRequested;
+	bool limitsChanged;
+	std::vector<std::pair<std::time_t, Clip>> savedClips;
+	int maxAgeDays;
+	std::uint64_t quotaBytes;
+	std::uint64_t minFreeBytes;
+
+	// Only the thread changes the inventory, oldest first. The totals are read by the control channel too.
+	std::multimap<std::time_t, Clip> clips;
+	std::map<int, std::uint64_t> bytesPerCamera;
+	std::uint64_t totalBytes;
+	bool diskFullReported;
+};
+
+#endif
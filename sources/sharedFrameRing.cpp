@@ -0,0 +1,462 @@
+/**
+ * File Name:  sharedFrameRing.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * These classes pass the live stream frames of a camera from the daemon to the LiveStream Viewer
+ * through POSIX shared memory, instead of through image files in /tmp/SmartCCTV_livestream/.
+ * The shared memory holds a small ring of slots with the raw BGR pixels of a frame each.
+ * The daemon (SharedFrameWriter) copies a frame into a free slot and rings a doorbell, a named pipe
+ * in the camera's live stream directory that the viewer can wait on with epoll together with everything else.
+ * The viewer (SharedFrameReader) hands the pixels of the newest slot straight to SDL.
+ * Only the newest frame counts, a frame the viewer was too slow for is written over and counted as skipped,
+ * so the viewer is never more than one frame behind no matter how fast the camera is.
+ * The slot the viewer is reading is left alone, a sequence number in every slot makes sure of it.
+ * There is nothing to encode or decode, and no file is ever created.
+ */
+
+#include "sharedFrameRing.hpp"
+#include <sys/mman.h>   /* for shm_open(), mmap(), munmap() */
+#include <sys/stat.h>   /* for fstat(), mkfifo() */
+#include <fcntl.h>      /* for O_* constants */
+#include <unistd.h>     /* for ftruncate(), close(), read(), write(), unlink(), getuid(), geteuid() */
+#include <syslog.h>     /* for syslog() */
+#include <errno.h>      /* for errno */
+#include <cstring>      /* for memcpy() */
+#include <new>          /* for placement new */
+
+#define log_facility LOG_LOCAL0
+
+// Every slot starts on a cache line, so a frame being written never shares a line with the one being read.
+static const std::size_t CacheLine = 64;
+
+static std::size_t roundUp(std::size_t bytes)
+{
+	return (bytes + CacheLine - 1) / CacheLine * CacheLine;
+}
+
+
+std::string liveStreamDirectory()
+{
+	return "/tmp/SmartCCTV_livestream." + std::to_string(getuid()) + "/";
+}
+
+
+std::string sharedFrameName(const std::string& cameraName)
+{
+	return "/SmartCCTV_" + std::to_string(getuid()) + "_" + cameraName;
+}
+
+
+std::string sharedFrameDoorbell(const std::string& cameraDirectory)
+{
+	if(!cameraDirectory.empty() && cameraDirectory[cameraDirectory.size() - 1] == '/')
+	{
+		return cameraDirectory + "doorbell";
+	}
+	return cameraDirectory + "/doorbell";
+}
+
+
+SharedFrameWriter::SharedFrameWriter(const std::string& name, const std::string& doorbellPath)
+ : name(name), doorbellPath(doorbellPath), doorbell(-1), fd(-1), mapping(nullptr), mappingSize(0), header(nullptr), pixelArea(nullptr), latestSlot(-1), sequence(0),
+   displayedBefore(0), skippedBefore(0), reportedError(false)
+{
+}
+
+
+SharedFrameWriter::~SharedFrameWriter()
+{
+	close();
+	if(doorbell != -1)
+	{
+		::close(doorbell);
+		unlink(doorbellPath.c_str());
+	}
+}
+
+
+bool SharedFrameWriter::create(std::size_t frameBytes)
+{
+	// The doorbell outlives the shared memory, the viewer keeps waiting on it when the shared memory is made again.
+	// Opened for reading too, so the open doesn't wait for a viewer and a write never fails because there is none.
+	if(doorbell == -1)
+	{
+		if(mkfifo(doorbellPath.c_str(), S_IRUSR | S_IWUSR) == -1 && errno != EEXIST)
+		{
+			return false;
+		}
+		doorbell = ::open(doorbellPath.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+		if(doorbell == -1)
+		{
+			return false;
+		}
+	}
+
+	fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+	if(fd == -1 && errno == EEXIST && removeLeftover())
+	{
+		fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+	}
+	if(fd == -1)
+	{
+		return false;
+	}
+
+	std::size_t slotBytes = roundUp(frameBytes);
+	mappingSize = roundUp(sizeof(SharedFrameHeader)) + SharedFrameHeader::SlotCount * slotBytes;
+	if(ftruncate(fd, mappingSize) == -1)
+	{
+		close();
+		return false;
+	}
+	mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if(mapping == MAP_FAILED)
+	{
+		mapping = nullptr;
+		close();
+		return false;
+	}
+
+	header = new (mapping) SharedFrameHeader;
+	header->closed.store(0, std::memory_order_relaxed);
+	header->slotBytes = slotBytes;
+	header->latest.store(0, std::memory_order_relaxed);
+	header->ringing.store(0, std::memory_order_relaxed);
+	header->reading.store(0, std::memory_order_relaxed);
+	header->displayed.store(0, std::memory_order_relaxed);
+	header->skipped.store(0, std::memory_order_relaxed);
+	latestSlot = -1;
+	for(SharedFrameSlot& slot : header->slots)
+	{
+		slot.sequence.store(0, std::memory_order_relaxed);
+	}
+	pixelArea = static_cast<unsigned char*>(mapping) + roundUp(sizeof(SharedFrameHeader));
+	// The viewer only trusts the shared memory once it sees the magic number.
+	header->magic.store(SharedFrameHeader::Magic, std::memory_order_release);
+	syslog(log_facility | LOG_NOTICE, "Created the live stream shared memory %s", name.c_str());
+	return true;
+}
+
+
+bool SharedFrameWriter::removeLeftover()
+{
+	// Shared memory of this name that belongs to this user was left over by a daemon that crashed.
+	// Anything else is not this writer's to remove.
+	int leftover = shm_open(name.c_str(), O_RDONLY, 0);
+	if(leftover == -1)
+	{
+		return false;
+	}
+	struct stat status;
+	bool owned = fstat(leftover, &status) == 0 && status.st_uid == geteuid();
+	::close(leftover);
+	if(!owned)
+	{
+		syslog(log_facility | LOG_ERR, "The shared memory %s belongs to another user", name.c_str());
+		return false;
+	}
+	return shm_unlink(name.c_str()) == 0;
+}
+
+
+void SharedFrameWriter::close()
+{
+	if(header != nullptr)
+	{
+		// Wakes up the viewer, so it sees that it has to open the new shared memory.
+		header->closed.store(1, std::memory_order_release);
+		ring();
+		displayedBefore += header->displayed.load(std::memory_order_relaxed);
+		skippedBefore += header->skipped.load(std::memory_order_relaxed);
+	}
+	if(mapping != nullptr)
+	{
+		munmap(mapping, mappingSize);
+		mapping = nullptr;
+	}
+	if(fd != -1)
+	{
+		::close(fd);
+		fd = -1;
+		shm_unlink(name.c_str());
+	}
+	header = nullptr;
+	pixelArea = nullptr;
+}
+
+
+bool SharedFrameWriter::publish(const unsigned char* pixels, int width, int height, std::size_t stride)
+{
+	std::size_t rowBytes = static_cast<std::size_t>(width) * 3;
+	std::size_t frameBytes = rowBytes * height;
+	if(header != nullptr && frameBytes > header->slotBytes)
+	{
+		// The camera changed to a bigger resolution.
+		close();
+	}
+	if(header == nullptr && !create(frameBytes))
+	{
+		if(!reportedError)
+		{
+			syslog(log_facility | LOG_ERR, "Could not create the live stream shared memory %s: %m", name.c_str());
+			reportedError = true;
+		}
+		return false;
+	}
+
+	// Three slots are enough for the newest frame, the frame the viewer is reading and the frame being written.
+	// This load is ordered after the store to latest of the last frame, see SharedFrameReader::latestFrame().
+	std::uint64_t reading = header->reading.load(std::memory_order_seq_cst);
+	int slotIndex = 0;
+	while(slotIndex == latestSlot || (reading != 0 && header->slots[slotIndex].sequence.load(std::memory_order_relaxed) == reading))
+	{
+		slotIndex++;
+	}
+
+	sequence++;
+	SharedFrameSlot& slot = header->slots[slotIndex];
+	unsigned char* slotPixels = pixelArea + slotIndex * header->slotBytes;
+
+	// A sequence lock: 0 tells a viewer that is still reading this slot that the pixels are changing under it.
+	slot.sequence.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	if(stride == rowBytes)
+	{
+		std::memcpy(slotPixels, pixels, frameBytes);
+	}
+	else
+	{
+		for(int y = 0; y < height; y++)
+		{
+			std::memcpy(slotPixels + y * rowBytes, pixels + y * stride, rowBytes);
+		}
+	}
+	slot.width = width;
+	slot.height = height;
+	slot.stride = rowBytes;
+	slot.sequence.store(sequence, std::memory_order_release);
+	header->latest.store(sequence, std::memory_order_seq_cst);
+	latestSlot = slotIndex;
+
+	ring();
+	return true;
+}
+
+
+void SharedFrameWriter::ring()
+{
+	// The doorbell only says that there is something new, a viewer that is behind doesn't need one byte per frame.
+	if(header->ringing.exchange(1, std::memory_order_acq_rel) == 0)
+	{
+		char bell = 1;
+		// A full pipe (EAGAIN) is already ringing.
+		if(write(doorbell, &bell, 1) == -1 && errno != EAGAIN)
+		{
+			header->ringing.store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+
+SharedFrameCounters SharedFrameWriter::counters() const
+{
+	SharedFrameCounters counters = { sequence, displayedBefore, skippedBefore };
+	if(header != nullptr)
+	{
+		counters.displayed += header->displayed.load(std::memory_order_relaxed);
+		counters.skipped += header->skipped.load(std::memory_order_relaxed);
+	}
+	return counters;
+}
+
+
+SharedFrameReader::SharedFrameReader()
+ : doorbellFd(-1), fd(-1), mapping(nullptr), mappingSize(0), header(nullptr), pixelArea(nullptr), lastRead(0)
+{
+}
+
+
+SharedFrameReader::~SharedFrameReader()
+{
+	close();
+}
+
+
+bool SharedFrameReader::open(const std::string& name, const std::string& doorbellPath)
+{
+	close();
+	doorbellFd = ::open(doorbellPath.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if(doorbellFd == -1)
+	{
+		return false;
+	}
+	// Read and write, the viewer writes what it read and what it counted.
+	fd = shm_open(name.c_str(), O_RDWR, 0);
+	if(fd == -1)
+	{
+		return false;
+	}
+
+	struct stat fileInfo;
+	if(fstat(fd, &fileInfo) == -1 || static_cast<std::size_t>(fileInfo.st_size) < roundUp(sizeof(SharedFrameHeader)))
+	{
+		// The daemon is still setting it up.
+		close();
+		return false;
+	}
+	mappingSize = fileInfo.st_size;
+	mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if(mapping == MAP_FAILED)
+	{
+		mapping = nullptr;
+		close();
+		return false;
+	}
+
+	SharedFrameHeader* candidate = static_cast<SharedFrameHeader*>(mapping);
+	if(candidate->magic.load(std::memory_order_acquire) != SharedFrameHeader::Magic ||
+	   roundUp(sizeof(SharedFrameHeader)) + SharedFrameHeader::SlotCount * candidate->slotBytes > mappingSize)
+	{
+		close();
+		return false;
+	}
+	header = candidate;
+	pixelArea = static_cast<const unsigned char*>(mapping) + roundUp(sizeof(SharedFrameHeader));
+	// The frames from before the viewer opened the shared memory are not skipped, but the newest one is still shown.
+	std::uint64_t latest = header->latest.load(std::memory_order_acquire);
+	lastRead = latest > 0 ? latest - 1 : 0;
+	return true;
+}
+
+
+bool SharedFrameReader::writerClosed() const
+{
+	return header != nullptr && header->closed.load(std::memory_order_acquire) != 0;
+}
+
+
+void SharedFrameReader::close()
+{
+	if(mapping != nullptr)
+	{
+		munmap(mapping, mappingSize);
+		mapping = nullptr;
+	}
+	if(fd != -1)
+	{
+		::close(fd);
+		fd = -1;
+	}
+	if(doorbellFd != -1)
+	{
+		::close(doorbellFd);
+		doorbellFd = -1;
+	}
+	header = nullptr;
+	pixelArea = nullptr;
+}
+
+
+void SharedFrameReader::clearDoorbell()
+{
+	if(header == nullptr)
+	{
+		return;
+	}
+	// Cleared before the pipe is emptied, a frame published in between rings again instead of being missed.
+	header->ringing.store(0, std::memory_order_release);
+	char bells[64];
+	while(read(doorbellFd, bells, sizeof(bells)) > 0)
+	{
+	}
+}
+
+
+bool SharedFrameReader::hasNewFrame() const
+{
+	return header != nullptr && header->latest.load(std::memory_order_acquire) > lastRead;
+}
+
+
+bool SharedFrameReader::latestFrame(SharedFrameView& view)
+{
+	if(header == nullptr)
+	{
+		return false;
+	}
+
+	// Three tries, the daemon can only publish so many frames while the viewer is here.
+	for(int attempt = 0; attempt < 3; attempt++)
+	{
+		std::uint64_t latest = header->latest.load(std::memory_order_seq_cst);
+		if(latest == 0)
+		{
+			return false;
+		}
+		// Tells the daemon to keep away from this frame. If latest didn't change after it, the daemon
+		// sees the store before it picks the slot for the frame after the next one, and leaves this one alone.
+		header->reading.store(latest, std::memory_order_seq_cst);
+		if(header->latest.load(std::memory_order_seq_cst) != latest)
+		{
+			continue;
+		}
+
+		const SharedFrameSlot* slot = nullptr;
+		int slotIndex = 0;
+		for(; slotIndex < (int) SharedFrameHeader::SlotCount; slotIndex++)
+		{
+			if(header->slots[slotIndex].sequence.load(std::memory_order_acquire) == latest)
+			{
+				slot = &header->slots[slotIndex];
+				break;
+			}
+		}
+		if(slot == nullptr)
+		{
+			// The daemon already wrote over it.
+			continue;
+		}
+
+		view.pixels = pixelArea + slotIndex * header->slotBytes;
+		view.width = slot->width;
+		view.height = slot->height;
+		view.stride = slot->stride;
+		view.sequence = latest;
+		if(latest > lastRead + 1)
+		{
+			header->skipped.fetch_add(latest - lastRead - 1, std::memory_order_relaxed);
+		}
+		lastRead = latest;
+		// The size might have been read while the daemon already started on the slot, the sequence tells.
+		if(stillValid(view))
+		{
+			return true;
+		}
+		header->skipped.fetch_add(1, std::memory_order_relaxed);
+	}
+	return false;
+}
+
+
+bool SharedFrameReader::finishFrame(const SharedFrameView& view, bool displayed)
+{
+	bool valid = stillValid(view);
+	if(header != nullptr)
+	{
+		(valid && displayed ? header->displayed : header->skipped).fetch_add(1, std::memory_order_relaxed);
+	}
+	return valid;
+}
+
+
+bool SharedFrameReader::stillValid(const SharedFrameView& view) const
+{
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return header != nullptr && view.pixels >= pixelArea &&
+	       header->slots[(view.pixels - pixelArea) / header->slotBytes].sequence.load(std::memory_order_relaxed) == view.sequence;
+}
@@ -0,0 +1,180 @@
+/**
+ * File Name:  sharedFrameRing.hpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * These classes pass the live stream frames of a camera from the daemon to the LiveStream Viewer
+ * through POSIX shared memory, instead of through image files in /tmp/SmartCCTV_livestream/.
+ * The shared memory holds a small ring of slots with the raw BGR pixels of a frame each.
+ * The daemon (SharedFrameWriter) copies a frame into a free slot and rings a doorbell, a named pipe
+ * in the camera's live stream directory that the viewer can wait on with epoll together with everything else.
+ * The viewer (SharedFrameReader) hands the pixels of the newest slot straight to SDL.
+ * Only the newest frame counts, a frame the viewer was too slow for is written over and counted as skipped,
+ * so the viewer is never more than one frame behind no matter how fast the camera is.
+ * The slot the viewer is reading is left alone, a sequence number in every slot makes sure of it.
+ * There is nothing to encode or decode, and no file is ever created.
+ */
+
+#ifndef SHAREDFRAMERING_HPP
+#define SHAREDFRAMERING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// The atomics are shared between two processes, that only works if they don't hide a lock inside of the process.
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "The shared frame ring needs lock free 64 bit atomics");
+
+// The directory that has a livestream directory for every camera, like /tmp/SmartCCTV_livestream.1000/
+// The names of the shared memory and of this directory are shared by all of the users of the host,
+// so the uid is in both of them, and every user's daemon and viewer only find each other.
+std::string liveStreamDirectory();
+// The name of the shared memory of a camera, the cameraName is the name of it's livestream directory, like "camera0".
+std::string sharedFrameName(const std::string& cameraName);
+// The path of the doorbell of a camera, in it's livestream directory, like /tmp/SmartCCTV_livestream.1000/camera0
+std::string sharedFrameDoorbell(const std::string& cameraDirectory);
+
+// How many frames the daemon published, and what the viewer did with them.
+struct SharedFrameCounters
+{
+	std::uint64_t published;
+	std::uint64_t displayed;
+	std::uint64_t skipped;
+};
+
+struct SharedFrameSlot
+{
+	// The sequence number of the frame in this slot, 0 while the daemon is writing it.
+	std::atomic<std::uint64_t> sequence;
+	std::uint32_t width;
+	std::uint32_t height;
+	// The bytes from the start of one row to the next.
+	std::uint32_t stride;
+};
+
+struct SharedFrameHeader
+{
+	static const std::uint32_t Magic = 0x53435456;  // "SCTV"
+	static const std::uint32_t SlotCount = 3;
+
+	// Written last, once everything else is ready.
+	std::atomic<std::uint32_t> magic;
+	// Set when the daemon removes the shared memory, the viewer has to open the new one.
+	std::atomic<std::uint32_t> closed;
+	// How many bytes of pixels each slot has room for.
+	std::uint64_t slotBytes;
+	// The sequence number of the newest whole frame, 0 before the first one.
+	std::atomic<std::uint64_t> latest;
+	// The sequence number of the frame the viewer is reading, the daemon doesn't write over it's slot.
+	std::atomic<std::uint64_t> reading;
+	// Counted by the viewer, the frames it showed and the ones it never saw.
+	std::atomic<std::uint64_t> displayed;
+	std::atomic<std::uint64_t> skipped;
+	// 1 while the doorbell has a byte in it that the viewer hasn't taken out, so it never has more than one.
+	std::atomic<std::uint32_t> ringing;
+	SharedFrameSlot slots[SlotCount];
+};
+
+
+class SharedFrameWriter
+{
+public:
+	// name is the name of the shared memory, from sharedFrameName(), doorbellPath is from sharedFrameDoorbell().
+	SharedFrameWriter(const std::string& name, const std::string& doorbellPath);
+	~SharedFrameWriter();
+	SharedFrameWriter(const SharedFrameWriter&) = delete;
+	SharedFrameWriter& operator=(const SharedFrameWriter&) = delete;
+
+	// Copies a BGR frame into a slot that is neither the newest frame nor the one the viewer is reading,
+	// the shared memory is created with the first frame.
+	// stride is the bytes from the start of one row of pixels to the next. Returns false on an error.
+	bool publish(const unsigned char* pixels, int width, int height, std::size_t stride);
+
+	// All of the frames since this writer was made, including the shared memory that was already removed.
+	SharedFrameCounters counters() const;
+
+	// Removes the shared memory, the next publish() creates it again.
+	void close();
+
+private:
+	bool create(std::size_t frameBytes);
+	bool removeLeftover();
+	void ring();
+
+	const std::string name;
+	const std::string doorbellPath;
+	int doorbell;
+	int fd;
+	void* mapping;
+	std::size_t mappingSize;
+	SharedFrameHeader* header;
+	unsigned char* pixelArea;
+	// The slot with the newest frame, -1 before the first one.
+	int latestSlot;
+	// The sequence number of the last frame, it is also the number of frames published.
+	std::uint64_t sequence;
+	// What the viewer counted in the shared memory that was already removed.
+	std::uint64_t displayedBefore;
+	std::uint64_t skippedBefore;
+	bool reportedError;
+};
+
+
+// A frame in the shared memory, it is not copied. Hand it back to SharedFrameReader::finishFrame() after using it.
+struct SharedFrameView
+{
+	const unsigned char* pixels;
+	int width;
+	int height;
+	int stride;
+	std::uint64_t sequence;
+};
+
+
+class SharedFrameReader
+{
+public:
+	SharedFrameReader();
+	~SharedFrameReader();
+	SharedFrameReader(const SharedFrameReader&) = delete;
+	SharedFrameReader& operator=(const SharedFrameReader&) = delete;
+
+	// Maps the shared memory called name and opens it's doorbell, returns false if the daemon hasn't created them yet.
+	bool open(const std::string& name, const std::string& doorbellPath);
+	bool isOpen() const { return header != nullptr; }
+	// true if the daemon removed the shared memory, it has to be closed and opened again.
+	bool writerClosed() const;
+	void close();
+
+	// The doorbell can be read when the daemon published a frame or closed the shared memory.
+	// Wait on it with poll() or epoll, and call clearDoorbell() when it can be read.
+	int doorbell() const { return doorbellFd; }
+	void clearDoorbell();
+	// true if there is a frame that wasn't read yet.
+	bool hasNewFrame() const;
+	// Gets the newest frame and marks it as read, the frames before it that were never read are skipped.
+	// Returns false if there is none.
+	bool latestFrame(SharedFrameView& view);
+	// Call this after using the pixels of view, it counts the frame as displayed if it returns true.
+	// false means the pixels may be torn and must not be shown, the frame is counted as skipped.
+	// A frame that is given up without being shown is finished with displayed false, it is counted as skipped too.
+	bool finishFrame(const SharedFrameView& view, bool displayed = true);
+
+private:
+	bool stillValid(const SharedFrameView& view) const;
+
+	int doorbellFd;
+	int fd;
+	void* mapping;
+	std::size_t mappingSize;
+	SharedFrameHeader* header;
+	const unsigned char* pixelArea;
+	std::uint64_t lastRead;
+};
+
+#endif
@@ -0,0 +1,197 @@
+/**
+ * File Name:  zoneMask.cpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class holds the zones of a camera, the polygons of the frame that are watched (include) or ignored (exclude).
+ * They are read from the "zones" of settings/cameraN.yml and drawn once into a mask for every frame size
+ * that is asked for, as bytes for OpenCV and packed 16 pixels to a word for the motion kernel.
+ * The daemon reads the zones again when it recieves SIGHUP.
+ * Each instance of this class is to correspond to a single camera or video file.
+ */
+
+#include "zoneMask.hpp"
+#include "cameraSettings.hpp"
+#include <opencv2/imgproc.hpp>
+#include <sys/stat.h>  /* for stat() */
+#include <syslog.h>    /* for syslog() */
+#include <string>      /* for std::string */
+
+using std::string;
+
+#define log_facility LOG_LOCAL0
+
+
+ZoneMask::ZoneMask(int cameraNumber)
+ : cameraNumber(cameraNumber)
+{
+	reload();
+}
+
+
+bool ZoneMask::reload()
+{
+	std::vector<Zone> newZones;
+	if(!readZones(newZones))
+	{
+		return false;
+	}
+
+	zones.swap(newZones);
+	// The masks are drawn again the next time they are needed.
+	rasters.clear();
+	if(!zones.empty())
+	{
+		syslog(log_facility | LOG_NOTICE, "Camera %d has %zu zones", cameraNumber, zones.size());
+	}
+	return true;
+}
+
+
+bool ZoneMask::readZones(std::vector<Zone>& newZones) const
+{
+	string fileName = cameraSettingsFileName(cameraNumber);
+	struct stat fileInfo;
+	if(fileName.empty() || stat(fileName.c_str(), &fileInfo) == -1)
+	{
+		// No settings file, no zones.
+		return true;
+	}
+
+	cv::FileStorage storage(fileName, cv::FileStorage::READ);
+	if(!storage.isOpened())
+	{
+		syslog(log_facility | LOG_ERR, "Could not read the zones from %s", fileName.c_str());
+		return false;
+	}
+
+	cv::FileNode zonesNode = storage["zones"];
+	if(zonesNode.empty())
+	{
+		return true;
+	}
+	if(!zonesNode.isSeq())
+	{
+		syslog(log_facility | LOG_ERR, "The zones in %s are not a list", fileName.c_str());
+		return false;
+	}
+
+	for(std::size_t i = 0; i < zonesNode.size(); i++)
+	{
+		cv::FileNode zoneNode = zonesNode[(int) i];
+		string type = zoneNode["type"].empty() ? string() : (string) zoneNode["type"];
+		cv::FileNode pointsNode = zoneNode["points"];
+		// A polygon needs at least 3 corners, each one an x and a y.
+		if((type != "include" && type != "exclude") || !pointsNode.isSeq() || pointsNode.size() < 6 || pointsNode.size() % 2 != 0)
+		{
+			syslog(log_facility | LOG_ERR, "Zone %zu in %s needs a type of include or exclude and at least 3 points",
+			       i + 1, fileName.c_str());
+			return false;
+		}
+
+		Zone zone;
+		zone.include = type == "include";
+		for(std::size_t j = 0; j < pointsNode.size(); j += 2)
+		{
+			zone.points.push_back(cv::Point2f((float) pointsNode[(int) j], (float) pointsNode[(int) j + 1]));
+		}
+		newZones.push_back(zone);
+	}
+	return true;
+}
+
+
+ZoneMask::Raster& ZoneMask::raster(cv::Size size)
+{
+	for(Raster& existing : rasters)
+	{
+		if(existing.size == size)
+		{
+			return existing;
+		}
+	}
+
+	rasters.push_back(Raster());
+	Raster& raster = rasters.back();
+	raster.size = size;
+
+	// With include zones only they are watched, without them the whole frame is. The exclude zones are cut out of that.
+	bool anyInclude = false;
+	for(const Zone& zone : zones)
+	{
+		anyInclude = anyInclude || zone.include;
+	}
+	raster.pixels = cv::Mat(size.height, size.width, CV_8UC1, cv::Scalar(anyInclude ? 0 : 255));
+	for(int pass = 0; pass < 2; pass++)
+	{
+		bool include = pass == 0;
+		for(const Zone& zone : zones)
+		{
+			if(zone.include != include)
+			{
+				continue;
+			}
+			std::vector<std::vector<cv::Point>> polygon(1);
+			for(const cv::Point2f& point : zone.points)
+			{
+				polygon[0].push_back(cv::Point(cvRound(point.x * size.width), cvRound(point.y * size.height)));
+			}
+			cv::fillPoly(raster.pixels, polygon, cv::Scalar(include ? 255 : 0));
+		}
+	}
+
+	int wordsPerRow = (size.width + 15) / 16;
+	raster.packed.assign(wordsPerRow * size.height, 0);
+	for(int y = 0; y < size.height; y++)
+	{
+		const uchar* row = raster.pixels.ptr(y);
+		unsigned short* words = &raster.packed[y * wordsPerRow];
+		for(int x = 0; x < size.width; x++)
+		{
+			if(row[x])
+			{
+				words[x / 16] |= (unsigned short) (1 << (x % 16));
+			}
+		}
+	}
+
+	raster.bounds = cv::boundingRect(raster.pixels);
+	return raster;
+}
+
+
+const cv::Mat& ZoneMask::pixels(cv::Size size)
+{
+	return raster(size).pixels;
+}
+
+
+const std::vector<unsigned short>& ZoneMask::packed(cv::Size size)
+{
+	return raster(size).packed;
+}
+
+
+cv::Rect ZoneMask::boundingBox(cv::Size size)
+{
+	if(zones.empty())
+	{
+		return cv::Rect(0, 0, size.width, size.height);
+	}
+	return raster(size).bounds;
+}
+
+
+bool ZoneMask::excluded(const cv::Rect& rect, cv::Size size)
+{
+	if(zones.empty())
+	{
+		return false;
+	}
+	cv::Rect inside = rect & cv::Rect(0, 0, size.width, size.height);
+	return inside.area() <= 0 || cv::countNonZero(raster(size).pixels(inside)) == 0;
+}
@@ -0,0 +1,71 @@
+/**
+ * File Name:  zoneMask.hpp
+ * Created By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Created On:  10/18/26
+ *
+ * Modified By:  Konstantin Rebrov <krebrov@mail.csuchico.edu>
+ * Modified On:  10/18/26
+ *
+ * Description:
+ * This class holds the zones of a camera, the polygons of the frame that are watched (include) or ignored (exclude).
+ * They are read from the "zones" of settings/cameraN.yml and drawn once into a mask for every frame size
+ * that is asked for, as bytes for OpenCV and packed 16 pixels to a word for the motion kernel.
+ * The daemon reads the zones again when it recieves SIGHUP.
+ * Each instance of this class is to correspond to a single camera or video file.
+ */
+
+#ifndef ZONEMASK_HPP
+#define ZONEMASK_HPP
+
+#include <opencv2/core.hpp>
+#include <deque>
+#include <vector>
+
+class ZoneMask
+{
+public:
+	// Reads the zones of cameraN.
+	explicit ZoneMask(int cameraNumber);
+
+	// Reads the zones again. If the file can't be read, the old zones are kept and false is returned.
+	bool reload();
+
+	// true if there are no zones, then every pixel is watched.
+	bool empty() const { return zones.empty(); }
+
+	// 255 where the pixels are watched and 0 where they are ignored, for frames of this size.
+	const cv::Mat& pixels(cv::Size size);
+	// The same mask, bit i of a word is pixel i of 16 pixels, (width + 15) / 16 words per row.
+	const std::vector<unsigned short>& packed(cv::Size size);
+	// The smallest rectangle around all of the watched pixels.
+	cv::Rect boundingBox(cv::Size size);
+	// true if not a single pixel of rect is watched.
+	bool excluded(const cv::Rect& rect, cv::Size size);
+
+private:
+	struct Zone
+	{
+		bool include;
+		// The corners as fractions of the width and the height of the frame, so a zone fits any resolution.
+		std::vector<cv::Point2f> points;
+	};
+
+	struct Raster
+	{
+		cv::Size size;
+		cv::Mat pixels;
+		std::vector<unsigned short> packed;
+		cv::Rect bounds;
+	};
+
+	bool readZones(std::vector<Zone>& newZones) const;
+	Raster& raster(cv::Size size);
+
+	const int cameraNumber;
+	std::vector<Zone> zones;
+	// One for every frame size asked for, like the full frame for the detectors and the half size frame for the motion.
+	// A deque doesn't move it's elements when it grows, the masks handed out stay valid until the next reload().
+	std::deque<Raster> rasters;
+};
+
+#endif